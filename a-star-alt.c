@@ -0,0 +1,212 @@
+// a-star-alt.c
+// ALT heuristic (A*, Landmarks, Triangle inequality): exact distances from and to a
+// few landmarks bound the distance between any two nodes from below.
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	ALT_MAGIC	"ASTRALT"
+#define	ALT_VERSION	1
+#define	ALT_UNREACHABLE	UINT_MAX
+
+struct _a_star_alt_t {
+	size_t nnodes, nlandmarks;
+	a_star_id_t* landmarks;
+	unsigned int* from;	// d(landmark, node), nlandmarks per node
+	unsigned int* to;	// d(node, landmark), nlandmarks per node
+};
+
+typedef struct _a_star_alt_header_t {
+	char magic[8];
+	unsigned int version;
+	unsigned int nlandmarks;
+	unsigned long long nnodes;
+} a_star_alt_header_t;
+
+/**
+ * One-to-all Dijkstra over the forward (or reverse) rows into dist[], LONG_MAX if unreachable.
+ **/
+static void dijkstra(const a_star_csr_t* csr, int reverse, a_star_id_t root, long* dist, pqueue_t* q) {
+	const size_t* offsets = reverse ? csr->roffsets : csr->offsets;
+	const a_star_id_t* adjacent = reverse ? csr->from : csr->to;
+	const long* cost = reverse ? csr->rcost : csr->cost;
+	size_t i;
+
+	for(i=0; i < csr->nnodes; i++)
+		dist[i] = LONG_MAX;
+	dist[root] = 0;
+	pqueue_push(q, root, 0);
+	while( pqueue_len(q) ) {
+		a_star_id_t curr = pqueue_pop(q);
+		for(i=offsets[curr]; i < offsets[curr+1]; i++) {
+			long d = dist[curr] + cost[i];
+			if( d < dist[adjacent[i]] ) {
+				dist[adjacent[i]] = d;
+				pqueue_push(q, adjacent[i], d);
+			}
+		}
+	}
+}
+
+static inline unsigned int compact(long d) {
+	return d == LONG_MAX ? ALT_UNREACHABLE : d >= ALT_UNREACHABLE ? ALT_UNREACHABLE - 1 : (unsigned int)d;
+}
+
+static a_star_alt_t* alloc_alt(size_t nnodes, size_t nlandmarks) {
+	a_star_alt_t* x = (a_star_alt_t*)malloc(sizeof(a_star_alt_t));
+	x->nnodes = nnodes;
+	x->nlandmarks = nlandmarks;
+	x->landmarks = (a_star_id_t*)malloc(sizeof(a_star_id_t) * nlandmarks);
+	x->from = (unsigned int*)malloc(sizeof(unsigned int) * nnodes * nlandmarks);
+	x->to = (unsigned int*)malloc(sizeof(unsigned int) * nnodes * nlandmarks);
+	return x;
+}
+
+int a_star_alt_build(const a_star_csr_t* csr, size_t nlandmarks, a_star_alt_t** alt) {
+	a_star_alt_t* x;
+	pqueue_t* q;
+	long *dist, *nearest;
+	size_t i, l;
+
+	// arguments validation
+	if( ! csr || ! csr->roffsets || ! alt || ! nlandmarks || ! csr->nnodes )
+		return -1;
+	if( nlandmarks > csr->nnodes )
+		nlandmarks = csr->nnodes;
+
+	x = alloc_alt(csr->nnodes, nlandmarks);
+	dist = (long*)malloc(sizeof(long) * csr->nnodes);
+	nearest = (long*)malloc(sizeof(long) * csr->nnodes);	// distance to the closest landmark so far
+	pqueue_init(pqHeap, csr->nnodes, 0, &q);
+
+	// farthest selection: start from the node farthest from node 0, then keep
+	// adding the node whose closest landmark is farthest away
+	dijkstra(csr, 0, 0, dist, q);
+	a_star_id_t next = 0;
+	for(i=0; i < csr->nnodes; i++) {
+		nearest[i] = LONG_MAX;
+		if( dist[i] != LONG_MAX && dist[i] > dist[next] )
+			next = (a_star_id_t)i;
+	}
+	for(l=0; l < nlandmarks; l++) {
+		x->landmarks[l] = next;
+		dijkstra(csr, 0, next, dist, q);
+		for(i=0; i < csr->nnodes; i++) {
+			x->from[i * nlandmarks + l] = compact(dist[i]);
+			if( dist[i] < nearest[i] )
+				nearest[i] = dist[i];
+		}
+		dijkstra(csr, 1, next, dist, q);
+		for(i=0; i < csr->nnodes; i++)
+			x->to[i * nlandmarks + l] = compact(dist[i]);
+		// unreachable nodes (other components) are the best candidates
+		for(i=0, next=0; i < csr->nnodes; i++)
+			if( nearest[i] > nearest[next] )
+				next = (a_star_id_t)i;
+	}
+
+	pqueue_deinit(q);
+	free(nearest);
+	free(dist);
+
+	*alt = x;
+	return 0;
+}
+
+void a_star_alt_free(a_star_alt_t* alt) {
+	if( ! alt )
+		return;
+	free(alt->landmarks);
+	free(alt->from);
+	free(alt->to);
+	free(alt);
+}
+
+long a_star_alt_estimate(const a_star_alt_t* alt, a_star_id_t n1, a_star_id_t n2) {
+	const unsigned int *from1, *from2, *to1, *to2;
+	long best = 0;
+	size_t l;
+	if( n1 >= alt->nnodes || n2 >= alt->nnodes )
+		return 0;
+	from1 = &alt->from[n1 * alt->nlandmarks];
+	from2 = &alt->from[n2 * alt->nlandmarks];
+	to1 = &alt->to[n1 * alt->nlandmarks];
+	to2 = &alt->to[n2 * alt->nlandmarks];
+	for(l=0; l < alt->nlandmarks; l++) {
+		// d(n1,n2) >= d(L,n2) - d(L,n1)  and  d(n1,n2) >= d(n1,L) - d(n2,L)
+		if( from1[l] != ALT_UNREACHABLE && from2[l] != ALT_UNREACHABLE && from2[l] > from1[l]
+				&& (long)(from2[l] - from1[l]) > best )
+			best = from2[l] - from1[l];
+		if( to1[l] != ALT_UNREACHABLE && to2[l] != ALT_UNREACHABLE && to1[l] > to2[l]
+				&& (long)(to1[l] - to2[l]) > best )
+			best = to1[l] - to2[l];
+	}
+	return best;
+}
+
+long a_star_alt_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	return a_star_alt_estimate((const a_star_alt_t*)cookie, NODE_ID(n1), NODE_ID(n2));
+}
+
+int a_star_alt_save(const a_star_alt_t* alt, const char* file) {
+	a_star_alt_header_t header;
+	size_t n;
+	FILE* f;
+	int ok;
+
+	if( ! alt || ! file )
+		return -1;
+	if( ! (f = fopen(file, "wb")) )
+		return -1;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ALT_MAGIC, sizeof(ALT_MAGIC));
+	header.version = ALT_VERSION;
+	header.nlandmarks = (unsigned int)alt->nlandmarks;
+	header.nnodes = alt->nnodes;
+	n = alt->nnodes * alt->nlandmarks;
+	ok = fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(alt->landmarks, sizeof(a_star_id_t), alt->nlandmarks, f) == alt->nlandmarks
+		&& fwrite(alt->from, sizeof(unsigned int), n, f) == n
+		&& fwrite(alt->to, sizeof(unsigned int), n, f) == n;
+
+	return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+int a_star_alt_load(const char* file, a_star_alt_t** alt) {
+	a_star_alt_header_t header;
+	a_star_alt_t* x;
+	size_t n;
+	FILE* f;
+	int ok;
+
+	if( ! file || ! alt )
+		return -1;
+	if( ! (f = fopen(file, "rb")) )
+		return -1;
+
+	if( fread(&header, sizeof(header), 1, f) != 1
+			|| memcmp(header.magic, ALT_MAGIC, sizeof(ALT_MAGIC)) != 0
+			|| header.version != ALT_VERSION
+			|| ! header.nlandmarks || header.nnodes >= A_STAR_NONE ) {
+		fclose(f);
+		return -1;
+	}
+
+	x = alloc_alt(header.nnodes, header.nlandmarks);
+	n = x->nnodes * x->nlandmarks;
+	ok = fread(x->landmarks, sizeof(a_star_id_t), x->nlandmarks, f) == x->nlandmarks
+		&& fread(x->from, sizeof(unsigned int), n, f) == n
+		&& fread(x->to, sizeof(unsigned int), n, f) == n;
+	fclose(f);
+
+	if( ! ok ) {
+		a_star_alt_free(x);
+		return -1;
+	}
+	*alt = x;
+	return 0;
+}
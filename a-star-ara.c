@@ -0,0 +1,298 @@
+// a-star-ara.c
+// ARA*: anytime search. A first path is found quickly with an inflated
+// heuristic, then the inflation is lowered step by step, each step reusing the
+// search state of the previous one, until the path is optimal or time is up.
+
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	ARA_WEIGHT_STEP	0.5	// inflation taken off after each path
+#define	ARA_CLOCK_EVERY	256	// expansions between looks at the clock
+
+// ctx->closed states within an iteration
+#define	ARA_CLOSED	1
+#define	ARA_INCONSISTENT	2	// closed, and reached more cheaply since
+
+typedef struct _ara_t {
+	const a_star_csr_t* csr;
+	a_star_search_ctx_t* ctx;
+	a_star_id_t begin, end;
+	a_star_node_t* endNode;
+	a_star_distance_func_t h_dist;
+	a_star_progress_func_t progress;
+	void* cookie;
+	double weight;
+	unsigned long long deadline;	// ns, 0 if none
+	a_star_id_t* closed;	// closed in this iteration
+	size_t nclosed, closedCapacity;
+	a_star_id_t* open;	// drained from the open queue between iterations
+	size_t nopen, openCapacity;
+	a_star_node_t** best;	// last path found
+	int nbest;
+	a_star_progress_info_t progressInfo;
+} ara_t;
+
+static inline void list_push(a_star_id_t** list, size_t* n, size_t* capacity, a_star_id_t id) {
+	if( *n == *capacity ) {
+		*capacity = *capacity ? *capacity * 2 : 256;
+		*list = (a_star_id_t*)realloc(*list, sizeof(a_star_id_t) * *capacity);
+	}
+	(*list)[(*n)++] = id;
+}
+
+static inline long inflated(const ara_t* x, a_star_id_t n) {
+	return x->ctx->g[n] + (long)(x->weight * x->ctx->h[n]);
+}
+
+/**
+ * Expands nodes in order of inflated F-cost until none could lead to a cheaper
+ * path to the end. Returns 0 if the deadline passed first, 1 otherwise.
+ **/
+static int improve_path(ara_t* x) {
+	const a_star_csr_t* csr = x->csr;
+	a_star_search_ctx_t* ctx = x->ctx;
+	long expanded = 0;
+	size_t i;
+
+	while( pqueue_len(ctx->open) && pqueue_top_key(ctx->open) < a_star_ctx_g(ctx, x->end) ) {
+		a_star_id_t curr;
+		// the first path is always completed, so that there is one to return
+		if( x->deadline && x->best && ++expanded % ARA_CLOCK_EVERY == 0 && a_star_clock_ns() >= x->deadline )
+			return 0;
+		curr = pqueue_pop(ctx->open);
+		A_STAR_STAT(ctx, expansions);
+
+		if( x->progress && a_star_ctx_sampled(ctx, ++x->progressInfo.nframe) ) {
+			x->progressInfo.currDistance = ctx->h[curr];
+			x->progressInfo.analized = x->progressInfo.current = a_star_csr_node_at(csr, curr);
+			x->progressInfo.analizedId = x->progressInfo.currentId = curr;
+			(*x->progress)(&x->progressInfo, x->cookie);
+		}
+
+		ctx->closed[curr] = ARA_CLOSED;
+		list_push(&x->closed, &x->nclosed, &x->closedCapacity, curr);
+
+		// the edges leaving 'curr' are contiguous
+		for(i=csr->offsets[curr]; i < csr->offsets[curr+1]; i++) {
+			a_star_id_t neighbor = csr->to[i];
+			a_star_ctx_touch(ctx, neighbor);
+			if( x->progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				x->progressInfo.analized = a_star_csr_node_at(csr, neighbor);
+				x->progressInfo.analizedId = neighbor;
+				(*x->progress)(&x->progressInfo, x->cookie);
+			}
+			long gCost = ctx->g[curr] + csr->cost[i];
+			if( gCost >= ctx->g[neighbor] )
+				continue;
+			if( ctx->h[neighbor] == LONG_MAX ) {
+				ctx->h[neighbor] = (*x->h_dist)(a_star_csr_node_at(csr, neighbor), x->endNode, x->cookie);
+				A_STAR_STAT(ctx, heuristicCalls);
+			}
+			ctx->g[neighbor] = gCost;
+			ctx->prev[neighbor] = curr;
+			// a closed node waits for the next iteration instead of being re-opened
+			if( ctx->closed[neighbor] )
+				ctx->closed[neighbor] = ARA_INCONSISTENT;
+			else {
+				ctx->f[neighbor] = inflated(x, neighbor);
+				a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+			}
+		}
+	}
+	return 1;
+}
+
+/**
+ * Takes the path to the end found by the last iteration, and the least
+ * uninflated F-cost of the nodes left open or inconsistent, a lower bound on
+ * the cost of any path. Returns the cost of the path.
+ **/
+static long take_path(ara_t* x, long* lowest) {
+	const a_star_csr_t* csr = x->csr;
+	a_star_search_ctx_t* ctx = x->ctx;
+	a_star_id_t step;
+	long cost = 0;
+	size_t i;
+	int k;
+
+	for(step=x->end, k=0; step != A_STAR_NONE; step=ctx->prev[step], k++)
+		;
+	free(x->best);
+	x->best = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * k);
+	x->nbest = k;
+	for(step=x->end; step != A_STAR_NONE; step=ctx->prev[step]) {
+		x->best[--k] = a_star_csr_node_at(csr, step);
+		// back-links into nodes reached more cheaply since may make the path
+		// cheaper than g(end), so its edges are summed
+		if( ctx->prev[step] != A_STAR_NONE ) {
+			long edge = LONG_MAX;
+			for(i=csr->offsets[ctx->prev[step]]; i < csr->offsets[ctx->prev[step]+1]; i++)
+				if( csr->to[i] == step && csr->cost[i] < edge )
+					edge = csr->cost[i];
+			cost += edge;
+		}
+	}
+
+	// the open queue is drained here, and refilled with the next inflation
+	*lowest = LONG_MAX;
+	x->nopen = 0;
+	while( pqueue_len(ctx->open) ) {
+		a_star_id_t n = pqueue_pop(ctx->open);
+		list_push(&x->open, &x->nopen, &x->openCapacity, n);
+		if( ctx->g[n] + ctx->h[n] < *lowest )
+			*lowest = ctx->g[n] + ctx->h[n];
+	}
+	for(i=0; i < x->nclosed; i++) {
+		a_star_id_t n = x->closed[i];
+		if( ctx->closed[n] == ARA_INCONSISTENT && ctx->g[n] + ctx->h[n] < *lowest )
+			*lowest = ctx->g[n] + ctx->h[n];
+	}
+	return cost;
+}
+
+/**
+ * Starts the next iteration: the nodes left open and the inconsistent ones are
+ * queued by their F-cost inflated by the new weight, and none is closed.
+ **/
+static void next_iteration(ara_t* x) {
+	a_star_search_ctx_t* ctx = x->ctx;
+	size_t i;
+	for(i=0; i < x->nopen; i++) {
+		ctx->f[x->open[i]] = inflated(x, x->open[i]);
+		a_star_ctx_open(ctx, x->open[i], ctx->f[x->open[i]]);
+	}
+	for(i=0; i < x->nclosed; i++) {
+		a_star_id_t n = x->closed[i];
+		if( ctx->closed[n] == ARA_INCONSISTENT ) {
+			ctx->f[n] = inflated(x, n);
+			a_star_ctx_open(ctx, n, ctx->f[n]);
+		}
+		ctx->closed[n] = 0;
+	}
+	x->nopen = x->nclosed = 0;
+}
+
+int a_star_search_anytime(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		double weight,
+		unsigned long deadlineUs,
+		a_star_progress_func_t progress,
+		a_star_improve_func_t improve,
+		void* cookie,
+		a_star_node_t*** path,
+		double* bound
+		) {
+	ara_t x;
+	double achieved = 0;
+	int complete;
+
+	// arguments validation
+	if( ! csr || (! csr->nodes && ! csr->handles) || ! ctx || ! begin || ! end )
+		return -1;
+	if( ! h_dist || ! path || weight < 1 )
+		return -1;
+	if( csr->nnodes > ctx->capacity )
+		return -1;
+	if( NODE_ID(begin) >= csr->nnodes || NODE_ID(end) >= csr->nnodes )
+		return -1;
+
+	// initialization
+	memset(&x, 0, sizeof(x));
+	x.csr = csr;
+	x.ctx = ctx;
+	x.begin = NODE_ID(begin);
+	x.end = NODE_ID(end);
+	x.endNode = end;
+	x.h_dist = h_dist;
+	x.progress = progress;
+	x.cookie = cookie;
+	x.weight = weight;
+	x.deadline = deadlineUs ? a_star_clock_ns() + deadlineUs * 1000ULL : 0;
+	x.progressInfo.analizedId = x.progressInfo.currentId = A_STAR_NONE;
+	*path = 0;
+
+	a_star_ctx_reset(ctx);
+
+	a_star_ctx_touch(ctx, x.begin);
+	ctx->g[x.begin] = 0;
+	ctx->h[x.begin] = (*h_dist)(begin, end, cookie);
+	A_STAR_STAT(ctx, heuristicCalls);
+	ctx->f[x.begin] = inflated(&x, x.begin);
+	x.progressInfo.maxDistance = ctx->h[x.begin];
+	a_star_ctx_open(ctx, x.begin, ctx->f[x.begin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
+	for(;;) {
+		long cost, lowest;
+		complete = improve_path(&x);
+		if( ! complete || a_star_ctx_g(ctx, x.end) == LONG_MAX )
+			break;	// out of time, or there is no path
+		cost = take_path(&x, &lowest);
+		// the path is within 'weight' of the cheapest, and within cost/lowest too
+		achieved = lowest >= cost ? 1 : lowest > 0 && (double)cost / lowest < x.weight ? (double)cost / lowest : x.weight;
+		if( improve )
+			(*improve)(x.best, x.nbest, cost, achieved, cookie);
+		if( achieved <= 1 || (x.deadline && a_star_clock_ns() >= x.deadline) )
+			break;
+		x.weight -= ARA_WEIGHT_STEP;
+		if( x.weight > achieved )
+			x.weight = achieved;
+		if( x.weight < 1 )
+			x.weight = 1;
+		next_iteration(&x);
+	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
+
+	free(x.closed);
+	free(x.open);
+	*path = x.best;
+	if( bound )
+		*bound = achieved;
+	return x.nbest;
+}
+
+int a_star_shortest_path_anytime(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		double weight,
+		unsigned long deadlineUs,
+		a_star_improve_func_t improve,
+		void* cookie,
+		a_star_node_t*** path,
+		double* bound
+		) {
+	a_star_search_ctx_t* ctx;
+	a_star_csr_t* csr;
+	unsigned long long start;
+	int n;
+
+	// arguments validation
+	if( ! graph || ! graph->begin || ! graph->end )
+		return -1;
+	if( ! g_dist )
+		return -1;
+
+	// the deadline also covers preparing the graph
+	start = a_star_clock_ns();
+	if( a_star_graph_prepare(graph, g_dist, cookie, &csr) < 0 )
+		return -1;
+	if( a_star_search_ctx_init(csr->nnodes, aqHeap, &ctx) < 0 ) {
+		a_star_csr_free(csr);
+		return -1;
+	}
+	if( deadlineUs ) {
+		unsigned long spent = (unsigned long)((a_star_clock_ns() - start) / 1000);
+		// out of time already: a first path is still searched for
+		deadlineUs = spent < deadlineUs ? deadlineUs - spent : 1;
+	}
+	n = a_star_search_anytime(csr, ctx, graph->begin, graph->end, h_dist, weight, deadlineUs, 0, improve, cookie, path, bound);
+	a_star_search_ctx_deinit(ctx);
+	a_star_csr_free(csr);
+
+	return n;
+}
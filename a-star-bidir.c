@@ -0,0 +1,162 @@
+// a-star-bidir.c
+
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+typedef struct _a_star_frontier_t {
+	a_star_search_ctx_t* ctx;
+	const size_t* offsets;	// adjacency this side walks
+	const a_star_id_t* adjacent;
+	const long* cost;
+	a_star_node_t* target;	// node this side heads to
+	int reverse;	// heuristic measured towards 'target' from the other end
+} a_star_frontier_t;
+
+static inline long frontier_h(const a_star_csr_t* csr, const a_star_frontier_t* fr,
+		a_star_distance_func_t h_dist, a_star_id_t n, void* cookie) {
+	return fr->reverse
+		? (*h_dist)(fr->target, a_star_csr_node_at(csr, n), cookie)
+		: (*h_dist)(a_star_csr_node_at(csr, n), fr->target, cookie);
+}
+
+int a_star_bidir_search(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* forward,
+		a_star_search_ctx_t* backward,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t*** path
+		) {
+	a_star_frontier_t sides[2];
+	a_star_id_t idBegin, idEnd, meet=A_STAR_NONE;
+	long best=LONG_MAX;
+	int s, n=0;
+	size_t i;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+
+	// arguments validation
+	if( ! csr || (! csr->nodes && ! csr->handles) || ! csr->roffsets || ! forward || ! backward || forward == backward )
+		return -1;
+	if( ! begin || ! end || ! h_dist || ! path )
+		return -1;
+	if( csr->nnodes > forward->capacity || csr->nnodes > backward->capacity )
+		return -1;
+	idBegin = NODE_ID(begin);
+	idEnd = NODE_ID(end);
+	if( idBegin >= csr->nnodes || idEnd >= csr->nnodes )
+		return -1;
+
+	// initialization
+	*path = 0;
+
+	sides[0].ctx = forward;
+	sides[0].offsets = csr->offsets;
+	sides[0].adjacent = csr->to;
+	sides[0].cost = csr->cost;
+	sides[0].target = end;
+	sides[0].reverse = 0;
+	sides[1].ctx = backward;
+	sides[1].offsets = csr->roffsets;
+	sides[1].adjacent = csr->from;
+	sides[1].cost = csr->rcost;
+	sides[1].target = begin;
+	sides[1].reverse = 1;
+
+	for(s=0; s < 2; s++) {
+		a_star_search_ctx_t* ctx = sides[s].ctx;
+		a_star_id_t root = s ? idEnd : idBegin;
+		a_star_ctx_reset(ctx);
+		a_star_ctx_touch(ctx, root);
+		ctx->g[root] = 0;
+		ctx->h[root] = ctx->f[root] = frontier_h(csr, &sides[s], h_dist, root, cookie);
+		A_STAR_STAT(ctx, heuristicCalls);
+		a_star_ctx_open(ctx, root, ctx->f[root]);
+	}
+	progressInfo.maxDistance = forward->h[idBegin];
+	A_STAR_STAT_PHASE(forward, initTime);
+	if( idBegin == idEnd ) {
+		best = 0;
+		meet = idBegin;
+	}
+
+	for(;;) {
+		// a path through a node still open on either side costs at least that side's
+		// lowest F, so once either reaches the best meeting cost nothing can improve it
+		long fTop = pqueue_top_key(forward->open), bTop = pqueue_top_key(backward->open);
+		if( fTop == LONG_MAX || bTop == LONG_MAX || fTop >= best || bTop >= best )
+			break;
+
+		// expand the smaller frontier
+		s = pqueue_len(backward->open) < pqueue_len(forward->open);
+		a_star_frontier_t* fr = &sides[s];
+		a_star_search_ctx_t* ctx = fr->ctx;
+		a_star_search_ctx_t* other = sides[!s].ctx;
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		A_STAR_STAT(ctx, expansions);
+
+		if( progress && a_star_ctx_sampled(forward, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analized = progressInfo.current = a_star_csr_node_at(csr, curr);
+			progressInfo.analizedId = progressInfo.currentId = curr;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		ctx->closed[curr] = 1;
+
+		for(i=fr->offsets[curr]; i < fr->offsets[curr+1]; i++) {
+			a_star_id_t neighbor = fr->adjacent[i];
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && forward->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analized = a_star_csr_node_at(csr, neighbor);
+				progressInfo.analizedId = neighbor;
+				(*progress)(&progressInfo, cookie);
+			}
+			long gCost = ctx->g[curr] + fr->cost[i];
+			if( gCost < ctx->g[neighbor] ) {
+				if( ctx->h[neighbor] == LONG_MAX ) {
+					ctx->h[neighbor] = frontier_h(csr, fr, h_dist, neighbor, cookie);
+					A_STAR_STAT(ctx, heuristicCalls);
+				}
+				ctx->g[neighbor] = gCost;
+				ctx->f[neighbor] = gCost + ctx->h[neighbor];
+				ctx->prev[neighbor] = curr;
+				a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+			}
+			// the frontiers touch
+			long gOther = a_star_ctx_g(other, neighbor);
+			if( gOther != LONG_MAX && ctx->g[neighbor] + gOther < best ) {
+				best = ctx->g[neighbor] + gOther;
+				meet = neighbor;
+			}
+		}
+	}
+
+	A_STAR_STAT_PHASE(forward, searchTime);
+
+	if( meet != A_STAR_NONE ) {
+		a_star_id_t step;
+		int k;
+		// begin..meet along the forward links, then meet..end along the backward ones
+		for(step=meet, n=0; step != A_STAR_NONE; step=forward->prev[step], n++)
+			;
+		for(step=backward->prev[meet]; step != A_STAR_NONE; step=backward->prev[step], n++)
+			;
+		*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
+		for(step=meet, k=0; step != A_STAR_NONE; step=forward->prev[step], k++)
+			(*path)[k] = a_star_csr_node_at(csr, step);
+		for(i=0; i < k/2; i++) {
+			a_star_node_t* t = (*path)[i];
+			(*path)[i] = (*path)[k-1-i];
+			(*path)[k-1-i] = t;
+		}
+		for(step=backward->prev[meet]; step != A_STAR_NONE; step=backward->prev[step], k++)
+			(*path)[k] = a_star_csr_node_at(csr, step);
+	}
+	A_STAR_STAT_PHASE(forward, pathTime);
+
+	return n;
+}
@@ -0,0 +1,345 @@
+// a-star-cache.c
+// Path cache: optimal paths of earlier queries, keyed by their endpoints and
+// the graph version, reused whole or sliced (a subpath of an optimal path is
+// optimal between its own endpoints), and evicted least recently used first.
+
+#include <stdint.h>
+#include <string.h>
+#include "a-star.h"
+
+typedef struct _cache_entry_t cache_entry_t;
+
+/**
+ * Chain links of a hash table element, first in each element.
+ **/
+typedef struct _cache_link_t {
+	struct _cache_link_t *next, **pprev;
+} cache_link_t;
+
+/**
+ * Node 'path[pos]' of an entry, chained with the other cached occurrences of
+ * nodes that hash alike.
+ **/
+typedef struct _cache_occurrence_t {
+	cache_link_t link;
+	cache_entry_t* entry;
+	size_t pos;
+} cache_occurrence_t;
+
+struct _cache_entry_t {
+	cache_link_t link;	// chain of the endpoint table
+	cache_entry_t *newer, *older;	// LRU list
+	unsigned long version;
+	a_star_node_t *begin, *end;
+	size_t n;	// path length, 0 if there is no path
+	size_t bytes;
+	a_star_node_t** path;	// n entries, followed by the n occurrences
+	cache_occurrence_t* occurrences;
+};
+
+typedef struct _cache_table_t {
+	cache_link_t** buckets;
+	size_t nbuckets, count;
+} cache_table_t;
+
+struct _a_star_cache_t {
+	size_t maxBytes;
+	cache_table_t entries;	// of cache_entry_t, by begin, end and version
+	cache_table_t nodes;	// of cache_occurrence_t, by node and version
+	cache_entry_t *newest, *oldest;
+	a_star_cache_stats_t stats;
+};
+
+static inline size_t hash_node(const a_star_node_t* node, unsigned long version) {
+	uint64_t v = version;
+	uint64_t h = ((uint64_t)(uintptr_t)node ^ (v << 32 | v >> 32)) * 0x9e3779b97f4a7c15ULL;
+	return (size_t)(h ^ h >> 29);
+}
+static inline size_t hash_ends(const a_star_node_t* begin, const a_star_node_t* end, unsigned long version) {
+	return hash_node(begin, version) ^ hash_node(end, ~version) * 31;
+}
+
+static void table_link(cache_table_t* table, cache_link_t* e, size_t hash) {
+	cache_link_t** head = &table->buckets[hash & (table->nbuckets - 1)];
+	if( (e->next = *head) )
+		e->next->pprev = &e->next;
+	e->pprev = head;
+	*head = e;
+}
+static void table_unlink(cache_link_t* e) {
+	if( (*e->pprev = e->next) )
+		e->next->pprev = e->pprev;
+}
+static inline cache_link_t* table_chain(const cache_table_t* table, size_t hash) {
+	return table->nbuckets ? table->buckets[hash & (table->nbuckets - 1)] : 0;
+}
+
+/**
+ * Bytes by which the buckets of 'table' grow to hold 'count' elements.
+ **/
+static size_t table_growth(const cache_table_t* table, size_t count) {
+	size_t nbuckets = table->nbuckets;
+	while( nbuckets < count )
+		nbuckets = nbuckets ? nbuckets * 2 : 256;
+	return (nbuckets - table->nbuckets) * sizeof(cache_link_t*);
+}
+
+/**
+ * Makes room for one more element in 'table'; 'hash' gives the hash of an element.
+ * Returns the bytes by which the buckets grew.
+ **/
+static size_t table_grow(cache_table_t* table, size_t(*hash)(const cache_link_t*)) {
+	cache_table_t grown;
+	size_t i, bytes = table_growth(table, table->count + 1);
+	if( ! bytes )
+		return 0;
+	grown.nbuckets = table->nbuckets ? table->nbuckets * 2 : 256;
+	grown.buckets = (cache_link_t**)calloc(grown.nbuckets, sizeof(cache_link_t*));
+	for(i=0; i < table->nbuckets; i++) {
+		cache_link_t* e = table->buckets[i];
+		while( e ) {
+			cache_link_t* next = e->next;
+			table_link(&grown, e, (*hash)(e));
+			e = next;
+		}
+	}
+	free(table->buckets);
+	table->buckets = grown.buckets;
+	table->nbuckets = grown.nbuckets;
+	return bytes;
+}
+static size_t hash_entry(const cache_link_t* e) {
+	const cache_entry_t* entry = (const cache_entry_t*)e;
+	return hash_ends(entry->begin, entry->end, entry->version);
+}
+static size_t hash_occurrence(const cache_link_t* o) {
+	const cache_occurrence_t* occurrence = (const cache_occurrence_t*)o;
+	return hash_node(occurrence->entry->path[occurrence->pos], occurrence->entry->version);
+}
+
+/**
+ * Entry for the given endpoints, or null if there is none.
+ **/
+static cache_entry_t* find_entry(const a_star_cache_t* cache, unsigned long version,
+		const a_star_node_t* begin, const a_star_node_t* end) {
+	cache_link_t* e;
+	for(e=table_chain(&cache->entries, hash_ends(begin, end, version)); e; e=e->next) {
+		cache_entry_t* entry = (cache_entry_t*)e;
+		if( entry->begin == begin && entry->end == end && entry->version == version )
+			return entry;
+	}
+	return 0;
+}
+
+static void link_entry(a_star_cache_t* cache, cache_entry_t* entry) {
+	size_t i;
+
+	cache->stats.bytes += table_grow(&cache->entries, hash_entry);
+	table_link(&cache->entries, &entry->link, hash_entry(&entry->link));
+	cache->entries.count++;
+	for(i=0; i < entry->n; i++) {
+		cache_occurrence_t* o = &entry->occurrences[i];
+		o->entry = entry;
+		o->pos = i;
+		cache->stats.bytes += table_grow(&cache->nodes, hash_occurrence);
+		table_link(&cache->nodes, &o->link, hash_occurrence(&o->link));
+		cache->nodes.count++;
+	}
+
+	entry->older = cache->newest;
+	entry->newer = 0;
+	if( cache->newest )
+		cache->newest->newer = entry;
+	else
+		cache->oldest = entry;
+	cache->newest = entry;
+	cache->stats.entries++;
+	cache->stats.bytes += entry->bytes;
+}
+static void unlink_entry(a_star_cache_t* cache, cache_entry_t* entry) {
+	size_t i;
+	table_unlink(&entry->link);
+	cache->entries.count--;
+	for(i=0; i < entry->n; i++)
+		table_unlink(&entry->occurrences[i].link);
+	cache->nodes.count -= entry->n;
+
+	if( entry->newer )
+		entry->newer->older = entry->older;
+	else
+		cache->newest = entry->older;
+	if( entry->older )
+		entry->older->newer = entry->newer;
+	else
+		cache->oldest = entry->newer;
+	cache->stats.entries--;
+	cache->stats.bytes -= entry->bytes;
+}
+static void touch_entry(a_star_cache_t* cache, cache_entry_t* entry) {
+	if( entry == cache->newest )
+		return;
+	entry->newer->older = entry->older;
+	if( entry->older )
+		entry->older->newer = entry->newer;
+	else
+		cache->oldest = entry->newer;
+	entry->older = cache->newest;
+	entry->newer = 0;
+	cache->newest->newer = entry;
+	cache->newest = entry;
+}
+
+int a_star_cache_init(size_t maxBytes, a_star_cache_t** cache) {
+	if( ! cache )
+		return -1;
+	*cache = (a_star_cache_t*)calloc(1, sizeof(a_star_cache_t));
+	(*cache)->maxBytes = maxBytes;
+	return 0;
+}
+
+void a_star_cache_clear(a_star_cache_t* cache) {
+	while( cache->oldest ) {
+		cache_entry_t* entry = cache->oldest;
+		unlink_entry(cache, entry);
+		free(entry);
+	}
+}
+
+void a_star_cache_deinit(a_star_cache_t* cache) {
+	if( ! cache )
+		return;
+	a_star_cache_clear(cache);
+	free(cache->entries.buckets);
+	free(cache->nodes.buckets);
+	free(cache);
+}
+
+void a_star_cache_stats(const a_star_cache_t* cache, a_star_cache_stats_t* stats) {
+	*stats = cache->stats;
+}
+
+int a_star_cache_lookup(
+		a_star_cache_t* cache,
+		unsigned long version,
+		const a_star_node_t* begin,
+		const a_star_node_t* end,
+		a_star_node_t* const** path,
+		int* n
+		) {
+	cache_entry_t* entry;
+	cache_link_t *ob, *oe;
+
+	if( ! cache || ! begin || ! end || ! path || ! n )
+		return -1;
+
+	// the same endpoints, including queries known to have no path
+	if( (entry = find_entry(cache, version, begin, end)) ) {
+		touch_entry(cache, entry);
+		cache->stats.hits++;
+		*path = entry->path;
+		*n = (int)entry->n;
+		return 1;
+	}
+
+	// both endpoints on a cached path, in order
+	for(ob=table_chain(&cache->nodes, hash_node(begin, version)); ob; ob=ob->next) {
+		const cache_occurrence_t* b = (const cache_occurrence_t*)ob;
+		if( b->entry->path[b->pos] != begin || b->entry->version != version )
+			continue;
+		for(oe=table_chain(&cache->nodes, hash_node(end, version)); oe; oe=oe->next) {
+			const cache_occurrence_t* e = (const cache_occurrence_t*)oe;
+			if( e->entry == b->entry && e->pos >= b->pos && e->entry->path[e->pos] == end ) {
+				touch_entry(cache, b->entry);
+				cache->stats.subpathHits++;
+				*path = b->entry->path + b->pos;
+				*n = (int)(e->pos - b->pos + 1);
+				return 1;
+			}
+		}
+	}
+
+	cache->stats.misses++;
+	return 0;
+}
+
+int a_star_cache_insert(
+		a_star_cache_t* cache,
+		unsigned long version,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_node_t* const* path,
+		int n
+		) {
+	cache_entry_t* entry;
+	size_t bytes;
+
+	// arguments validation
+	if( ! cache || ! begin || ! end || n < 0 || (n && ! path) )
+		return -1;
+	if( n && (path[0] != begin || path[n-1] != end) )
+		return -1;
+
+	bytes = sizeof(cache_entry_t) + (size_t)n * (sizeof(a_star_node_t*) + sizeof(cache_occurrence_t));
+	if( bytes > cache->maxBytes )
+		return 0;	// would not fit even alone
+	// an entry for the same endpoints is replaced
+	if( (entry = find_entry(cache, version, begin, end)) ) {
+		unlink_entry(cache, entry);
+		free(entry);
+	}
+	// the tables only grow, so room is made for the buckets the entry adds as well
+	while( cache->stats.bytes + bytes + table_growth(&cache->entries, cache->entries.count + 1)
+			+ table_growth(&cache->nodes, cache->nodes.count + n) > cache->maxBytes ) {
+		if( ! (entry = cache->oldest) )
+			return 0;	// the index leaves no room for it
+		unlink_entry(cache, entry);
+		free(entry);
+		cache->stats.evictions++;
+	}
+
+	// the entry, its path and its occurrences in one block
+	entry = (cache_entry_t*)malloc(bytes);
+	entry->version = version;
+	entry->begin = begin;
+	entry->end = end;
+	entry->n = n;
+	entry->bytes = bytes;
+	entry->path = (a_star_node_t**)(entry + 1);
+	entry->occurrences = (cache_occurrence_t*)(entry->path + n);
+	if( n )
+		memcpy(entry->path, path, sizeof(a_star_node_t*) * n);
+	link_entry(cache, entry);
+	return 1;
+}
+
+int a_star_cached_shortest_path(
+		a_star_cache_t* cache,
+		unsigned long version,
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		) {
+	a_star_node_t* const* cached;
+	int n;
+
+	// arguments validation
+	if( ! cache || ! graph || ! graph->begin || ! graph->end || ! path )
+		return -1;
+
+	if( a_star_cache_lookup(cache, version, graph->begin, graph->end, &cached, &n) > 0 ) {
+		*path = 0;
+		if( n ) {
+			*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
+			memcpy(*path, cached, sizeof(a_star_node_t*) * n);
+		}
+		return n;
+	}
+	n = a_star_shortest_path_ex(graph, g_dist, h_dist, progress, cookie, queue, path);
+	if( n >= 0 )
+		a_star_cache_insert(cache, version, graph->begin, graph->end, *path, n);
+	return n;
+}
@@ -0,0 +1,445 @@
+// a-star-ch.c
+// Contraction Hierarchies: nodes are contracted one by one in order of importance,
+// adding shortcut edges wherever a shortest path led through the contracted node.
+// A query then only ever climbs the hierarchy, from both ends.
+
+#include <string.h>
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	CH_WITNESS_SETTLE	256	// nodes a witness search may settle before giving up
+#define	CH_SIMULATE_SETTLE	32	// same, when only estimating a node's priority
+
+typedef struct _ch_arc_t {
+	a_star_id_t node;	// other end of the arc
+	a_star_id_t middle;	// contracted node a shortcut bypasses, A_STAR_NONE for an original edge
+	long cost;
+} ch_arc_t;
+
+typedef struct _ch_arcs_t {
+	ch_arc_t* a;
+	unsigned int n, size;
+} ch_arcs_t;
+
+struct _a_star_ch_t {
+	size_t nnodes, nshortcuts;
+	a_star_node_t** nodes;	// node by index (borrowed from the source graph)
+	a_star_node_t* handles;	// node by index of a loaded graph (a copy, the mapping may go), when nodes is null
+	unsigned int* rank;	// contraction order
+	size_t *upOffsets, *downOffsets;	// nnodes+1 entries each
+	ch_arc_t* up;	// arcs to higher ranked nodes, by tail
+	ch_arc_t* down;	// arcs from higher ranked nodes, by head (node is the tail)
+};
+
+typedef struct _ch_builder_t {
+	size_t nnodes;
+	ch_arcs_t *out, *in;	// arcs between nodes not contracted yet
+	unsigned int* deleted;	// contracted neighbours, for the priority
+	a_star_search_ctx_t* witness;
+	size_t nshortcuts;
+} ch_builder_t;
+
+static void arcs_append(ch_arcs_t* l, a_star_id_t node, a_star_id_t middle, long cost) {
+	if( l->n == l->size ) {
+		l->size = l->size ? l->size * 2 : 4;
+		l->a = (ch_arc_t*)realloc(l->a, sizeof(ch_arc_t) * l->size);
+	}
+	l->a[l->n].node = node;
+	l->a[l->n].middle = middle;
+	l->a[l->n].cost = cost;
+	l->n++;
+}
+
+static ch_arc_t* arcs_find(const ch_arcs_t* l, a_star_id_t node) {
+	unsigned int i;
+	for(i=0; i < l->n; i++)
+		if( l->a[i].node == node )
+			return &l->a[i];
+	return 0;
+}
+
+static void arcs_remove(ch_arcs_t* l, a_star_id_t node) {
+	unsigned int i;
+	for(i=0; i < l->n; i++)
+		if( l->a[i].node == node ) {
+			l->a[i] = l->a[--l->n];
+			return;
+		}
+}
+
+/**
+ * Adds the arc from->to, or lowers the cost of the existing one.
+ * Returns non-zero when the arc set changed.
+ **/
+static int add_arc(ch_builder_t* b, a_star_id_t from, a_star_id_t to, a_star_id_t middle, long cost) {
+	ch_arc_t* a = arcs_find(&b->out[from], to);
+	if( a ) {
+		if( cost >= a->cost )
+			return 0;
+		a->cost = cost;
+		a->middle = middle;
+		a = arcs_find(&b->in[to], from);
+		a->cost = cost;
+		a->middle = middle;
+		return 1;
+	}
+	arcs_append(&b->out[from], to, middle, cost);
+	arcs_append(&b->in[to], from, middle, cost);
+	return 1;
+}
+
+/**
+ * Local Dijkstra from 'source' among the remaining nodes, avoiding 'skip',
+ * up to distance 'limit' or 'maxSettled' settled nodes. Distances are left in the witness context.
+ **/
+static void witness_search(ch_builder_t* b, a_star_id_t source, a_star_id_t skip, long limit, int maxSettled) {
+	a_star_search_ctx_t* ctx = b->witness;
+	int settled = 0;
+	unsigned int i;
+
+	a_star_ctx_reset(ctx);
+	a_star_ctx_touch(ctx, source);
+	ctx->g[source] = 0;
+	pqueue_push(ctx->open, source, 0);
+	while( pqueue_len(ctx->open) && pqueue_top_key(ctx->open) <= limit && settled++ < maxSettled ) {
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		const ch_arcs_t* l = &b->out[curr];
+		for(i=0; i < l->n; i++) {
+			a_star_id_t neighbor = l->a[i].node;
+			if( neighbor == skip )
+				continue;
+			a_star_ctx_touch(ctx, neighbor);
+			long gCost = ctx->g[curr] + l->a[i].cost;
+			if( gCost < ctx->g[neighbor] ) {
+				ctx->g[neighbor] = gCost;
+				pqueue_push(ctx->open, neighbor, gCost);
+			}
+		}
+	}
+}
+
+/**
+ * Finds the shortcuts contracting 'v' requires, and adds them unless simulating.
+ * Returns their number.
+ **/
+static int contract(ch_builder_t* b, a_star_id_t v, int simulate) {
+	const ch_arcs_t *in = &b->in[v], *out = &b->out[v];
+	long maxOut = 0;
+	int shortcuts = 0;
+	unsigned int i, j;
+
+	for(j=0; j < out->n; j++)
+		if( out->a[j].cost > maxOut )
+			maxOut = out->a[j].cost;
+
+	for(i=0; i < in->n; i++) {
+		a_star_id_t u = in->a[i].node;
+		long viaV = in->a[i].cost;
+		witness_search(b, u, v, viaV + maxOut, simulate ? CH_SIMULATE_SETTLE : CH_WITNESS_SETTLE);
+		for(j=0; j < out->n; j++) {
+			a_star_id_t w = out->a[j].node;
+			long cost = viaV + out->a[j].cost;
+			if( w == u || a_star_ctx_g(b->witness, w) <= cost )
+				continue;
+			shortcuts++;
+			if( ! simulate && add_arc(b, u, w, v, cost) )
+				b->nshortcuts++;
+		}
+	}
+	return shortcuts;
+}
+
+/**
+ * Edge difference plus contracted neighbours: cheap nodes that keep the graph
+ * sparse go first, and contraction spreads evenly over the graph.
+ **/
+static long priority(ch_builder_t* b, a_star_id_t v) {
+	long shortcuts = contract(b, v, 1);
+	return 4 * (shortcuts - (long)b->in[v].n - (long)b->out[v].n) + b->deleted[v];
+}
+
+/**
+ * Moves the per-node arc lists of one direction into a compact array.
+ **/
+static void compact_arcs(const ch_arcs_t* lists, size_t nnodes, size_t** offsets, ch_arc_t** arcs) {
+	size_t i, n;
+	*offsets = (size_t*)malloc(sizeof(size_t) * (nnodes + 1));
+	for(i=0, n=0; i < nnodes; i++) {
+		(*offsets)[i] = n;
+		n += lists[i].n;
+	}
+	(*offsets)[nnodes] = n;
+	*arcs = (ch_arc_t*)malloc(sizeof(ch_arc_t) * (n ? n : 1));
+	for(i=0; i < nnodes; i++)
+		if( lists[i].n )
+			memcpy(&(*arcs)[(*offsets)[i]], lists[i].a, sizeof(ch_arc_t) * lists[i].n);
+}
+
+int a_star_ch_build(const a_star_csr_t* csr, a_star_ch_t** ch) {
+	ch_builder_t b;
+	ch_arcs_t *up, *down;
+	a_star_ch_t* x;
+	pqueue_t* order;
+	unsigned int rank = 0;
+	size_t i, e;
+
+	// arguments validation
+	if( ! csr || (! csr->nodes && ! csr->handles) || ! ch )
+		return -1;
+
+	if( a_star_search_ctx_init(csr->nnodes, aqHeap, &b.witness) < 0 )
+		return -1;
+	b.nnodes = csr->nnodes;
+	b.out = (ch_arcs_t*)calloc(csr->nnodes ? csr->nnodes : 1, sizeof(ch_arcs_t));
+	b.in = (ch_arcs_t*)calloc(csr->nnodes ? csr->nnodes : 1, sizeof(ch_arcs_t));
+	b.deleted = (unsigned int*)calloc(csr->nnodes ? csr->nnodes : 1, sizeof(unsigned int));
+	b.nshortcuts = 0;
+
+	// the contracted node's remaining arcs are exactly its upward and downward arcs
+	up = (ch_arcs_t*)calloc(csr->nnodes ? csr->nnodes : 1, sizeof(ch_arcs_t));
+	down = (ch_arcs_t*)calloc(csr->nnodes ? csr->nnodes : 1, sizeof(ch_arcs_t));
+
+	x = (a_star_ch_t*)malloc(sizeof(a_star_ch_t));
+	x->nnodes = csr->nnodes;
+	x->nodes = csr->nodes;
+	x->handles = 0;
+	if( ! csr->nodes ) {
+		x->handles = (a_star_node_t*)malloc(sizeof(a_star_node_t) * (csr->nnodes ? csr->nnodes : 1));
+		memcpy(x->handles, csr->handles, sizeof(a_star_node_t) * csr->nnodes);
+	}
+	x->rank = (unsigned int*)malloc(sizeof(unsigned int) * (csr->nnodes ? csr->nnodes : 1));
+
+	// original edges, keeping the cheapest of parallel ones and dropping loops
+	for(i=0; i < csr->nnodes; i++)
+		for(e=csr->offsets[i]; e < csr->offsets[i+1]; e++)
+			if( csr->to[e] != i )
+				add_arc(&b, (a_star_id_t)i, csr->to[e], A_STAR_NONE, csr->cost[e]);
+
+	pqueue_init(pqHeap, csr->nnodes, 0, &order);
+	for(i=0; i < csr->nnodes; i++)
+		pqueue_push(order, (a_star_id_t)i, priority(&b, (a_star_id_t)i));
+
+	while( pqueue_len(order) ) {
+		a_star_id_t v = pqueue_pop(order);
+		unsigned int k;
+
+		// lazy update: contract only if still the cheapest
+		long p = priority(&b, v);
+		if( pqueue_len(order) && p > pqueue_top_key(order) ) {
+			pqueue_push(order, v, p);
+			continue;
+		}
+
+		contract(&b, v, 0);
+		x->rank[v] = rank++;
+
+		// detach from the remaining graph
+		for(k=0; k < b.out[v].n; k++) {
+			arcs_remove(&b.in[b.out[v].a[k].node], v);
+			b.deleted[b.out[v].a[k].node]++;
+		}
+		for(k=0; k < b.in[v].n; k++) {
+			arcs_remove(&b.out[b.in[v].a[k].node], v);
+			b.deleted[b.in[v].a[k].node]++;
+		}
+		up[v] = b.out[v];
+		down[v] = b.in[v];
+		memset(&b.out[v], 0, sizeof(ch_arcs_t));
+		memset(&b.in[v], 0, sizeof(ch_arcs_t));
+
+		// neighbours' priorities changed
+		for(k=0; k < up[v].n; k++)
+			pqueue_push(order, up[v].a[k].node, priority(&b, up[v].a[k].node));
+		for(k=0; k < down[v].n; k++)
+			if( ! arcs_find(&up[v], down[v].a[k].node) )
+				pqueue_push(order, down[v].a[k].node, priority(&b, down[v].a[k].node));
+	}
+
+	compact_arcs(up, csr->nnodes, &x->upOffsets, &x->up);
+	compact_arcs(down, csr->nnodes, &x->downOffsets, &x->down);
+	x->nshortcuts = b.nshortcuts;
+
+	for(i=0; i < csr->nnodes; i++) {
+		free(up[i].a);
+		free(down[i].a);
+	}
+	free(up);
+	free(down);
+	pqueue_deinit(order);
+	a_star_search_ctx_deinit(b.witness);
+	free(b.deleted);
+	free(b.in);
+	free(b.out);
+
+	*ch = x;
+	return 0;
+}
+
+void a_star_ch_free(a_star_ch_t* ch) {
+	if( ! ch )
+		return;
+	free(ch->handles);
+	free(ch->rank);
+	free(ch->upOffsets);
+	free(ch->downOffsets);
+	free(ch->up);
+	free(ch->down);
+	free(ch);
+}
+
+size_t a_star_ch_shortcuts(const a_star_ch_t* ch) {
+	return ch ? ch->nshortcuts : 0;
+}
+
+/**
+ * The arc from->to of the hierarchy; it is stored with its lower ranked end.
+ **/
+static const ch_arc_t* find_arc(const a_star_ch_t* ch, a_star_id_t from, a_star_id_t to) {
+	size_t i;
+	if( ch->rank[from] < ch->rank[to] ) {
+		for(i=ch->upOffsets[from]; i < ch->upOffsets[from+1]; i++)
+			if( ch->up[i].node == to )
+				return &ch->up[i];
+	} else {
+		for(i=ch->downOffsets[to]; i < ch->downOffsets[to+1]; i++)
+			if( ch->down[i].node == from )
+				return &ch->down[i];
+	}
+	return 0;
+}
+
+static inline a_star_node_t* ch_node(const a_star_ch_t* ch, a_star_id_t n) {
+	return ch->nodes ? ch->nodes[n] : &ch->handles[n];
+}
+
+/**
+ * Appends the original nodes after 'from' up to 'to' (inclusive), expanding shortcuts.
+ * With a null 'path' only counts them.
+ **/
+static int unpack(const a_star_ch_t* ch, a_star_id_t from, a_star_id_t to, a_star_node_t** path, int n) {
+	const ch_arc_t* a = find_arc(ch, from, to);
+	if( a->middle != A_STAR_NONE ) {
+		n = unpack(ch, from, a->middle, path, n);
+		return unpack(ch, a->middle, to, path, n);
+	}
+	if( path )
+		path[n] = ch_node(ch, to);
+	return n + 1;
+}
+
+static int build_path(const a_star_ch_t* ch, const a_star_search_ctx_t* forward,
+		const a_star_search_ctx_t* backward, a_star_id_t begin, a_star_id_t meet, a_star_node_t** path) {
+	a_star_id_t step, *chain;
+	int k, nchain, n;
+
+	// begin..meet is the forward chain reversed
+	for(step=meet, nchain=0; step != A_STAR_NONE; step=forward->prev[step])
+		nchain++;
+	chain = (a_star_id_t*)arena_alloc(forward->scratch, sizeof(a_star_id_t) * nchain);
+	for(step=meet, k=nchain; step != A_STAR_NONE; step=forward->prev[step])
+		chain[--k] = step;
+
+	if( path )
+		path[0] = ch_node(ch, begin);
+	for(k=1, n=1; k < nchain; k++)
+		n = unpack(ch, chain[k-1], chain[k], path, n);
+	for(step=meet; backward->prev[step] != A_STAR_NONE; step=backward->prev[step])
+		n = unpack(ch, step, backward->prev[step], path, n);
+	return n;
+}
+
+int a_star_ch_search(
+		const a_star_ch_t* ch,
+		a_star_search_ctx_t* forward,
+		a_star_search_ctx_t* backward,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_node_t*** path
+		) {
+	a_star_search_ctx_t* sides[2];
+	a_star_id_t idBegin, idEnd, meet=A_STAR_NONE;
+	long best=LONG_MAX;
+	int s, n=0;
+	size_t i;
+
+	// arguments validation
+	if( ! ch || ! forward || ! backward || forward == backward || ! begin || ! end || ! path )
+		return -1;
+	if( ch->nnodes > forward->capacity || ch->nnodes > backward->capacity )
+		return -1;
+	idBegin = NODE_ID(begin);
+	idEnd = NODE_ID(end);
+	if( idBegin >= ch->nnodes || idEnd >= ch->nnodes )
+		return -1;
+
+	// initialization
+	*path = 0;
+	sides[0] = forward;
+	sides[1] = backward;
+	for(s=0; s < 2; s++) {
+		a_star_id_t root = s ? idEnd : idBegin;
+		a_star_ctx_reset(sides[s]);
+		a_star_ctx_touch(sides[s], root);
+		sides[s]->g[root] = 0;
+		a_star_ctx_open(sides[s], root, 0);
+	}
+	A_STAR_STAT_PHASE(forward, initTime);
+
+	// both sides only climb, so they need not stop at the first meeting: each runs
+	// until its lowest key reaches the best meeting cost
+	for(s=0;; s = !s) {
+		a_star_search_ctx_t* ctx = sides[s];
+		if( pqueue_top_key(ctx->open) >= best ) {
+			ctx = sides[s = !s];
+			if( pqueue_top_key(ctx->open) >= best )
+				break;
+		}
+
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		ctx->closed[curr] = 1;
+		A_STAR_STAT(ctx, expansions);
+
+		const size_t* offsets = s ? ch->upOffsets : ch->downOffsets;
+		const ch_arc_t* arcs = s ? ch->up : ch->down;
+
+		// stall-on-demand: a higher node this side has reached already leads here
+		// more cheaply, so no shortest path goes up from this node
+		for(i=offsets[curr]; i < offsets[curr+1]; i++) {
+			long gHigher = a_star_ctx_g(ctx, arcs[i].node);
+			if( gHigher != LONG_MAX && gHigher + arcs[i].cost < ctx->g[curr] )
+				break;
+		}
+		if( i < offsets[curr+1] )
+			continue;
+
+		long gOther = a_star_ctx_g(sides[!s], curr);
+		if( gOther != LONG_MAX && ctx->g[curr] + gOther < best ) {
+			best = ctx->g[curr] + gOther;
+			meet = curr;
+		}
+
+		offsets = s ? ch->downOffsets : ch->upOffsets;
+		arcs = s ? ch->down : ch->up;
+		for(i=offsets[curr]; i < offsets[curr+1]; i++) {
+			a_star_id_t neighbor = arcs[i].node;
+			a_star_ctx_touch(ctx, neighbor);
+			long gCost = ctx->g[curr] + arcs[i].cost;
+			if( gCost < ctx->g[neighbor] ) {
+				ctx->g[neighbor] = gCost;
+				ctx->prev[neighbor] = curr;
+				a_star_ctx_open(ctx, neighbor, gCost);
+			}
+		}
+	}
+	A_STAR_STAT_PHASE(forward, searchTime);
+
+	if( meet != A_STAR_NONE ) {
+		n = build_path(ch, forward, backward, idBegin, meet, 0);
+		*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
+		build_path(ch, forward, backward, idBegin, meet, *path);
+	}
+	A_STAR_STAT_PHASE(forward, pathTime);
+
+	return n;
+}
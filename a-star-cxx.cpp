@@ -0,0 +1,138 @@
+// a-star-cxx.cpp
+// a_star_shortest_path() and a_star_shortest_path_ex() on top of the template
+// engine of a-star.hpp: the edge list is compiled into an astar::edge_list_graph
+// and searched by a loop instantiated for each open queue kind.
+
+#include <stdint.h>
+#include <new>
+#include <vector>
+#include "a-star.hpp"
+#include "a-star-internal.h"
+
+namespace {
+
+using graph_type = astar::edge_list_graph<long>;
+
+/**
+ * The caller's heuristic, which sees nodes as a_star_node_t pointers.
+ **/
+struct node_heuristic {
+	a_star_node_t** nodes;
+	a_star_node_t* end;
+	a_star_distance_func_t h_dist;
+	void* cookie;
+
+	long operator()(a_star_id_t n, a_star_id_t) const {
+		return (*h_dist)(nodes[n], end, cookie);
+	}
+};
+
+/**
+ * Reports every expansion, and every neighbour that is not closed, to the
+ * caller's progress function, if any.
+ **/
+struct progress_visitor {
+	a_star_node_t** nodes;
+	a_star_progress_func_t progress;
+	void* cookie;
+	a_star_progress_info_t info;
+
+	void expand(a_star_id_t n, long h) {
+		if( ! progress )
+			return;
+		// the first node expanded is the start
+		if( ! info.nframe++ )
+			info.maxDistance = h;
+		info.currDistance = h;
+		info.analized = info.current = nodes[n];
+		info.analizedId = info.currentId = n;
+		(*progress)(&info, cookie);
+	}
+	void examine(a_star_id_t n) {
+		if( ! progress )
+			return;
+		info.analized = nodes[n];
+		info.analizedId = n;
+		(*progress)(&info, cookie);
+	}
+};
+
+template<template<class, class> class Queue>
+int search(const graph_type& graph, const node_heuristic& h, progress_visitor& visitor,
+		a_star_id_t begin, a_star_id_t end, a_star_node_t*** path) {
+	astar::search<graph_type, node_heuristic, Queue> s(graph, h);
+	std::vector<a_star_id_t> steps;
+	size_t i;
+
+	if( ! s.run(begin, end, visitor) )
+		return 0;
+	s.path(end, std::back_inserter(steps));
+	*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * steps.size());
+	for(i=0; i < steps.size(); i++)
+		(*path)[i] = h.nodes[steps[i]];
+	return (int)steps.size();
+}
+
+} // namespace
+
+extern "C" int a_star_shortest_path(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t*** path
+		) {
+	return a_star_shortest_path_ex(graph, g_dist, h_dist, progress, cookie, aqHeap, path);
+}
+
+extern "C" int a_star_shortest_path_ex(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		) {
+	a_star_id_t begin, end;
+	size_t i;
+
+	// arguments validation
+	if( ! graph || ! graph->nodes || ! graph->edges || ! graph->begin || ! graph->end )
+		return -1;
+	if( ! g_dist || ! h_dist || ! path )
+		return -1;
+	if( graph->nnodes >= A_STAR_NONE )
+		return -1;
+
+	*path = 0;
+
+	// number the nodes, as a_star_graph_prepare() does
+	for(i=0; i < graph->nnodes; i++)
+		graph->nodes[i]->reserved = (void*)(uintptr_t)i;
+	begin = NODE_ID(graph->begin);
+	end = NODE_ID(graph->end);
+	if( begin >= graph->nnodes || end >= graph->nnodes )
+		return -1;
+
+	try {
+		graph_type g(graph->nnodes, graph->nedges, [graph, g_dist, cookie](size_t i) {
+			const a_star_edge_t* e = graph->edges[i];
+			return astar::edge<long>{NODE_ID(e->from), NODE_ID(e->to), e->cost + (*g_dist)(e->from, e->to, cookie)};
+		});
+		node_heuristic h = {graph->nodes, graph->end, h_dist, cookie};
+		progress_visitor visitor = {graph->nodes, progress, cookie, {0,0,0,0,0,0,0}};
+		switch( queue ) {
+			case aqList:
+				return search<astar::list_queue>(g, h, visitor, begin, end, path);
+			case aqBucket:
+				return search<astar::bucket_queue>(g, h, visitor, begin, end, path);
+			case aqHeap:
+			default:
+				return search<astar::dary_heap>(g, h, visitor, begin, end, path);
+		}
+	} catch( const std::bad_alloc& ) {
+		return -1;
+	}
+}
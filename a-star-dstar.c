@@ -0,0 +1,246 @@
+// a-star-dstar.c
+// D* Lite: incremental replanning on a grid whose cells change between plans.
+// The search runs from the goal towards the start, so the start may move and
+// only the part of the previous solution that a change invalidates is repaired.
+
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+struct _a_star_dstar_t {
+	a_star_grid_t grid;
+	size_t ncells;
+	a_star_id_t start, goal;
+	a_star_id_t last;	// start when km was last updated
+	a_star_heuristic_t heuristic;
+	long km;	// heuristic offset accumulated by moving the start
+	long *g, *rhs;	// goal distance, and its one-step lookahead
+	pqueue_t* open;	// inconsistent cells (g != rhs)
+};
+
+static inline long add_cost(long a, long b) {
+	return a == LONG_MAX || b == LONG_MAX ? LONG_MAX : a + b;
+}
+
+/**
+ * Cost of moving from cell 'from' to its neighbour in direction 'd', LONG_MAX if not allowed.
+ **/
+static long move_cost(const a_star_grid_t* grid, a_star_id_t from, int d) {
+	int row = from / grid->columns, column = from % grid->columns;
+	int r = row + a_star_dRows[d], c = column + a_star_dCols[d];
+	a_star_id_t to = A_STAR_GRID_ID(grid, r, c);
+	long step = A_STAR_STRAIGHT_COST;
+	if( A_STAR_GRID_BLOCKED(grid, from) || A_STAR_GRID_BLOCKED(grid, to) )
+		return LONG_MAX;
+	if( d >= 4 ) {
+		if( ! grid->cutCorners
+				&& (A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, row, c))
+					|| A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, r, column))) )
+			return LONG_MAX;
+		step = A_STAR_DIAGONAL_COST;
+	}
+	if( grid->cost && grid->cost[to] > 1 )
+		step *= grid->cost[to];
+	return step;
+}
+
+/**
+ * Neighbour of 'cell' in direction 'd', A_STAR_NONE if off the grid.
+ **/
+static inline a_star_id_t neighbor_at(const a_star_grid_t* grid, a_star_id_t cell, int d) {
+	int r = cell / grid->columns + a_star_dRows[d], c = cell % grid->columns + a_star_dCols[d];
+	if( r < 0 || r >= grid->rows || c < 0 || c >= grid->columns )
+		return A_STAR_NONE;
+	return A_STAR_GRID_ID(grid, r, c);
+}
+
+/**
+ * Queue key: min(g, rhs) plus the heuristic to the current start. The second
+ * key of D* Lite (min(g, rhs) alone) is not kept; instead every cell whose key
+ * ties with the start's is expanded before stopping.
+ **/
+static inline long calc_key(const a_star_dstar_t* x, a_star_id_t s) {
+	long m = x->g[s] < x->rhs[s] ? x->g[s] : x->rhs[s];
+	return add_cost(m, a_star_grid_heuristic(&x->grid, x->heuristic, x->start, s) + x->km);
+}
+
+static void update_vertex(a_star_dstar_t* x, a_star_id_t u) {
+	int d;
+	if( u != x->goal ) {
+		long best = LONG_MAX;
+		for(d=0; d < x->grid.connectivity; d++) {
+			a_star_id_t s = neighbor_at(&x->grid, u, d);
+			if( s == A_STAR_NONE )
+				continue;
+			long c = add_cost(move_cost(&x->grid, u, d), x->g[s]);
+			if( c < best )
+				best = c;
+		}
+		x->rhs[u] = best;
+	}
+	if( x->g[u] != x->rhs[u] )
+		pqueue_push(x->open, u, calc_key(x, u));
+	else
+		pqueue_remove(x->open, u);
+}
+
+/**
+ * Updates the cells that may lead into 'u', i.e. its neighbours.
+ **/
+static void update_predecessors(a_star_dstar_t* x, a_star_id_t u) {
+	int d;
+	for(d=0; d < x->grid.connectivity; d++) {
+		a_star_id_t p = neighbor_at(&x->grid, u, d);
+		if( p != A_STAR_NONE )
+			update_vertex(x, p);
+	}
+}
+
+static void compute_shortest_path(a_star_dstar_t* x, a_star_progress_func_t progress, void* cookie) {
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+	progressInfo.maxDistance = a_star_grid_heuristic(&x->grid, x->heuristic, x->start, x->goal);
+	progressInfo.analizedId = progressInfo.currentId = A_STAR_NONE;
+
+	while( pqueue_len(x->open)
+			&& (pqueue_top_key(x->open) <= calc_key(x, x->start) || x->rhs[x->start] != x->g[x->start]) ) {
+		long kOld = pqueue_top_key(x->open);
+		a_star_id_t u = pqueue_pop(x->open);
+		long kNew = calc_key(x, u);
+
+		if( progress ) {
+			progressInfo.nframe++;
+			progressInfo.currDistance = a_star_grid_heuristic(&x->grid, x->heuristic, x->start, u);
+			progressInfo.analizedId = progressInfo.currentId = u;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		if( kOld < kNew )
+			pqueue_push(x->open, u, kNew);	// key went stale as the start moved
+		else if( x->g[u] > x->rhs[u] ) {
+			x->g[u] = x->rhs[u];	// overconsistent: settle
+			update_predecessors(x, u);
+		} else {
+			x->g[u] = LONG_MAX;	// underconsistent: invalidate and recompute
+			update_vertex(x, u);
+			update_predecessors(x, u);
+		}
+	}
+}
+
+int a_star_dstar_init(const a_star_grid_t* grid, a_star_id_t begin, a_star_id_t end, a_star_dstar_t** planner) {
+	a_star_dstar_t* x;
+	size_t i;
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! planner )
+		return -1;
+	if( grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( grid->connectivity != 4 && grid->connectivity != 8 )
+		return -1;
+	if( (size_t)grid->rows * grid->columns >= A_STAR_NONE )
+		return -1;
+	if( begin >= (size_t)grid->rows * grid->columns || end >= (size_t)grid->rows * grid->columns )
+		return -1;
+
+	x = (a_star_dstar_t*)malloc(sizeof(a_star_dstar_t));
+	x->grid = *grid;
+	x->ncells = (size_t)grid->rows * grid->columns;
+	x->start = x->last = begin;
+	x->goal = end;
+	x->heuristic = a_star_grid_heuristic_kind(grid);
+	x->km = 0;
+	x->g = (long*)malloc(sizeof(long) * x->ncells);
+	x->rhs = (long*)malloc(sizeof(long) * x->ncells);
+	for(i=0; i < x->ncells; i++)
+		x->g[i] = x->rhs[i] = LONG_MAX;
+	pqueue_init(pqHeap, x->ncells, 0, &x->open);
+
+	x->rhs[end] = 0;
+	pqueue_push(x->open, end, calc_key(x, end));
+
+	*planner = x;
+	return 0;
+}
+
+void a_star_dstar_deinit(a_star_dstar_t* planner) {
+	if( ! planner )
+		return;
+	pqueue_deinit(planner->open);
+	free(planner->g);
+	free(planner->rhs);
+	free(planner);
+}
+
+int a_star_dstar_update(a_star_dstar_t* planner, const a_star_id_t* cells, size_t ncells) {
+	size_t i;
+	if( ! planner || (! cells && ncells) )
+		return -1;
+	for(i=0; i < ncells; i++) {
+		if( cells[i] >= planner->ncells )
+			return -1;
+		// edges into and out of the cell, and diagonals squeezing past it
+		update_vertex(planner, cells[i]);
+		update_predecessors(planner, cells[i]);
+	}
+	return 0;
+}
+
+int a_star_dstar_move(a_star_dstar_t* planner, a_star_id_t begin) {
+	if( ! planner || begin >= planner->ncells )
+		return -1;
+	planner->km += a_star_grid_heuristic(&planner->grid, planner->heuristic, planner->last, begin);
+	planner->last = planner->start = begin;
+	return 0;
+}
+
+int a_star_dstar_plan(a_star_dstar_t* planner, a_star_progress_func_t progress, void* cookie, a_star_id_t** path) {
+	a_star_dstar_t* x = planner;
+	a_star_id_t step;
+	size_t size = 64;
+	int n, d;
+
+	// arguments validation
+	if( ! planner || ! path )
+		return -1;
+
+	*path = 0;
+	if( A_STAR_GRID_BLOCKED(&x->grid, x->start) || A_STAR_GRID_BLOCKED(&x->grid, x->goal) )
+		return 0;
+	compute_shortest_path(x, progress, cookie);
+	if( x->g[x->start] == LONG_MAX )
+		return 0;
+
+	// descend g from the start; cells with equal g lie on equally short paths
+	*path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * size);
+	(*path)[0] = step = x->start;
+	for(n=1; step != x->goal && (size_t)n < x->ncells; n++) {
+		a_star_id_t next = A_STAR_NONE;
+		long best = LONG_MAX;
+		for(d=0; d < x->grid.connectivity; d++) {
+			a_star_id_t s = neighbor_at(&x->grid, step, d);
+			if( s == A_STAR_NONE )
+				continue;
+			long c = add_cost(move_cost(&x->grid, step, d), x->g[s]);
+			if( c < best ) {
+				best = c;
+				next = s;
+			}
+		}
+		if( next == A_STAR_NONE ) {
+			free(*path);
+			*path = 0;
+			return 0;
+		}
+		if( (size_t)n == size )
+			*path = (a_star_id_t*)realloc(*path, sizeof(a_star_id_t) * (size *= 2));
+		(*path)[n] = step = next;
+	}
+	if( step != x->goal ) {
+		free(*path);
+		*path = 0;
+		return -1;
+	}
+	*path = (a_star_id_t*)realloc(*path, sizeof(a_star_id_t) * n);
+	return n;
+}
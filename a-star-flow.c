@@ -0,0 +1,418 @@
+// a-star-flow.c
+// Flow field: the cost of the cheapest path from every grid cell to one goal,
+// and the first move of such a path, computed by parallel delta-stepping.
+// Any number of agents heading for the goal then read their paths off the
+// table, with no search at all.
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "tpool.h"
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	FLOW_NONE	UINT_MAX	// distance of an unreachable cell
+#define	FLOW_NO_MOVE	0xff	// direction at the goal and at unreachable cells
+#define	FLOW_DELTA	(4 * A_STAR_STRAIGHT_COST)	// bucket width; edges up to it are light
+#define	FLOW_CHUNK	256	// cells taken at a time by a worker
+#define	FLOW_CELLS_PER_WORKER	16384	// smaller grids use fewer workers
+
+struct _a_star_flow_t {
+	a_star_grid_t grid;	// obstacles and costs borrowed
+	a_star_id_t goal;
+	unsigned int* dist;	// per cell, FLOW_NONE if unreachable
+	unsigned char* next;	// per cell, direction of the first move (a_star_dRows order)
+};
+
+typedef struct _flow_list_t {
+	a_star_id_t* ids;
+	size_t n, capacity;
+} flow_list_t;
+
+typedef enum _flow_phase_t {
+	fpLight = 0,	// relax the light edges of the frontier, within the current bucket
+	fpHeavy,	// relax the heavy edges of the cells settled in the current bucket
+	fpDirections,	// pick the first move of every cell
+	fpDone,
+} flow_phase_t;
+
+typedef struct _flow_build_t {
+	a_star_flow_t* flow;
+	size_t ncells;
+	int nworkers;
+	int heavy;	// whether any edge is heavier than FLOW_DELTA
+	pthread_mutex_t start;	// held while the workers are being started
+	pthread_barrier_t barrier;
+	// the current round, set up by worker 0 between barriers
+	flow_phase_t phase;
+	flow_list_t *frontier, *next;
+	size_t nfrontier;
+	size_t cursor;	// next frontier entry to take, shared
+	flow_list_t* out;	// per worker: cells whose distance dropped in this round
+	// buckets of cells by distance / FLOW_DELTA, cyclic: all live ones are
+	// within the heaviest edge of the current one
+	flow_list_t* buckets;
+	size_t nslots, nqueued;
+	unsigned int current;
+	flow_list_t* settled;	// cells taken from the current bucket
+	unsigned int *frontierMark, *settledMark;	// dedupe the frontier and the settled list
+	unsigned int round;
+} flow_build_t;
+
+typedef struct _flow_worker_t {
+	flow_build_t* x;
+	int index;
+	pthread_t thread;
+} flow_worker_t;
+
+static inline void list_push(flow_list_t* l, a_star_id_t id) {
+	if( l->n == l->capacity ) {
+		l->capacity = l->capacity ? l->capacity * 2 : 256;
+		l->ids = (a_star_id_t*)realloc(l->ids, sizeof(a_star_id_t) * l->capacity);
+	}
+	l->ids[l->n++] = id;
+}
+
+/**
+ * Cost of the move from a neighbour into 'cell' in direction 'd': the grids
+ * charge the cell entered.
+ **/
+static inline unsigned int move_cost(const a_star_grid_t* grid, a_star_id_t cell, int d) {
+	unsigned int step = d >= 4 ? A_STAR_DIAGONAL_COST : A_STAR_STRAIGHT_COST;
+	if( grid->cost && grid->cost[cell] > 1 )
+		step *= grid->cost[cell];
+	return step;
+}
+
+/**
+ * Lowers '*d' to 'value' if that is less, racing other workers.
+ **/
+static inline int atomic_min(unsigned int* d, unsigned int value) {
+	unsigned int old = __atomic_load_n(d, __ATOMIC_RELAXED);
+	while( value < old )
+		if( __atomic_compare_exchange_n(d, &old, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+			return 1;
+	return 0;
+}
+
+/**
+ * Relaxes the light or the heavy edges into 'cell' (moves are symmetric, so its
+ * neighbours are the cells that may move into it).
+ **/
+static void relax(flow_build_t* x, int worker, a_star_id_t cell, int heavy) {
+	const a_star_grid_t* grid = &x->flow->grid;
+	unsigned int dCell = __atomic_load_n(&x->flow->dist[cell], __ATOMIC_RELAXED);
+	unsigned int moves = a_star_grid_moves(grid, cell);
+	int d;
+	for(d=0; d < grid->connectivity; d++) {
+		if( ! (moves & (1U << d)) )
+			continue;
+		unsigned int w = move_cost(grid, cell, d);
+		if( (w > FLOW_DELTA) != heavy )
+			continue;
+		a_star_id_t neighbor = cell + a_star_dRows[d] * grid->columns + a_star_dCols[d];
+		if( atomic_min(&x->flow->dist[neighbor], dCell + w) )
+			list_push(&x->out[worker], neighbor);
+	}
+}
+
+/**
+ * First move of the cheapest path from 'cell', once all distances are final.
+ **/
+static void direction(flow_build_t* x, a_star_id_t cell) {
+	const a_star_grid_t* grid = &x->flow->grid;
+	const unsigned int* dist = x->flow->dist;
+	unsigned int moves, best = FLOW_NONE;
+	int d;
+	x->flow->next[cell] = FLOW_NO_MOVE;
+	if( cell == x->flow->goal || dist[cell] == FLOW_NONE )
+		return;
+	moves = a_star_grid_moves(grid, cell);
+	for(d=0; d < grid->connectivity; d++) {
+		if( ! (moves & (1U << d)) )
+			continue;
+		a_star_id_t neighbor = cell + a_star_dRows[d] * grid->columns + a_star_dCols[d];
+		if( dist[neighbor] == FLOW_NONE )
+			continue;
+		unsigned int c = dist[neighbor] + move_cost(grid, neighbor, d);
+		if( c < best ) {
+			best = c;
+			x->flow->next[cell] = (unsigned char)d;
+		}
+	}
+}
+
+/**
+ * Moves the cells of the next non-empty bucket into the frontier.
+ * Returns 0 once every bucket is empty.
+ **/
+static int next_bucket(flow_build_t* x) {
+	const unsigned int* dist = x->flow->dist;
+	size_t i;
+	x->frontier->n = 0;
+	while( x->nqueued ) {
+		flow_list_t* b = &x->buckets[++x->current % x->nslots];
+		x->nqueued -= b->n;
+		// stale entries: cells that have since dropped into an earlier bucket
+		for(i=0; i < b->n; i++) {
+			a_star_id_t c = b->ids[i];
+			if( dist[c] / FLOW_DELTA == x->current && x->frontierMark[c] != x->round ) {
+				x->frontierMark[c] = x->round;
+				list_push(x->frontier, c);
+			}
+		}
+		b->n = 0;
+		if( x->frontier->n )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Worker 0's share between two rounds: files the cells that dropped in the last
+ * round, then sets up the next one.
+ **/
+static void plan(flow_build_t* x) {
+	const unsigned int* dist = x->flow->dist;
+	flow_list_t* swap;
+	size_t i;
+	int w;
+
+	x->round++;
+	x->next->n = 0;
+	for(w=0; w < x->nworkers; w++) {
+		for(i=0; i < x->out[w].n; i++) {
+			a_star_id_t c = x->out[w].ids[i];
+			unsigned int b = dist[c] / FLOW_DELTA;
+			if( b == x->current ) {
+				// only light edges lead back into the current bucket
+				if( x->frontierMark[c] != x->round ) {
+					x->frontierMark[c] = x->round;
+					list_push(x->next, c);
+				}
+			} else {
+				list_push(&x->buckets[b % x->nslots], c);
+				x->nqueued++;
+			}
+		}
+		x->out[w].n = 0;
+	}
+
+	switch( x->phase ) {
+		case fpLight:
+			if( x->next->n ) {
+				swap = x->frontier;
+				x->frontier = x->next;
+				x->next = swap;
+				break;
+			}
+			if( x->heavy ) {
+				// the settled cells are final: their heavy edges are relaxed once
+				swap = x->frontier;
+				x->frontier = x->settled;
+				x->settled = swap;
+				x->phase = fpHeavy;
+				break;
+			}
+			// fall through
+		case fpHeavy:
+			x->settled->n = 0;
+			x->phase = next_bucket(x) ? fpLight : fpDirections;
+			break;
+		case fpDirections:
+		case fpDone:
+			x->phase = fpDone;
+			break;
+	}
+
+	if( x->phase == fpLight )
+		for(i=0; i < x->frontier->n; i++) {
+			a_star_id_t c = x->frontier->ids[i];
+			if( x->settledMark[c] != x->current + 1 ) {
+				x->settledMark[c] = x->current + 1;
+				list_push(x->settled, c);
+			}
+		}
+	x->nfrontier = x->phase == fpDirections ? x->ncells : x->frontier->n;
+	x->cursor = 0;
+}
+
+static void work(flow_build_t* x, int worker) {
+	for(;;) {
+		size_t i, end;
+		pthread_barrier_wait(&x->barrier);
+		if( x->phase == fpDone )
+			break;
+		while( (i = __atomic_fetch_add(&x->cursor, FLOW_CHUNK, __ATOMIC_RELAXED)) < x->nfrontier ) {
+			end = i + FLOW_CHUNK < x->nfrontier ? i + FLOW_CHUNK : x->nfrontier;
+			for(; i < end; i++)
+				if( x->phase == fpDirections )
+					direction(x, (a_star_id_t)i);
+				else
+					relax(x, worker, x->frontier->ids[i], x->phase == fpHeavy);
+		}
+		pthread_barrier_wait(&x->barrier);
+		if( worker == 0 )
+			plan(x);
+	}
+}
+
+static void* worker_main(void* arg) {
+	flow_worker_t* w = (flow_worker_t*)arg;
+	// wait until the barrier is set up for the workers actually started
+	pthread_mutex_lock(&w->x->start);
+	pthread_mutex_unlock(&w->x->start);
+	work(w->x, w->index);
+	return 0;
+}
+
+/**
+ * Settles the distances from 'x->flow->goal' outwards, then the directions.
+ **/
+static void build(flow_build_t* x, int nthreads) {
+	flow_worker_t* workers;
+	flow_list_t lists[3];
+	int i, started;
+
+	memset(lists, 0, sizeof(lists));
+	x->frontier = &lists[0];
+	x->next = &lists[1];
+	x->settled = &lists[2];
+	x->frontierMark = (unsigned int*)calloc(x->ncells, sizeof(unsigned int));
+	x->settledMark = (unsigned int*)calloc(x->ncells, sizeof(unsigned int));
+	x->buckets = (flow_list_t*)calloc(x->nslots, sizeof(flow_list_t));
+	x->nqueued = 0;
+	x->round = 0;
+	x->nworkers = tpool_workers(nthreads, x->ncells / FLOW_CELLS_PER_WORKER + 1);
+	x->out = (flow_list_t*)calloc(x->nworkers, sizeof(flow_list_t));
+
+	// first round: the goal alone, in bucket 0
+	x->current = 0;
+	x->phase = fpLight;
+	if( A_STAR_GRID_BLOCKED(&x->flow->grid, x->flow->goal) )
+		x->phase = fpDirections;
+	else {
+		x->flow->dist[x->flow->goal] = 0;
+		list_push(x->frontier, x->flow->goal);
+		list_push(x->settled, x->flow->goal);
+		x->settledMark[x->flow->goal] = 1;
+	}
+	x->nfrontier = x->phase == fpDirections ? x->ncells : x->frontier->n;
+	x->cursor = 0;
+
+	// the calling thread is worker 0
+	workers = (flow_worker_t*)malloc(sizeof(flow_worker_t) * x->nworkers);
+	pthread_mutex_init(&x->start, 0);
+	pthread_mutex_lock(&x->start);
+	for(started=1; started < x->nworkers; started++) {
+		workers[started].x = x;
+		workers[started].index = started;
+		if( pthread_create(&workers[started].thread, 0, worker_main, &workers[started]) != 0 )
+			break;
+	}
+	x->nworkers = started;
+	pthread_barrier_init(&x->barrier, 0, x->nworkers);
+	pthread_mutex_unlock(&x->start);
+	work(x, 0);
+	for(i=1; i < started; i++)
+		pthread_join(workers[i].thread, 0);
+	pthread_barrier_destroy(&x->barrier);
+	pthread_mutex_destroy(&x->start);
+	free(workers);
+
+	for(i=0; i < (int)x->nslots; i++)
+		free(x->buckets[i].ids);
+	for(i=0; i < x->nworkers; i++)
+		free(x->out[i].ids);
+	free(x->out);
+	free(x->buckets);
+	for(i=0; i < 3; i++)
+		free(lists[i].ids);
+	free(x->frontierMark);
+	free(x->settledMark);
+}
+
+int a_star_flow_build(const a_star_grid_t* grid, a_star_id_t goal, int nthreads, a_star_flow_t** flow) {
+	a_star_flow_t* f;
+	flow_build_t x;
+	unsigned int maxCost = 1;
+	size_t i;
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! flow )
+		return -1;
+	if( grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( grid->connectivity != 4 && grid->connectivity != 8 )
+		return -1;
+	x.ncells = (size_t)grid->rows * grid->columns;
+	if( x.ncells >= A_STAR_NONE || goal >= x.ncells )
+		return -1;
+	if( grid->cost )
+		for(i=0; i < x.ncells; i++)
+			if( grid->cost[i] > maxCost )
+				maxCost = grid->cost[i];
+	// distances are 32-bit: no path may cost more
+	unsigned long long maxStep = (unsigned long long)(grid->connectivity == 8 ? A_STAR_DIAGONAL_COST : A_STAR_STRAIGHT_COST) * maxCost;
+	if( (x.ncells - 1) * maxStep >= FLOW_NONE )
+		return -1;
+
+	f = (a_star_flow_t*)malloc(sizeof(a_star_flow_t));
+	f->grid = *grid;
+	f->goal = goal;
+	f->dist = (unsigned int*)malloc(sizeof(unsigned int) * x.ncells);
+	f->next = (unsigned char*)malloc(x.ncells);
+	for(i=0; i < x.ncells; i++)
+		f->dist[i] = FLOW_NONE;
+
+	x.flow = f;
+	x.heavy = maxStep > FLOW_DELTA;
+	x.nslots = maxStep / FLOW_DELTA + 2;
+	build(&x, nthreads);
+
+	*flow = f;
+	return 0;
+}
+
+void a_star_flow_free(a_star_flow_t* flow) {
+	if( ! flow )
+		return;
+	free(flow->dist);
+	free(flow->next);
+	free(flow);
+}
+
+long a_star_flow_distance(const a_star_flow_t* flow, a_star_id_t cell) {
+	if( ! flow || cell >= (size_t)flow->grid.rows * flow->grid.columns )
+		return -1;
+	return flow->dist[cell] == FLOW_NONE ? -1 : (long)flow->dist[cell];
+}
+
+int a_star_flow_direction(const a_star_flow_t* flow, a_star_id_t cell) {
+	if( ! flow || cell >= (size_t)flow->grid.rows * flow->grid.columns )
+		return -1;
+	return flow->next[cell] == FLOW_NO_MOVE ? -1 : flow->next[cell];
+}
+
+int a_star_flow_path(const a_star_flow_t* flow, a_star_id_t begin, a_star_id_t** path) {
+	a_star_id_t step;
+	int i, n;
+
+	// arguments validation
+	if( ! flow || ! path || begin >= (size_t)flow->grid.rows * flow->grid.columns )
+		return -1;
+
+	*path = 0;
+	if( flow->dist[begin] == FLOW_NONE )
+		return 0;
+	for(step=begin, n=1; step != flow->goal; n++)
+		step += a_star_dRows[flow->next[step]] * flow->grid.columns + a_star_dCols[flow->next[step]];
+	*path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * n);
+	for(step=begin, i=0; i < n; i++) {
+		(*path)[i] = step;
+		if( step != flow->goal )
+			step += a_star_dRows[flow->next[step]] * flow->grid.columns + a_star_dCols[flow->next[step]];
+	}
+	return n;
+}
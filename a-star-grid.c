@@ -0,0 +1,173 @@
+// a-star-grid.c
+
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+const int a_star_dRows[8] = {-1, 0, 1, 0, -1, -1, 1, 1};
+const int a_star_dCols[8] = {0, 1, 0, -1, -1, 1, 1, -1};
+
+long a_star_heuristic(a_star_heuristic_t heuristic, long dRow, long dCol) {
+	return a_star_heuristic_at(heuristic, dRow, dCol);
+}
+
+/**
+ * The search, for one heuristic: inlined into grid_search() once per heuristic,
+ * which leaves no call nor switch in the loop to evaluate it.
+ **/
+A_STAR_INLINE int grid_search_h(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path,
+		a_star_id_t* buf,
+		size_t size,
+		a_star_heuristic_t heuristic
+		) {
+	size_t ncells;
+	int d, ndirs, n=0, complete=0;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! ctx )
+		return -1;
+	if( grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( grid->connectivity != 4 && grid->connectivity != 8 )
+		return -1;
+	ncells = (size_t)grid->rows * grid->columns;
+	if( ncells > ctx->capacity || begin >= ncells || end >= ncells )
+		return -1;
+
+	// initialization
+	ndirs = grid->connectivity;
+	progressInfo.maxDistance = a_star_grid_heuristic(grid, heuristic, begin, end);
+	progressInfo.analizedId = progressInfo.currentId = A_STAR_NONE;
+
+	if( path )
+		*path = 0;
+
+	if( A_STAR_GRID_BLOCKED(grid, begin) || A_STAR_GRID_BLOCKED(grid, end) )
+		return 0;
+
+	a_star_ctx_reset(ctx);
+
+	a_star_ctx_touch(ctx, begin);
+	ctx->g[begin] = 0;
+	ctx->h[begin] = ctx->f[begin] = a_star_grid_heuristic(grid, heuristic, begin, end);
+	A_STAR_STAT(ctx, heuristicCalls);
+	a_star_ctx_open(ctx, begin, ctx->f[begin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
+	for(;;) {
+		if( ! pqueue_len(ctx->open) )
+			break; // FAILED!
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		A_STAR_STAT(ctx, expansions);
+
+		if( progress && a_star_ctx_sampled(ctx, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analizedId = progressInfo.currentId = curr;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		ctx->closed[curr] = 1;
+
+		if( curr == end ) {
+			complete = 1;
+			break; // FINISH!
+		}
+
+		// neighbours are generated on the fly: 4 straight moves, then 4 diagonal ones,
+		// checked all at once against the obstacle bits around 'curr'
+		unsigned int moves = a_star_grid_moves(grid, curr);
+		for(d=0; d < ndirs; d++) {
+			if( ! (moves & (1U << d)) )
+				continue;
+			a_star_id_t neighbor = curr + a_star_dRows[d] * grid->columns + a_star_dCols[d];
+			long step = d >= 4 ? A_STAR_DIAGONAL_COST : A_STAR_STRAIGHT_COST;
+			if( grid->cost && grid->cost[neighbor] > 1 )
+				step *= grid->cost[neighbor];
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analizedId = neighbor;
+				(*progress)(&progressInfo, cookie);
+			}
+			long gCost = ctx->g[curr] + step;
+			if( gCost >= ctx->g[neighbor] )
+				continue;
+			if( ctx->h[neighbor] == LONG_MAX ) {
+				ctx->h[neighbor] = a_star_grid_heuristic(grid, heuristic, neighbor, end);
+				A_STAR_STAT(ctx, heuristicCalls);
+			}
+			ctx->g[neighbor] = gCost;
+			ctx->f[neighbor] = gCost + ctx->h[neighbor];
+			ctx->prev[neighbor] = curr;
+			a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+		}
+	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
+
+	if( complete )
+		n = a_star_ctx_path(ctx, end, path, buf, size);
+	A_STAR_STAT_PHASE(ctx, pathTime);
+
+	return n;
+}
+
+static int grid_search(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path,
+		a_star_id_t* buf,
+		size_t size
+		) {
+	if( ! grid )
+		return -1;
+	switch( a_star_grid_heuristic_kind(grid) ) {
+		case ahManhattan:
+			return grid_search_h(grid, ctx, begin, end, progress, cookie, path, buf, size, ahManhattan);
+		case ahChebyshev:
+			return grid_search_h(grid, ctx, begin, end, progress, cookie, path, buf, size, ahChebyshev);
+		case ahEuclidean:
+			return grid_search_h(grid, ctx, begin, end, progress, cookie, path, buf, size, ahEuclidean);
+		case ahOctile:
+		default:
+			return grid_search_h(grid, ctx, begin, end, progress, cookie, path, buf, size, ahOctile);
+	}
+}
+
+int a_star_grid_search(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		) {
+	if( ! path )
+		return -1;
+	return grid_search(grid, ctx, begin, end, progress, cookie, path, 0, 0);
+}
+
+int a_star_grid_search_buf(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t* buf,
+		size_t size
+		) {
+	if( ! buf && size )
+		return -1;
+	return grid_search(grid, ctx, begin, end, progress, cookie, 0, buf, size);
+}
@@ -0,0 +1,587 @@
+// a-star-hpa.c
+// HPA*: the grid is cut into square clusters joined by entrances on their
+// borders, and a small abstract graph of the entrances, weighted with the
+// distances across each cluster, is searched first. The abstract path is then
+// refined into cells one cluster at a time, and a change to the grid rebuilds
+// only the clusters around it.
+
+#include <limits.h>
+#include "tpool.h"
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	HPA_CLUSTER_SIZE	32	// default cluster side, in cells
+#define	HPA_WIDE_ENTRANCE	6	// runs of free border this long get an entrance at each end
+
+typedef struct _hpa_cluster_t {
+	int row, column, rows, columns;	// cells covered
+	a_star_id_t* entrances;	// cells, sorted
+	size_t nentrances;
+	long* dist;	// nentrances^2 distances across the cluster, LONG_MAX if none
+	size_t base;	// abstract node id of the first entrance
+} hpa_cluster_t;
+
+/**
+ * Per-worker state of the searches inside one cluster, by local cell index.
+ **/
+typedef struct _hpa_scratch_t {
+	long* dist;
+	unsigned int* prev;
+	pqueue_t* open;
+} hpa_scratch_t;
+
+struct _a_star_hpa_t {
+	a_star_grid_t grid;
+	int size;	// cluster side
+	int clusterRows, clusterColumns;
+	hpa_cluster_t* clusters;
+	size_t nclusters;
+	int nthreads;
+	hpa_scratch_t* scratch;	// per worker, the first one also serves the queries
+	int nscratch;
+	// abstract graph: entrances numbered cluster by cluster, then the start and the goal
+	size_t nnodes;
+	a_star_id_t* cells;	// per abstract node
+	unsigned int* owner;	// cluster of each abstract node
+	a_star_search_ctx_t* ctx;
+	unsigned char* dirty;	// per cluster, set by a_star_hpa_update()
+};
+
+static inline unsigned int cluster_of(const a_star_hpa_t* x, a_star_id_t cell) {
+	return (cell / x->grid.columns) / x->size * x->clusterColumns + (cell % x->grid.columns) / x->size;
+}
+static inline unsigned int local_index(const hpa_cluster_t* c, const a_star_grid_t* grid, a_star_id_t cell) {
+	return (cell / grid->columns - c->row) * c->columns + (cell % grid->columns - c->column);
+}
+static inline long step_cost(const a_star_grid_t* grid, a_star_id_t to, int d) {
+	long step = d >= 4 ? A_STAR_DIAGONAL_COST : A_STAR_STRAIGHT_COST;
+	if( grid->cost && grid->cost[to] > 1 )
+		step *= grid->cost[to];
+	return step;
+}
+
+/**
+ * Index of 'cell' among the entrances of 'c', or -1 if it is not one.
+ **/
+static long find_entrance(const hpa_cluster_t* c, a_star_id_t cell) {
+	size_t lo = 0, hi = c->nentrances;
+	while( lo < hi ) {
+		size_t mid = (lo + hi) / 2;
+		if( c->entrances[mid] < cell )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < c->nentrances && c->entrances[lo] == cell ? (long)lo : -1;
+}
+
+/**
+ * Dijkstra's algorithm from 'source' over the cells of cluster 'c' only, along
+ * the moves into it or, if 'reverse', out of it. Stops once 'target' is settled
+ * (A_STAR_NONE: never). Leaves the distances and back-links in 's'.
+ **/
+static void cluster_search(const a_star_hpa_t* x, hpa_scratch_t* s, const hpa_cluster_t* c,
+		a_star_id_t source, int reverse, a_star_id_t target) {
+	const a_star_grid_t* grid = &x->grid;
+	unsigned int i, ncells = c->rows * c->columns;
+	int d;
+
+	for(i=0; i < ncells; i++)
+		s->dist[i] = LONG_MAX;
+	pqueue_reset(s->open);
+	i = local_index(c, grid, source);
+	s->dist[i] = 0;
+	s->prev[i] = PQUEUE_NONE;
+	pqueue_push(s->open, i, 0);
+	while( pqueue_len(s->open) ) {
+		unsigned int u = pqueue_pop(s->open);
+		int row = u / c->columns, column = u % c->columns;
+		a_star_id_t cell = A_STAR_GRID_ID(grid, c->row + row, c->column + column);
+		unsigned int moves;
+		if( cell == target )
+			break;
+		moves = a_star_grid_moves(grid, cell);
+		for(d=0; d < grid->connectivity; d++) {
+			int r = row + a_star_dRows[d], col = column + a_star_dCols[d];
+			unsigned int v;
+			long cost;
+			if( ! (moves & (1U << d)) || r < 0 || r >= c->rows || col < 0 || col >= c->columns )
+				continue;
+			v = r * c->columns + col;
+			// moves are symmetric; a move is charged the cell it enters
+			cost = s->dist[u] + step_cost(grid, reverse ? cell : cell + a_star_dRows[d] * grid->columns + a_star_dCols[d], d);
+			if( cost < s->dist[v] ) {
+				s->dist[v] = cost;
+				s->prev[v] = u;
+				pqueue_push(s->open, v, cost);
+			}
+		}
+	}
+}
+
+/**
+ * Direction of the move by (dRow, dCol), in a_star_dRows order.
+ **/
+static int direction_of(int dRow, int dCol) {
+	int d;
+	for(d=0; d < 8 && (a_star_dRows[d] != dRow || a_star_dCols[d] != dCol); d++)
+		;
+	return d;
+}
+
+/**
+ * Adds the entrances on one side of 'c': 'length' cells from (row, column) on,
+ * facing those from (outRow, outColumn) on across the border. The cluster on
+ * the other side scans the same pairs, so both pick the same crossings.
+ **/
+static void side_entrances(const a_star_grid_t* grid, hpa_cluster_t* c,
+		int row, int column, int dRow, int dCol, int length, int outRow, int outColumn) {
+	int k, start = -1;
+	for(k=0; k <= length; k++) {
+		int open = k < length
+			&& ! A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, row + k*dRow, column + k*dCol))
+			&& ! A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, outRow + k*dRow, outColumn + k*dCol));
+		if( open && start < 0 )
+			start = k;
+		else if( ! open && start >= 0 ) {
+			// narrow runs get one entrance in their middle, wide ones one at each end
+			if( k - start < HPA_WIDE_ENTRANCE )
+				c->entrances[c->nentrances++] = A_STAR_GRID_ID(grid, row + (start + k-1)/2*dRow, column + (start + k-1)/2*dCol);
+			else {
+				c->entrances[c->nentrances++] = A_STAR_GRID_ID(grid, row + start*dRow, column + start*dCol);
+				c->entrances[c->nentrances++] = A_STAR_GRID_ID(grid, row + (k-1)*dRow, column + (k-1)*dCol);
+			}
+			start = -1;
+		}
+	}
+	if( grid->connectivity != 8 )
+		return;
+	// diagonal moves across the border where no straight one crosses next to them
+	for(k=0; k < length; k++) {
+		a_star_id_t cell = A_STAR_GRID_ID(grid, row + k*dRow, column + k*dCol);
+		unsigned int moves;
+		int side;
+		if( A_STAR_GRID_BLOCKED(grid, cell) || ! A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, outRow + k*dRow, outColumn + k*dCol)) )
+			continue;
+		moves = a_star_grid_moves(grid, cell);
+		for(side=-1; side <= 1; side += 2) {
+			int j = k + side;
+			if( j < 0 || j >= length || ! A_STAR_GRID_BLOCKED(grid, A_STAR_GRID_ID(grid, row + j*dRow, column + j*dCol)) )
+				continue;
+			if( moves & (1U << direction_of(outRow - row + side*dRow, outColumn - column + side*dCol)) ) {
+				c->entrances[c->nentrances++] = cell;
+				break;
+			}
+		}
+	}
+}
+
+static int cmp_ids(const void* i1, const void* i2) {
+	a_star_id_t id1 = *(const a_star_id_t*)i1, id2 = *(const a_star_id_t*)i2;
+	return id1 < id2 ? -1 : id1 > id2;
+}
+
+/**
+ * Finds the entrances of cluster 'index' and the distances between them.
+ **/
+static void build_cluster(int worker, size_t index, void* cookie) {
+	a_star_hpa_t* x = (a_star_hpa_t*)cookie;
+	const a_star_grid_t* grid = &x->grid;
+	hpa_cluster_t* c = &x->clusters[index];
+	hpa_scratch_t* s = &x->scratch[worker];
+	size_t i, j, n;
+	int d;
+
+	free(c->entrances);
+	free(c->dist);
+	// at most one entrance per two cells of a side and two for a side's one
+	// run, plus one per cell for diagonal crossings, and the 4 corners
+	c->entrances = (a_star_id_t*)malloc(sizeof(a_star_id_t) * (4 * (c->rows + c->columns) + 8));
+	c->nentrances = 0;
+	if( c->row > 0 )
+		side_entrances(grid, c, c->row, c->column, 0, 1, c->columns, c->row - 1, c->column);
+	if( c->row + c->rows < grid->rows )
+		side_entrances(grid, c, c->row + c->rows - 1, c->column, 0, 1, c->columns, c->row + c->rows, c->column);
+	if( c->column > 0 )
+		side_entrances(grid, c, c->row, c->column, 1, 0, c->rows, c->row, c->column - 1);
+	if( c->column + c->columns < grid->columns )
+		side_entrances(grid, c, c->row, c->column + c->columns - 1, 1, 0, c->rows, c->row, c->column + c->columns);
+	// corners, with a diagonal move to the cluster diagonally across
+	for(d=4; grid->connectivity == 8 && d < 8; d++) {
+		int r = a_star_dRows[d] < 0 ? c->row : c->row + c->rows - 1;
+		int col = a_star_dCols[d] < 0 ? c->column : c->column + c->columns - 1;
+		a_star_id_t cell = A_STAR_GRID_ID(grid, r, col);
+		if( ! A_STAR_GRID_BLOCKED(grid, cell) && (a_star_grid_moves(grid, cell) & (1U << d)) )
+			c->entrances[c->nentrances++] = cell;
+	}
+	// a corner cell may be an entrance of two sides
+	qsort(c->entrances, c->nentrances, sizeof(a_star_id_t), cmp_ids);
+	for(i=0, n=0; i < c->nentrances; i++)
+		if( ! n || c->entrances[i] != c->entrances[n-1] )
+			c->entrances[n++] = c->entrances[i];
+	c->nentrances = n;
+
+	c->dist = (long*)malloc(sizeof(long) * (n * n + 1));
+	for(i=0; i < n; i++) {
+		cluster_search(x, s, c, c->entrances[i], 0, A_STAR_NONE);
+		for(j=0; j < n; j++)
+			c->dist[i*n + j] = s->dist[local_index(c, grid, c->entrances[j])];
+	}
+}
+
+/**
+ * Numbers the entrances of all the clusters as abstract nodes, and makes room
+ * for the start and the goal in the search context.
+ **/
+static int number_nodes(a_star_hpa_t* x) {
+	size_t i, k, n = 0;
+	for(i=0; i < x->nclusters; i++) {
+		x->clusters[i].base = n;
+		n += x->clusters[i].nentrances;
+	}
+	if( n + 2 >= A_STAR_NONE )
+		return -1;
+	free(x->cells);
+	free(x->owner);
+	x->nnodes = n;
+	x->cells = (a_star_id_t*)malloc(sizeof(a_star_id_t) * (n + 2));
+	x->owner = (unsigned int*)malloc(sizeof(unsigned int) * (n + 2));
+	for(i=0; i < x->nclusters; i++)
+		for(k=0; k < x->clusters[i].nentrances; k++) {
+			x->cells[x->clusters[i].base + k] = x->clusters[i].entrances[k];
+			x->owner[x->clusters[i].base + k] = (unsigned int)i;
+		}
+	if( ! x->ctx || x->ctx->capacity < n + 2 ) {
+		a_star_search_ctx_deinit(x->ctx);
+		x->ctx = 0;
+		if( a_star_search_ctx_init(n + 2 + n / 4, aqHeap, &x->ctx) < 0 )
+			return -1;
+	}
+	return 0;
+}
+
+int a_star_hpa_build(const a_star_grid_t* grid, int clusterSize, int nthreads, a_star_hpa_t** hpa) {
+	a_star_hpa_t* x;
+	size_t i;
+	int w, cells;
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! hpa )
+		return -1;
+	if( grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( grid->connectivity != 4 && grid->connectivity != 8 )
+		return -1;
+	if( clusterSize <= 0 )
+		clusterSize = HPA_CLUSTER_SIZE;
+	if( clusterSize < 2 || clusterSize > 4096 )
+		return -1;
+
+	x = (a_star_hpa_t*)calloc(1, sizeof(a_star_hpa_t));
+	x->grid = *grid;
+	x->size = clusterSize;
+	x->clusterRows = (grid->rows + clusterSize - 1) / clusterSize;
+	x->clusterColumns = (grid->columns + clusterSize - 1) / clusterSize;
+	x->nclusters = (size_t)x->clusterRows * x->clusterColumns;
+	x->clusters = (hpa_cluster_t*)calloc(x->nclusters, sizeof(hpa_cluster_t));
+	x->dirty = (unsigned char*)calloc(x->nclusters, 1);
+	for(i=0; i < x->nclusters; i++) {
+		hpa_cluster_t* c = &x->clusters[i];
+		c->row = (int)(i / x->clusterColumns) * clusterSize;
+		c->column = (int)(i % x->clusterColumns) * clusterSize;
+		c->rows = grid->rows - c->row < clusterSize ? grid->rows - c->row : clusterSize;
+		c->columns = grid->columns - c->column < clusterSize ? grid->columns - c->column : clusterSize;
+	}
+
+	x->nthreads = nthreads;
+	x->nscratch = tpool_workers(nthreads, x->nclusters);
+	if( x->nscratch < 1 )
+		x->nscratch = 1;
+	x->scratch = (hpa_scratch_t*)calloc(x->nscratch, sizeof(hpa_scratch_t));
+	cells = clusterSize * clusterSize;
+	for(w=0; w < x->nscratch; w++) {
+		x->scratch[w].dist = (long*)malloc(sizeof(long) * cells);
+		x->scratch[w].prev = (unsigned int*)malloc(sizeof(unsigned int) * cells);
+		pqueue_init(pqBucket, cells, 0, &x->scratch[w].open);
+	}
+
+	// clusters are independent of each other
+	if( tpool_run(x->nscratch, x->nclusters, build_cluster, x) < 0 || number_nodes(x) < 0 ) {
+		a_star_hpa_free(x);
+		return -1;
+	}
+
+	*hpa = x;
+	return 0;
+}
+
+void a_star_hpa_free(a_star_hpa_t* hpa) {
+	size_t i;
+	int w;
+	if( ! hpa )
+		return;
+	for(i=0; i < hpa->nclusters; i++) {
+		free(hpa->clusters[i].entrances);
+		free(hpa->clusters[i].dist);
+	}
+	free(hpa->clusters);
+	for(w=0; w < hpa->nscratch; w++) {
+		free(hpa->scratch[w].dist);
+		free(hpa->scratch[w].prev);
+		pqueue_deinit(hpa->scratch[w].open);
+	}
+	free(hpa->scratch);
+	free(hpa->cells);
+	free(hpa->owner);
+	free(hpa->dirty);
+	a_star_search_ctx_deinit(hpa->ctx);
+	free(hpa);
+}
+
+typedef struct _hpa_rebuild_t {
+	a_star_hpa_t* x;
+	size_t* clusters;
+} hpa_rebuild_t;
+
+static void rebuild_cluster(int worker, size_t index, void* cookie) {
+	hpa_rebuild_t* r = (hpa_rebuild_t*)cookie;
+	build_cluster(worker, r->clusters[index], r->x);
+}
+
+int a_star_hpa_update(a_star_hpa_t* hpa, const a_star_id_t* cells, size_t ncells) {
+	a_star_hpa_t* x = hpa;
+	hpa_rebuild_t r;
+	size_t i, n, total;
+	int d;
+
+	if( ! hpa || (! cells && ncells) )
+		return -1;
+	total = (size_t)x->grid.rows * x->grid.columns;
+	for(i=0; i < ncells; i++)
+		if( cells[i] >= total )
+			return -1;
+
+	// a cell takes part in the moves of its 8 neighbours, which may be in
+	// other clusters; and the entrances of a cluster depend on its neighbours
+	for(i=0; i < ncells; i++) {
+		int row = cells[i] / x->grid.columns, column = cells[i] % x->grid.columns;
+		for(d=-1; d < 8; d++) {
+			int r = row + (d < 0 ? 0 : a_star_dRows[d]), c = column + (d < 0 ? 0 : a_star_dCols[d]);
+			if( r >= 0 && r < x->grid.rows && c >= 0 && c < x->grid.columns )
+				x->dirty[cluster_of(x, A_STAR_GRID_ID(&x->grid, r, c))] |= 1;
+		}
+	}
+	for(i=0; i < x->nclusters; i++) {
+		int cr = (int)(i / x->clusterColumns), cc = (int)(i % x->clusterColumns);
+		if( ! (x->dirty[i] & 1) )
+			continue;
+		for(d=0; d < 4; d++) {
+			int r = cr + a_star_dRows[d], c = cc + a_star_dCols[d];
+			if( r >= 0 && r < x->clusterRows && c >= 0 && c < x->clusterColumns )
+				x->dirty[r * x->clusterColumns + c] |= 2;
+		}
+	}
+
+	r.x = x;
+	r.clusters = (size_t*)malloc(sizeof(size_t) * x->nclusters);
+	for(i=0, n=0; i < x->nclusters; i++)
+		if( x->dirty[i] ) {
+			r.clusters[n++] = i;
+			x->dirty[i] = 0;
+		}
+	if( n && (tpool_run(x->nscratch, n, rebuild_cluster, &r) < 0 || number_nodes(x) < 0) ) {
+		free(r.clusters);
+		return -1;
+	}
+	free(r.clusters);
+	return 0;
+}
+
+size_t a_star_hpa_nodes(const a_star_hpa_t* hpa) {
+	return hpa ? hpa->nnodes : 0;
+}
+
+/**
+ * Appends the cells of the cheapest path from 'from' to 'to' inside cluster
+ * 'c', without 'from', to the path being built.
+ **/
+static void refine(const a_star_hpa_t* x, const hpa_cluster_t* c, a_star_id_t from, a_star_id_t to,
+		a_star_id_t** path, size_t* n, size_t* size) {
+	hpa_scratch_t* s = &x->scratch[0];
+	unsigned int u, k, i;
+	cluster_search(x, s, c, from, 0, to);
+	for(k=0, u=local_index(c, &x->grid, to); s->prev[u] != PQUEUE_NONE; u=s->prev[u], k++)
+		;
+	if( *n + k > *size ) {
+		while( *n + k > *size )
+			*size *= 2;
+		*path = (a_star_id_t*)realloc(*path, sizeof(a_star_id_t) * *size);
+	}
+	for(i=0, u=local_index(c, &x->grid, to); i < k; u=s->prev[u], i++)
+		(*path)[*n + k-1 - i] = A_STAR_GRID_ID(&x->grid, c->row + u / c->columns, c->column + u % c->columns);
+	*n += k;
+}
+
+int a_star_hpa_search(
+		a_star_hpa_t* hpa,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		) {
+	a_star_hpa_t* x = hpa;
+	const a_star_grid_t* grid;
+	a_star_search_ctx_t* ctx;
+	a_star_heuristic_t heuristic;
+	const hpa_cluster_t *cBegin, *cEnd;
+	a_star_id_t idBegin, idEnd, *abstract=0;
+	long *beginDist, *endDist;
+	size_t i, n, size;
+	int k, nabstract, complete=0;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+
+	// arguments validation
+	if( ! hpa || ! path )
+		return -1;
+	grid = &x->grid;
+	if( begin >= (size_t)grid->rows * grid->columns || end >= (size_t)grid->rows * grid->columns )
+		return -1;
+
+	// initialization
+	*path = 0;
+	if( A_STAR_GRID_BLOCKED(grid, begin) || A_STAR_GRID_BLOCKED(grid, end) )
+		return 0;
+	ctx = x->ctx;
+	heuristic = a_star_grid_heuristic_kind(grid);
+	progressInfo.maxDistance = a_star_grid_heuristic(grid, heuristic, begin, end);
+	progressInfo.analizedId = progressInfo.currentId = A_STAR_NONE;
+	a_star_ctx_reset(ctx);
+
+	// the start and the goal join the abstract graph through the entrances of
+	// their clusters, and each other directly when they share one
+	idBegin = (a_star_id_t)x->nnodes;
+	idEnd = idBegin + 1;
+	cBegin = &x->clusters[cluster_of(x, begin)];
+	cEnd = &x->clusters[cluster_of(x, end)];
+	beginDist = (long*)arena_alloc(ctx->scratch, sizeof(long) * (cBegin->nentrances + 1));
+	endDist = (long*)arena_alloc(ctx->scratch, sizeof(long) * (cEnd->nentrances + 1));
+	cluster_search(x, &x->scratch[0], cBegin, begin, 0, A_STAR_NONE);
+	for(i=0; i < cBegin->nentrances; i++)
+		beginDist[i] = x->scratch[0].dist[local_index(cBegin, grid, cBegin->entrances[i])];
+	beginDist[cBegin->nentrances] = cBegin == cEnd ? x->scratch[0].dist[local_index(cBegin, grid, end)] : LONG_MAX;
+	cluster_search(x, &x->scratch[0], cEnd, end, 1, A_STAR_NONE);
+	for(i=0; i < cEnd->nentrances; i++)
+		endDist[i] = x->scratch[0].dist[local_index(cEnd, grid, cEnd->entrances[i])];
+	x->cells[idBegin] = begin;
+	x->cells[idEnd] = end;
+
+	a_star_ctx_touch(ctx, idBegin);
+	ctx->g[idBegin] = 0;
+	ctx->h[idBegin] = ctx->f[idBegin] = progressInfo.maxDistance;
+	a_star_ctx_open(ctx, idBegin, ctx->f[idBegin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
+	while( pqueue_len(ctx->open) ) {
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		a_star_id_t cell = x->cells[curr];
+		const hpa_cluster_t* c;
+		size_t nedges;
+		A_STAR_STAT(ctx, expansions);
+
+		if( progress && a_star_ctx_sampled(ctx, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analizedId = progressInfo.currentId = cell;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		ctx->closed[curr] = 1;
+
+		if( curr == idEnd ) {
+			complete = 1;
+			break; // FINISH!
+		}
+
+		// edges: across the cluster, out of it in one move, and to the goal
+		c = curr == idBegin ? cBegin : &x->clusters[x->owner[curr]];
+		nedges = c->nentrances + 9;
+		for(i=0; i < nedges; i++) {
+			a_star_id_t neighbor;
+			long cost;
+			if( i < c->nentrances ) {
+				neighbor = (a_star_id_t)(c->base + i);
+				cost = curr == idBegin ? beginDist[i] : c->dist[(curr - c->base) * c->nentrances + i];
+			} else if( i < c->nentrances + 8 ) {
+				int d = (int)(i - c->nentrances);
+				a_star_id_t to;
+				const hpa_cluster_t* other;
+				long e;
+				if( curr == idBegin || d >= grid->connectivity || ! (a_star_grid_moves(grid, cell) & (1U << d)) )
+					continue;
+				to = cell + a_star_dRows[d] * grid->columns + a_star_dCols[d];
+				other = &x->clusters[cluster_of(x, to)];
+				if( other == c || (e = find_entrance(other, to)) < 0 )
+					continue;
+				neighbor = (a_star_id_t)(other->base + e);
+				cost = step_cost(grid, to, d);
+			} else {
+				neighbor = idEnd;
+				if( curr == idBegin )
+					cost = beginDist[c->nentrances];
+				else
+					cost = c == cEnd ? endDist[curr - c->base] : LONG_MAX;
+			}
+			if( cost == LONG_MAX || neighbor == curr )
+				continue;
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analizedId = x->cells[neighbor];
+				(*progress)(&progressInfo, cookie);
+			}
+			long gCost = ctx->g[curr] + cost;
+			if( gCost >= ctx->g[neighbor] )
+				continue;
+			if( ctx->h[neighbor] == LONG_MAX ) {
+				ctx->h[neighbor] = a_star_grid_heuristic(grid, heuristic, x->cells[neighbor], end);
+				A_STAR_STAT(ctx, heuristicCalls);
+			}
+			ctx->g[neighbor] = gCost;
+			ctx->f[neighbor] = gCost + ctx->h[neighbor];
+			ctx->prev[neighbor] = curr;
+			a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+		}
+	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
+
+	if( ! complete )
+		return 0;
+
+	// refinement: only the clusters the abstract path crosses are searched again
+	nabstract = a_star_ctx_path(ctx, idEnd, &abstract, 0, 0);
+	size = 64;
+	*path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * size);
+	(*path)[0] = begin;
+	n = 1;
+	for(k=1; k < nabstract; k++) {
+		a_star_id_t from = x->cells[abstract[k-1]], to = x->cells[abstract[k]];
+		unsigned int cFrom = cluster_of(x, from);
+		if( from == to )
+			continue;
+		if( cFrom == cluster_of(x, to) )
+			refine(x, &x->clusters[cFrom], from, to, path, &n, &size);
+		else {
+			if( n == size )
+				*path = (a_star_id_t*)realloc(*path, sizeof(a_star_id_t) * (size *= 2));
+			(*path)[n++] = to;
+		}
+	}
+	free(abstract);
+	A_STAR_STAT_PHASE(ctx, pathTime);
+
+	return (int)n;
+}
+
+int a_star_hpa_stats(const a_star_hpa_t* hpa, a_star_stats_t* stats) {
+	if( ! hpa )
+		return -1;
+	return a_star_search_ctx_stats(hpa->ctx, stats);
+}
@@ -0,0 +1,295 @@
+// a-star-internal.h
+// shared by the search engines of the a-star library; not part of its API.
+
+#ifndef _A_STAR_INTERNAL_H_
+#define _A_STAR_INTERNAL_H_
+
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "arena.h"
+#include "pqueue.h"
+#include "a-star.h"
+
+#define	NODE_ID(n)	((a_star_id_t)(uintptr_t)(n)->reserved)
+
+// for the search loops copied per compile-time constant argument
+#if defined(__GNUC__)
+#	define	A_STAR_INLINE	static inline __attribute__((always_inline))
+#else
+#	define	A_STAR_INLINE	static inline
+#endif
+
+struct _a_star_search_ctx_t {
+	size_t capacity;
+	long *g, *h, *f;
+	a_star_id_t* prev;
+	unsigned char* closed;
+	unsigned int* stamp;	// generation a node's state was last initialised in
+	unsigned int generation;
+	pqueue_t* open;
+	pool_t* listNodes;	// dlist nodes of a list-based open queue
+	arena_t* scratch;	// per-query temporary memory, rewound by a_star_ctx_reset()
+	unsigned int progressEvery;	// expansions per progress report, see a_star_search_ctx_progress_every()
+	a_star_stats_t stats;	// counters of the current query
+	unsigned long long phaseStart;	// when the current phase began, in ns
+	a_star_batch_distance_func_t hBatch;	// see a_star_search_ctx_batch_heuristic()
+	a_star_id_t* batchIds;	// nodes waiting for their estimate, batchCapacity of them
+	long* batchH;
+	size_t batchCapacity;
+};
+
+static inline unsigned long long a_star_clock_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Search statistics: the A_STAR_STAT*() macros compile to nothing when the library
+ * is built with A_STAR_NO_STATS defined.
+ **/
+#ifndef A_STAR_NO_STATS
+/**
+ * Charges the time elapsed since the previous phase ended to 'phase'.
+ **/
+static inline void a_star_ctx_phase(a_star_search_ctx_t* ctx, unsigned long long* phase) {
+	unsigned long long now = a_star_clock_ns();
+	*phase += now - ctx->phaseStart;
+	ctx->phaseStart = now;
+}
+
+#define	A_STAR_STAT(ctx, field)	((ctx)->stats.field++)
+#define	A_STAR_STAT_PHASE(ctx, field)	a_star_ctx_phase((ctx), &(ctx)->stats.field)
+#else
+#define	A_STAR_STAT(ctx, field)	((void)0)
+#define	A_STAR_STAT_PHASE(ctx, field)	((void)0)
+#endif
+
+/**
+ * Starts a new query generation, which makes every node unvisited in O(1),
+ * empties the open queue and rewinds scratch memory.
+ **/
+void a_star_ctx_reset(a_star_search_ctx_t* ctx);
+
+/**
+ * Initialises the state of a node on first touch within the current generation.
+ * Must precede any access to the node's state.
+ **/
+static inline void a_star_ctx_touch(a_star_search_ctx_t* ctx, a_star_id_t n) {
+	if( ctx->stamp[n] != ctx->generation ) {
+		ctx->stamp[n] = ctx->generation;
+		ctx->g[n] = ctx->h[n] = ctx->f[n] = LONG_MAX;
+		ctx->prev[n] = A_STAR_NONE;
+		ctx->closed[n] = 0;
+	}
+}
+
+/**
+ * Inserts a node into the open queue, or lowers its key if it is already there;
+ * a closed node is re-opened. The node must have been touched.
+ **/
+static inline void a_star_ctx_open(a_star_search_ctx_t* ctx, a_star_id_t n, long key) {
+#ifndef A_STAR_NO_STATS
+	if( pqueue_exists(ctx->open, n) )
+		A_STAR_STAT(ctx, decreaseKeys);
+	else {
+		A_STAR_STAT(ctx, pushes);
+		if( ctx->closed[n] )
+			A_STAR_STAT(ctx, reopens);
+	}
+#endif
+	ctx->closed[n] = 0;
+	pqueue_push(ctx->open, n, key);
+#ifndef A_STAR_NO_STATS
+	if( pqueue_len(ctx->open) > ctx->stats.maxOpen )
+		ctx->stats.maxOpen = pqueue_len(ctx->open);
+#endif
+}
+
+/**
+ * Whether expansion number 'nframe' (counted from 1) is reported to the progress callback.
+ * Neighbours are only reported when every expansion is.
+ **/
+static inline int a_star_ctx_sampled(const a_star_search_ctx_t* ctx, long nframe) {
+	return ctx->progressEvery <= 1 || nframe % ctx->progressEvery == 0;
+}
+
+/**
+ * G-cost of a node in the current generation, without touching it.
+ **/
+static inline long a_star_ctx_g(const a_star_search_ctx_t* ctx, a_star_id_t n) {
+	return ctx->stamp[n] == ctx->generation ? ctx->g[n] : LONG_MAX;
+}
+
+/**
+ * Follows the back-links from 'end' into a newly allocated array of node ids when
+ * 'path' is given, otherwise into 'buf' provided it fits.
+ * Returns the number of steps either way.
+ **/
+int a_star_ctx_path(const a_star_search_ctx_t* ctx, a_star_id_t end, a_star_id_t** path, a_star_id_t* buf, size_t size);
+
+/**
+ * Node with index 'n' of a prepared or a loaded graph.
+ **/
+static inline a_star_node_t* a_star_csr_node_at(const a_star_csr_t* csr, a_star_id_t n) {
+	return csr->nodes ? csr->nodes[n] : &csr->handles[n];
+}
+
+/**
+ * Unmaps a graph loaded by a_star_csr_load().
+ **/
+void a_star_csr_unmap(a_star_csr_t* csr);
+
+/**
+ * Grid move directions: N, E, S, W (straight), then NW, NE, SE, SW (diagonal).
+ **/
+extern const int a_star_dRows[8];
+extern const int a_star_dCols[8];
+
+/**
+ * Octile (8-connected) or Manhattan (4-connected) distance between two grid cells,
+ * in A_STAR_STRAIGHT_COST / A_STAR_DIAGONAL_COST units.
+ **/
+static inline long a_star_grid_distance(const a_star_grid_t* grid, a_star_id_t n1, a_star_id_t n2) {
+	long dRow = labs((long)(n1 / grid->columns) - (long)(n2 / grid->columns));
+	long dCol = labs((long)(n1 % grid->columns) - (long)(n2 % grid->columns));
+	if( grid->connectivity != 8 )
+		return A_STAR_STRAIGHT_COST * (dRow + dCol);
+	return dRow < dCol
+		? A_STAR_DIAGONAL_COST * dRow + A_STAR_STRAIGHT_COST * (dCol - dRow)
+		: A_STAR_DIAGONAL_COST * dCol + A_STAR_STRAIGHT_COST * (dRow - dCol);
+}
+
+static inline long a_star_isqrt(long n) {
+	long r = (long)sqrt((double)n);
+	// the double root may be off by one for large n
+	while( r * r > n )
+		r--;
+	while( (r + 1) * (r + 1) <= n )
+		r++;
+	return r;
+}
+
+/**
+ * Built-in heuristic between cells 'dRow' rows and 'dCol' columns apart; folds
+ * into a single formula when 'heuristic' is a constant.
+ **/
+static inline long a_star_heuristic_at(a_star_heuristic_t heuristic, long dRow, long dCol) {
+	long lo, hi;
+	dRow = labs(dRow);
+	dCol = labs(dCol);
+	lo = dRow < dCol ? dRow : dCol;
+	hi = dRow < dCol ? dCol : dRow;
+	switch( heuristic ) {
+		case ahManhattan:
+			return A_STAR_STRAIGHT_COST * (dRow + dCol);
+		case ahChebyshev:
+			return A_STAR_STRAIGHT_COST * hi;
+		case ahEuclidean:
+			// sqrt(2) * A_STAR_DIAGONAL_COST / 2 per unit: never more than the octile distance
+			return a_star_isqrt(A_STAR_DIAGONAL_COST * A_STAR_DIAGONAL_COST / 2 * (dRow * dRow + dCol * dCol));
+		case ahOctile:
+		default:
+			return A_STAR_DIAGONAL_COST * lo + A_STAR_STRAIGHT_COST * (hi - lo);
+	}
+}
+
+/**
+ * The grid's heuristic with ahDefault resolved.
+ **/
+static inline a_star_heuristic_t a_star_grid_heuristic_kind(const a_star_grid_t* grid) {
+	if( grid->heuristic != ahDefault )
+		return grid->heuristic;
+	return grid->connectivity == 8 ? ahOctile : ahManhattan;
+}
+
+/**
+ * Heuristic 'heuristic' between two grid cells.
+ **/
+static inline long a_star_grid_heuristic(const a_star_grid_t* grid, a_star_heuristic_t heuristic,
+		a_star_id_t n1, a_star_id_t n2) {
+	return a_star_heuristic_at(heuristic,
+		(long)(n1 / grid->columns) - (long)(n2 / grid->columns),
+		(long)(n1 % grid->columns) - (long)(n2 % grid->columns));
+}
+
+/**
+ * Obstacle bits of at least 57 consecutive cells starting at cell 'id' (bit k for
+ * cell id+k, running on into the next rows), read a word at a time. Bits past
+ * the end of the grid read as blocked.
+ **/
+static inline uint64_t a_star_grid_word(const a_star_grid_t* grid, size_t id) {
+	size_t byte = id >> 3, size = A_STAR_GRID_BITMAP_SIZE(grid->rows, grid->columns);
+	uint64_t w;
+	if( byte + 8 <= size ) {
+		memcpy(&w, grid->obstacles + byte, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		w = __builtin_bswap64(w);
+#endif
+	} else {
+		size_t i;
+		for(i=0, w=0; i < 8; i++)
+			w |= (uint64_t)(byte + i < size ? grid->obstacles[byte + i] : 0xFF) << (8 * i);
+		// the padding bits of the last byte are not cells
+		if( (size_t)grid->rows * grid->columns < (byte + 8) * 8 )
+			w |= ~0ULL << ((size_t)grid->rows * grid->columns - byte * 8);
+	}
+	return w >> (id & 7) | ~(~0ULL >> (id & 7));
+}
+
+/**
+ * Obstacle bits of the 57 cells of row 'row' from column 'column' on (bit k for
+ * column+k); cells off the grid, on either side, read as blocked.
+ **/
+static inline uint64_t a_star_grid_row_bits(const a_star_grid_t* grid, int row, int column) {
+	const uint64_t all = (1ULL << 57) - 1;
+	uint64_t w;
+	if( row < 0 || row >= grid->rows || column <= -57 || column >= grid->columns )
+		return all;
+	if( column >= 0 )
+		w = a_star_grid_word(grid, A_STAR_GRID_ID(grid, row, column));
+	else
+		w = a_star_grid_word(grid, A_STAR_GRID_ID(grid, row, 0)) << -column | ((1ULL << -column) - 1);
+	if( grid->columns - column < 57 )
+		w |= ~0ULL << (grid->columns - column);
+	return w & all;
+}
+
+/**
+ * Moves allowed from cell 'id' (bit d for direction d, in a_star_dRows order),
+ * from the 3x3 block of obstacle bits around it.
+ **/
+static inline unsigned int a_star_grid_moves(const a_star_grid_t* grid, a_star_id_t id) {
+	int row = id / grid->columns, column = id % grid->columns;
+	unsigned int f;
+	// free cells: bits 0-2 the row above, 3-5 this row, 6-8 the row below, west to east
+	if( row > 0 && row < grid->rows-1 && column > 0 && column < grid->columns-1 ) {
+		// inside the grid, each 3-cell run spans at most two bytes
+		const unsigned char* o = grid->obstacles;
+		size_t nw = id - grid->columns - 1, w = id - 1, sw = id + grid->columns - 1;
+		f = ~(((o[nw >> 3] | o[(nw + 2) >> 3] << 8) >> (nw & 7) & 7)
+			| ((o[w >> 3] | o[(w + 2) >> 3] << 8) >> (w & 7) & 7) << 3
+			| ((o[sw >> 3] | o[(sw + 2) >> 3] << 8) >> (sw & 7) & 7) << 6);
+	} else
+		f = ~((unsigned int)(a_star_grid_row_bits(grid, row-1, column-1) & 7)
+			| (unsigned int)(a_star_grid_row_bits(grid, row, column-1) & 7) << 3
+			| (unsigned int)(a_star_grid_row_bits(grid, row+1, column-1) & 7) << 6);
+	unsigned int n = f >> 1 & 1, e = f >> 5 & 1, s = f >> 7 & 1, w = f >> 3 & 1;
+	unsigned int moves = n | e << 1 | s << 2 | w << 3;
+	if( grid->connectivity == 8 ) {
+		unsigned int nw = f & 1, ne = f >> 2 & 1, se = f >> 8 & 1, sw = f >> 6 & 1;
+		if( ! grid->cutCorners ) {
+			nw &= n & w;
+			ne &= n & e;
+			se &= s & e;
+			sw &= s & w;
+		}
+		moves |= nw << 4 | ne << 5 | se << 6 | sw << 7;
+	}
+	return moves;
+}
+
+#endif
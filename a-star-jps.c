@@ -0,0 +1,396 @@
+// a-star-jps.c
+// Jump Point Search (Harabor & Grastien) and JPS+ for uniform-cost 8-connected grids,
+// where diagonal moves may cut corners.
+
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+struct _a_star_jps_t {
+	int rows, columns;
+	int* jumps;	// 8 per cell: >0 steps to a jump point, <=0 steps to a wall
+};
+
+#define	DIR_BIT(d)	(1U << (d))
+
+static inline int sign(int a) { return (a > 0) - (a < 0); }
+
+// direction index by (dRow+1, dCol+1), -1 for no move
+static const int dirIndex[3][3] = {
+	{4, 0, 5},
+	{3, -1, 1},
+	{7, 2, 6},
+};
+
+static inline int dir_of(int dRow, int dCol) {
+	return dirIndex[dRow+1][dCol+1];
+}
+
+static inline int walkable(const a_star_grid_t* g, int r, int c) {
+	return r >= 0 && r < g->rows && c >= 0 && c < g->columns
+		&& ! A_STAR_GRID_BLOCKED(g, A_STAR_GRID_ID(g, r, c));
+}
+
+/**
+ * Whether cell (r, c), entered moving (dr, dc), has a forced neighbour.
+ **/
+static inline int has_forced(const a_star_grid_t* g, int r, int c, int dr, int dc) {
+	if( dr && dc )
+		return (! walkable(g, r, c-dc) && walkable(g, r+dr, c-dc))
+			|| (! walkable(g, r-dr, c) && walkable(g, r-dr, c+dc));
+	if( dr )
+		return (! walkable(g, r, c-1) && walkable(g, r+dr, c-1))
+			|| (! walkable(g, r, c+1) && walkable(g, r+dr, c+1));
+	return (! walkable(g, r-1, c) && walkable(g, r-1, c+dc))
+		|| (! walkable(g, r+1, c) && walkable(g, r+1, c+dc));
+}
+
+/**
+ * Directions worth following from (r, c) when it was reached moving in 'dir'
+ * (natural plus forced neighbours); all directions for the start node.
+ **/
+static unsigned int pruned_dirs(const a_star_grid_t* g, int r, int c, int dir) {
+	unsigned int mask;
+	int dr, dc;
+	if( dir < 0 )
+		return 0xFF;
+	dr = a_star_dRows[dir];
+	dc = a_star_dCols[dir];
+	mask = DIR_BIT(dir);
+	if( dr && dc ) {
+		mask |= DIR_BIT(dir_of(dr, 0)) | DIR_BIT(dir_of(0, dc));
+		if( ! walkable(g, r, c-dc) )
+			mask |= DIR_BIT(dir_of(dr, -dc));
+		if( ! walkable(g, r-dr, c) )
+			mask |= DIR_BIT(dir_of(-dr, dc));
+	} else if( dr ) {
+		if( ! walkable(g, r, c-1) )
+			mask |= DIR_BIT(dir_of(dr, -1));
+		if( ! walkable(g, r, c+1) )
+			mask |= DIR_BIT(dir_of(dr, 1));
+	} else {
+		if( ! walkable(g, r-1, c) )
+			mask |= DIR_BIT(dir_of(-1, dc));
+		if( ! walkable(g, r+1, c) )
+			mask |= DIR_BIT(dir_of(1, dc));
+	}
+	return mask;
+}
+
+/**
+ * Horizontal jump from (r, c), scanning 56 cells of the row (and of the rows
+ * next to it, for forced neighbours) per step.
+ **/
+static a_star_id_t jump_row(const a_star_grid_t* g, int r, int c, int dc, int goalRow, int goalCol) {
+	const uint64_t window = (1ULL << 56) - 1;
+	for(;;) {
+		uint64_t wall, forced, up, down;
+		int first, kWall, kStop;
+		if( dc > 0 ) {
+			// bits 0..55 are columns c+1..c+56, bit 56 looks one cell ahead
+			first = c + 1;
+			wall = a_star_grid_row_bits(g, r, first) & window;
+			up = a_star_grid_row_bits(g, r-1, first);
+			down = a_star_grid_row_bits(g, r+1, first);
+			// blocked beside, free beside and ahead
+			forced = ((up & ~(up >> 1)) | (down & ~(down >> 1))) & window;
+			kWall = wall ? __builtin_ctzll(wall) : 64;
+			kStop = forced ? __builtin_ctzll(forced) : 64;
+			// the goal only counts within the window, where the walls are seen
+			if( r == goalRow && goalCol >= first && goalCol - first < 56 && goalCol - first < kStop )
+				kStop = goalCol - first;
+			if( kWall < 64 && kWall <= kStop )
+				return A_STAR_NONE;	// a wall comes first
+			if( kStop < 64 )
+				return A_STAR_GRID_ID(g, r, first + kStop);
+			c += 56;
+		} else {
+			// bits 1..56 are columns c-56..c-1, bit 0 looks one cell ahead
+			first = c - 57;
+			wall = a_star_grid_row_bits(g, r, first) & (window << 1);
+			up = a_star_grid_row_bits(g, r-1, first);
+			down = a_star_grid_row_bits(g, r+1, first);
+			forced = ((up & ~(up << 1)) | (down & ~(down << 1))) & (window << 1);
+			kWall = wall ? 63 - __builtin_clzll(wall) : -1;
+			kStop = forced ? 63 - __builtin_clzll(forced) : -1;
+			if( r == goalRow && goalCol < c && goalCol - first > kStop && goalCol - first >= 1 )
+				kStop = goalCol - first;
+			if( kWall >= 0 && kWall >= kStop )
+				return A_STAR_NONE;
+			if( kStop >= 0 )
+				return A_STAR_GRID_ID(g, r, first + kStop);
+			c -= 56;
+		}
+	}
+}
+
+/**
+ * Moves from (r, c) in direction (dr, dc) until reaching the goal, a jump point or a wall.
+ * Returns the jump point, or A_STAR_NONE.
+ **/
+static a_star_id_t jump(const a_star_grid_t* g, int r, int c, int dr, int dc, int goalRow, int goalCol) {
+	if( ! dr )
+		return jump_row(g, r, c, dc, goalRow, goalCol);
+	for(;;) {
+		r += dr;
+		c += dc;
+		if( ! walkable(g, r, c) )
+			return A_STAR_NONE;
+		if( (r == goalRow && c == goalCol) || has_forced(g, r, c, dr, dc) )
+			return A_STAR_GRID_ID(g, r, c);
+		if( dr && dc
+				&& (jump(g, r, c, dr, 0, goalRow, goalCol) != A_STAR_NONE
+					|| jump(g, r, c, 0, dc, goalRow, goalCol) != A_STAR_NONE) )
+			return A_STAR_GRID_ID(g, r, c);
+	}
+}
+
+/**
+ * JPS+: the successor of (r, c) in direction 'dir' using the precomputed jump distances,
+ * stopping early where the goal lies on (or is aligned with) the jump.
+ **/
+static a_star_id_t jump_plus(const a_star_grid_t* g, const a_star_jps_t* jps, int r, int c, int dir, int goalRow, int goalCol) {
+	int dr = a_star_dRows[dir], dc = a_star_dCols[dir];
+	int dist = jps->jumps[(size_t)A_STAR_GRID_ID(g, r, c) * 8 + dir];
+	int reach = dist > 0 ? dist : -dist;
+	int toRow = goalRow - r, toCol = goalCol - c;
+	if( dr && dc ) {
+		// goal within this quadrant: stop where it gets aligned with the goal's row or column
+		if( sign(toRow) == dr && sign(toCol) == dc ) {
+			int k = abs(toRow) < abs(toCol) ? abs(toRow) : abs(toCol);
+			if( k <= reach )
+				return A_STAR_GRID_ID(g, r + k*dr, c + k*dc);
+		}
+	} else if( (dr && toCol == 0 && sign(toRow) == dr && abs(toRow) <= reach)
+			|| (dc && toRow == 0 && sign(toCol) == dc && abs(toCol) <= reach) ) {
+		return A_STAR_GRID_ID(g, goalRow, goalCol);
+	}
+	if( dist <= 0 )
+		return A_STAR_NONE;
+	return A_STAR_GRID_ID(g, r + dist*dr, c + dist*dc);
+}
+
+static int supported(const a_star_grid_t* grid) {
+	return grid->connectivity == 8 && grid->cutCorners && ! grid->cost;
+}
+
+int a_star_jps_prepare(const a_star_grid_t* grid, a_star_jps_t** jps) {
+	a_star_jps_t* x;
+	int r, c, d;
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! jps || grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( ! supported(grid) )
+		return -1;
+
+	x = (a_star_jps_t*)malloc(sizeof(a_star_jps_t));
+	x->rows = grid->rows;
+	x->columns = grid->columns;
+	x->jumps = (int*)malloc(sizeof(int) * 8 * (size_t)grid->rows * grid->columns);
+
+	// straight directions: scan each line against the direction of travel
+	for(d=0; d < 4; d++) {
+		int dr = a_star_dRows[d], dc = a_star_dCols[d];
+		int nlines = dr ? grid->columns : grid->rows;
+		int length = dr ? grid->rows : grid->columns;
+		int line, k;
+		for(line=0; line < nlines; line++) {
+			int count = -1, seen = 0;
+			for(k=0; k < length; k++) {
+				// walk from the far end of the line, towards its start
+				int pos = (dr > 0 || dc > 0) ? length - 1 - k : k;
+				r = dr ? pos : line;
+				c = dr ? line : pos;
+				int* dist = &x->jumps[(size_t)A_STAR_GRID_ID(grid, r, c) * 8 + d];
+				if( ! walkable(grid, r, c) ) {
+					count = -1;
+					seen = 0;
+					*dist = 0;
+					continue;
+				}
+				count++;
+				*dist = seen ? count : -count;
+				if( has_forced(grid, r, c, dr, dc) ) {
+					count = 0;
+					seen = 1;
+				}
+			}
+		}
+	}
+
+	// diagonal directions: the next cell along the diagonal is always computed first
+	for(d=4; d < 8; d++) {
+		int dr = a_star_dRows[d], dc = a_star_dCols[d];
+		int i, j;
+		for(i=0; i < grid->rows; i++) {
+			r = dr < 0 ? i : grid->rows - 1 - i;
+			for(j=0; j < grid->columns; j++) {
+				c = dc < 0 ? j : grid->columns - 1 - j;
+				int* dist = &x->jumps[(size_t)A_STAR_GRID_ID(grid, r, c) * 8 + d];
+				int nr = r + dr, nc = c + dc;
+				if( ! walkable(grid, r, c) || ! walkable(grid, nr, nc) ) {
+					*dist = 0;
+					continue;
+				}
+				const int* next = &x->jumps[(size_t)A_STAR_GRID_ID(grid, nr, nc) * 8];
+				if( has_forced(grid, nr, nc, dr, dc)
+						|| next[dir_of(dr, 0)] > 0 || next[dir_of(0, dc)] > 0 )
+					*dist = 1;
+				else
+					*dist = next[d] > 0 ? next[d] + 1 : next[d] - 1;
+			}
+		}
+	}
+
+	*jps = x;
+	return 0;
+}
+
+void a_star_jps_free(a_star_jps_t* jps) {
+	if( ! jps )
+		return;
+	free(jps->jumps);
+	free(jps);
+}
+
+/**
+ * Expands a path of jump points into consecutive grid cells.
+ **/
+static int fill_path(const a_star_grid_t* grid, const a_star_id_t* jumps, int njumps, a_star_id_t** path) {
+	int i, n=1;
+	for(i=1; i < njumps; i++) {
+		int dRow = abs((int)(jumps[i] / grid->columns) - (int)(jumps[i-1] / grid->columns));
+		int dCol = abs((int)(jumps[i] % grid->columns) - (int)(jumps[i-1] % grid->columns));
+		n += dRow > dCol ? dRow : dCol;
+	}
+	*path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * n);
+	(*path)[0] = jumps[0];
+	for(i=1, n=1; i < njumps; i++) {
+		int r = jumps[i-1] / grid->columns, c = jumps[i-1] % grid->columns;
+		int toRow = jumps[i] / grid->columns, toCol = jumps[i] % grid->columns;
+		int dr = sign(toRow - r), dc = sign(toCol - c);
+		while( r != toRow || c != toCol ) {
+			r += dr;
+			c += dc;
+			(*path)[n++] = A_STAR_GRID_ID(grid, r, c);
+		}
+	}
+	return n;
+}
+
+int a_star_jps_search(
+		const a_star_grid_t* grid,
+		const a_star_jps_t* jps,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		) {
+	size_t ncells;
+	int d, goalRow, goalCol, n=0, complete=0;
+	a_star_heuristic_t heuristic;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+
+	// arguments validation
+	if( ! grid || ! grid->obstacles || ! ctx || ! path )
+		return -1;
+	if( grid->rows <= 0 || grid->columns <= 0 )
+		return -1;
+	if( jps && (jps->rows != grid->rows || jps->columns != grid->columns) )
+		return -1;
+	if( ! supported(grid) )
+		return a_star_grid_search(grid, ctx, begin, end, progress, cookie, path);
+	ncells = (size_t)grid->rows * grid->columns;
+	if( ncells > ctx->capacity || begin >= ncells || end >= ncells )
+		return -1;
+
+	// initialization
+	goalRow = end / grid->columns;
+	goalCol = end % grid->columns;
+	heuristic = a_star_grid_heuristic_kind(grid);
+	progressInfo.maxDistance = a_star_grid_heuristic(grid, heuristic, begin, end);
+	progressInfo.analizedId = progressInfo.currentId = A_STAR_NONE;
+
+	*path = 0;
+
+	if( A_STAR_GRID_BLOCKED(grid, begin) || A_STAR_GRID_BLOCKED(grid, end) )
+		return 0;
+
+	a_star_ctx_reset(ctx);
+
+	a_star_ctx_touch(ctx, begin);
+	ctx->g[begin] = 0;
+	ctx->h[begin] = ctx->f[begin] = a_star_grid_heuristic(grid, heuristic, begin, end);
+	A_STAR_STAT(ctx, heuristicCalls);
+	a_star_ctx_open(ctx, begin, ctx->f[begin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
+	for(;;) {
+		if( ! pqueue_len(ctx->open) )
+			break; // FAILED!
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		int row = curr / grid->columns, column = curr % grid->columns;
+		A_STAR_STAT(ctx, expansions);
+
+		if( progress && a_star_ctx_sampled(ctx, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analizedId = progressInfo.currentId = curr;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		ctx->closed[curr] = 1;
+
+		if( curr == end ) {
+			complete = 1;
+			break; // FINISH!
+		}
+
+		// the direction 'curr' was reached from decides which directions are followed
+		int parentDir = -1;
+		if( ctx->prev[curr] != A_STAR_NONE ) {
+			a_star_id_t p = ctx->prev[curr];
+			parentDir = dir_of(sign(row - (int)(p / grid->columns)), sign(column - (int)(p % grid->columns)));
+		}
+		unsigned int dirs = pruned_dirs(grid, row, column, parentDir);
+
+		for(d=0; d < 8; d++) {
+			if( ! (dirs & DIR_BIT(d)) )
+				continue;
+			a_star_id_t neighbor = jps
+				? jump_plus(grid, jps, row, column, d, goalRow, goalCol)
+				: jump(grid, row, column, a_star_dRows[d], a_star_dCols[d], goalRow, goalCol);
+			if( neighbor == A_STAR_NONE )
+				continue;
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analizedId = neighbor;
+				(*progress)(&progressInfo, cookie);
+			}
+			// jump points lie on a straight or diagonal line, so the octile distance is exact
+			long gCost = ctx->g[curr] + a_star_grid_distance(grid, curr, neighbor);
+			if( gCost >= ctx->g[neighbor] )
+				continue;
+			if( ctx->h[neighbor] == LONG_MAX ) {
+				ctx->h[neighbor] = a_star_grid_heuristic(grid, heuristic, neighbor, end);
+				A_STAR_STAT(ctx, heuristicCalls);
+			}
+			ctx->g[neighbor] = gCost;
+			ctx->f[neighbor] = gCost + ctx->h[neighbor];
+			ctx->prev[neighbor] = curr;
+			a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+		}
+	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
+
+	if( complete ) {
+		int njumps = a_star_ctx_path(ctx, end, 0, 0, 0);
+		a_star_id_t* jumps = (a_star_id_t*)arena_alloc(ctx->scratch, sizeof(a_star_id_t) * njumps);
+		a_star_ctx_path(ctx, end, 0, jumps, njumps);
+		n = fill_path(grid, jumps, njumps, path);
+	}
+	A_STAR_STAT_PHASE(ctx, pathTime);
+
+	return n;
+}
@@ -0,0 +1,195 @@
+// a-star-map.c
+// Streaming readers for grid map files: MovingAI benchmark maps (.map) and binary
+// PGM occupancy grids (P5). Only one row is held in memory at a time.
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "a-star.h"
+
+typedef enum _map_format_t {
+	mfMovingAI	= 0,
+	mfPgm	= 1,
+} map_format_t;
+
+struct _a_star_map_reader_t {
+	FILE* f;
+	map_format_t format;
+	int rows, columns;
+	int row;	// next row to read
+	int maxval;	// PGM only; samples are 2 bytes wide above 255
+	unsigned char* line;	// raw row
+};
+
+/**
+ * Skips white space and '#' comments between PGM header fields.
+ **/
+static int pgm_skip(FILE* f) {
+	int c;
+	for(;;) {
+		c = getc(f);
+		if( c == '#' )
+			while( (c = getc(f)) != '\n' && c != EOF )
+				;
+		if( c == EOF || ! isspace(c) )
+			return c;
+	}
+}
+
+static int pgm_number(FILE* f, int* n) {
+	int c = pgm_skip(f);
+	if( ! isdigit(c) )
+		return -1;
+	for(*n=0; isdigit(c); c=getc(f)) {
+		if( *n > (0x7fffffff - 9) / 10 )
+			return -1;
+		*n = *n * 10 + (c - '0');
+	}
+	// a single white space character ends the last field, the raster follows
+	return isspace(c) ? 0 : -1;
+}
+
+/**
+ * MovingAI header: "type <name>", "height <n>", "width <n>", then "map".
+ **/
+static int movingai_header(FILE* f, int* rows, int* columns) {
+	char key[16];
+	int n;
+	*rows = *columns = -1;
+	for(;;) {
+		if( fscanf(f, "%15s", key) != 1 )
+			return -1;
+		if( strcmp(key, "map") == 0 )
+			break;
+		if( strcmp(key, "type") == 0 ) {
+			if( fscanf(f, "%15s", key) != 1 )
+				return -1;
+		} else if( strcmp(key, "height") == 0 || strcmp(key, "width") == 0 ) {
+			if( fscanf(f, "%d", &n) != 1 )
+				return -1;
+			*(key[0] == 'h' ? rows : columns) = n;
+		} else
+			return -1;
+	}
+	// rest of the "map" line
+	while( (n = getc(f)) != '\n' && n != EOF )
+		;
+	return 0;
+}
+
+int a_star_map_open(const char* file, a_star_map_reader_t** reader, int* rows, int* columns) {
+	a_star_map_reader_t* x;
+	char magic[2];
+	FILE* f;
+	int ok;
+
+	// arguments validation
+	if( ! file || ! reader || ! rows || ! columns )
+		return -1;
+	if( ! (f = fopen(file, "rb")) )
+		return -1;
+
+	x = (a_star_map_reader_t*)malloc(sizeof(a_star_map_reader_t));
+	x->f = f;
+	x->row = 0;
+	x->maxval = 0;
+	x->line = 0;
+	if( fread(magic, 1, 2, f) == 2 && magic[0] == 'P' && magic[1] == '5' ) {
+		x->format = mfPgm;
+		ok = pgm_number(f, &x->columns) == 0 && pgm_number(f, &x->rows) == 0
+			&& pgm_number(f, &x->maxval) == 0 && x->maxval > 0 && x->maxval < 65536;
+	} else {
+		x->format = mfMovingAI;
+		ok = fseek(f, 0, SEEK_SET) == 0 && movingai_header(f, &x->rows, &x->columns) == 0;
+	}
+	if( ! ok || x->rows <= 0 || x->columns <= 0 || (size_t)x->rows * x->columns >= A_STAR_NONE ) {
+		a_star_map_close(x);
+		return -1;
+	}
+	x->line = (unsigned char*)malloc((size_t)x->columns * (x->maxval > 255 ? 2 : 1));
+
+	*reader = x;
+	*rows = x->rows;
+	*columns = x->columns;
+	return 0;
+}
+
+int a_star_map_read_row(a_star_map_reader_t* reader, unsigned char* blocked) {
+	int c, i;
+
+	if( ! reader || ! blocked )
+		return -1;
+	if( reader->row == reader->rows )
+		return 0;
+
+	if( reader->format == mfPgm ) {
+		int wide = reader->maxval > 255;
+		if( fread(reader->line, wide ? 2 : 1, reader->columns, reader->f) != (size_t)reader->columns )
+			return -1;
+		// free only when clearly bright: occupied and unknown (mid grey) cells are blocked
+		for(i=0; i < reader->columns; i++) {
+			long p = wide ? (reader->line[2*i] << 8) | reader->line[2*i+1] : reader->line[i];
+			blocked[i] = (reader->maxval - p) * 1000 >= 196L * reader->maxval;
+		}
+	} else {
+		if( fread(reader->line, 1, reader->columns, reader->f) != (size_t)reader->columns )
+			return -1;
+		// '.', 'G' and 'S' are passable; '@', 'O', 'T' and 'W' are not
+		for(i=0; i < reader->columns; i++) {
+			c = reader->line[i];
+			blocked[i] = c != '.' && c != 'G' && c != 'S';
+		}
+		// end of line, whatever its convention
+		while( (c = getc(reader->f)) != '\n' && c != EOF )
+			;
+	}
+
+	reader->row++;
+	return 1;
+}
+
+void a_star_map_close(a_star_map_reader_t* reader) {
+	if( ! reader )
+		return;
+	fclose(reader->f);
+	free(reader->line);
+	free(reader);
+}
+
+int a_star_map_load(const char* file, a_star_grid_t* grid) {
+	a_star_map_reader_t* reader;
+	unsigned char *obstacles, *blocked;
+	int rows, columns, r, c;
+
+	if( ! grid )
+		return -1;
+	if( a_star_map_open(file, &reader, &rows, &columns) < 0 )
+		return -1;
+
+	obstacles = (unsigned char*)calloc(A_STAR_GRID_BITMAP_SIZE(rows, columns), 1);
+	blocked = (unsigned char*)malloc(columns);
+	for(r=0; r < rows; r++) {
+		if( a_star_map_read_row(reader, blocked) != 1 ) {
+			free(blocked);
+			free(obstacles);
+			a_star_map_close(reader);
+			return -1;
+		}
+		for(c=0; c < columns; c++)
+			if( blocked[c] ) {
+				size_t id = (size_t)r * columns + c;
+				obstacles[id >> 3] |= 1U << (id & 7);
+			}
+	}
+	free(blocked);
+	a_star_map_close(reader);
+
+	grid->rows = rows;
+	grid->columns = columns;
+	grid->obstacles = obstacles;
+	grid->cost = 0;
+	grid->connectivity = 8;
+	grid->cutCorners = 0;	// the MovingAI benchmarks' octile moves
+	grid->heuristic = ahDefault;
+	return 0;
+}
@@ -0,0 +1,226 @@
+// a-star-mmap.c
+// On-disk form of a prepared graph: its arrays exactly as laid out in memory, so
+// that a loaded graph is mapped and searched in place.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+#define	CSR_MAGIC	"ASTRCSR"
+#define	CSR_VERSION	1
+#define	CSR_BYTE_ORDER	0x01020304U
+#define	CSR_ALIGN	64	// sections start on cache line boundaries
+
+typedef struct _a_star_csr_header_t {
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder;	// CSR_BYTE_ORDER as written, tells a foreign byte order apart
+	unsigned char idSize, offsetSize, costSize, nodeSize;	// sizes of the stored types
+	unsigned int dims;
+	unsigned long long nnodes, nedges;
+} a_star_csr_header_t;
+
+typedef enum _csr_section_t {
+	csHandles = 0,	// a_star_node_t per node, numbered
+	csOffsets,	// nnodes+1 size_t
+	csTo,	// nedges a_star_id_t
+	csCost,	// nedges long
+	csReverseOffsets,	// nnodes+1 size_t
+	csFrom,	// nedges a_star_id_t
+	csReverseCost,	// nedges long
+	csCoords,	// nnodes*dims long
+	csEnd
+} csr_section_t;
+
+typedef struct _csr_mapping_t {
+	a_star_csr_t csr;	// first, so that a_star_csr_free() can find the mapping
+	void* base;
+	size_t size;
+} csr_mapping_t;
+
+static inline unsigned long long align(unsigned long long n) {
+	return (n + CSR_ALIGN - 1) & ~(unsigned long long)(CSR_ALIGN - 1);
+}
+
+/**
+ * File offset of every section, plus the file size at 'at[csEnd]'.
+ **/
+static void layout(unsigned long long nnodes, unsigned long long nedges, unsigned long long dims,
+		unsigned long long at[csEnd+1]) {
+	unsigned long long size[csEnd];
+	int s;
+	size[csHandles] = nnodes * sizeof(a_star_node_t);
+	size[csOffsets] = size[csReverseOffsets] = (nnodes + 1) * sizeof(size_t);
+	size[csTo] = size[csFrom] = nedges * sizeof(a_star_id_t);
+	size[csCost] = size[csReverseCost] = nedges * sizeof(long);
+	size[csCoords] = nnodes * dims * sizeof(long);
+	at[0] = align(sizeof(a_star_csr_header_t));
+	for(s=0; s < csEnd; s++)
+		at[s+1] = align(at[s] + size[s]);
+}
+
+static int write_padded(FILE* f, const void* data, size_t size, unsigned long long end) {
+	static const char zeros[CSR_ALIGN];
+	long pad;
+	if( size && fwrite(data, size, 1, f) != 1 )
+		return -1;
+	pad = (long)(end - ftell(f));
+	return pad > 0 && fwrite(zeros, pad, 1, f) != 1 ? -1 : 0;
+}
+
+int a_star_csr_save(const a_star_csr_t* csr, const long* coords, size_t dims, const char* file) {
+	a_star_csr_header_t header;
+	unsigned long long at[csEnd+1];
+	a_star_node_t handles[1024];
+	size_t i, k;
+	FILE* f;
+	int ok;
+
+	// arguments validation
+	if( ! csr || ! csr->roffsets || ! file )
+		return -1;
+	if( ! coords ) {
+		coords = csr->coords;
+		dims = coords ? csr->dims : 0;
+	}
+	if( ! (f = fopen(file, "wb")) )
+		return -1;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC));
+	header.version = CSR_VERSION;
+	header.byteOrder = CSR_BYTE_ORDER;
+	header.idSize = sizeof(a_star_id_t);
+	header.offsetSize = sizeof(size_t);
+	header.costSize = sizeof(long);
+	header.nodeSize = sizeof(a_star_node_t);
+	header.dims = (unsigned int)dims;
+	header.nnodes = csr->nnodes;
+	header.nedges = csr->nedges;
+	layout(header.nnodes, header.nedges, dims, at);
+
+	ok = write_padded(f, &header, sizeof(header), at[csHandles]) == 0;
+	// node handles carry their index, like the nodes numbered by a_star_graph_prepare()
+	for(i=0; ok && i < csr->nnodes; i += k) {
+		for(k=0; k < 1024 && i + k < csr->nnodes; k++)
+			handles[k].reserved = (void*)(uintptr_t)(i + k);
+		ok = fwrite(handles, sizeof(a_star_node_t), k, f) == k;
+	}
+	ok = ok
+		&& write_padded(f, 0, 0, at[csOffsets]) == 0
+		&& write_padded(f, csr->offsets, sizeof(size_t) * (csr->nnodes + 1), at[csTo]) == 0
+		&& write_padded(f, csr->to, sizeof(a_star_id_t) * csr->nedges, at[csCost]) == 0
+		&& write_padded(f, csr->cost, sizeof(long) * csr->nedges, at[csReverseOffsets]) == 0
+		&& write_padded(f, csr->roffsets, sizeof(size_t) * (csr->nnodes + 1), at[csFrom]) == 0
+		&& write_padded(f, csr->from, sizeof(a_star_id_t) * csr->nedges, at[csReverseCost]) == 0
+		&& write_padded(f, csr->rcost, sizeof(long) * csr->nedges, at[csCoords]) == 0
+		&& write_padded(f, coords, sizeof(long) * csr->nnodes * dims, at[csEnd]) == 0;
+
+	return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+int a_star_csr_load(const char* file, a_star_csr_t** csr) {
+	const a_star_csr_header_t* header;
+	unsigned long long at[csEnd+1];
+	csr_mapping_t* x;
+	struct stat st;
+	char* base;
+	int fd;
+
+	if( ! file || ! csr )
+		return -1;
+	if( (fd = open(file, O_RDONLY)) < 0 )
+		return -1;
+	if( fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(a_star_csr_header_t) ) {
+		close(fd);
+		return -1;
+	}
+	base = (char*)mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	// the mapping keeps the file open
+	if( base == MAP_FAILED )
+		return -1;
+
+	// the sizes are checked before they are used to lay the sections out
+	header = (const a_star_csr_header_t*)base;
+	if( memcmp(header->magic, CSR_MAGIC, sizeof(CSR_MAGIC)) != 0
+			|| header->version != CSR_VERSION
+			|| header->byteOrder != CSR_BYTE_ORDER
+			|| header->idSize != sizeof(a_star_id_t) || header->offsetSize != sizeof(size_t)
+			|| header->costSize != sizeof(long) || header->nodeSize != sizeof(a_star_node_t)
+			|| header->nnodes >= A_STAR_NONE
+			|| header->nedges > (unsigned long long)st.st_size || header->dims > 16 ) {
+		munmap(base, st.st_size);
+		return -1;
+	}
+	layout(header->nnodes, header->nedges, header->dims, at);
+	if( at[csEnd] > (unsigned long long)st.st_size
+			|| ((const size_t*)(base + at[csOffsets]))[header->nnodes] != header->nedges
+			|| ((const size_t*)(base + at[csReverseOffsets]))[header->nnodes] != header->nedges ) {
+		munmap(base, st.st_size);
+		return -1;
+	}
+
+	x = (csr_mapping_t*)malloc(sizeof(csr_mapping_t));
+	x->base = base;
+	x->size = st.st_size;
+	x->csr.nnodes = header->nnodes;
+	x->csr.nedges = header->nedges;
+	x->csr.offsets = (size_t*)(base + at[csOffsets]);
+	x->csr.to = (a_star_id_t*)(base + at[csTo]);
+	x->csr.cost = (long*)(base + at[csCost]);
+	x->csr.roffsets = (size_t*)(base + at[csReverseOffsets]);
+	x->csr.from = (a_star_id_t*)(base + at[csFrom]);
+	x->csr.rcost = (long*)(base + at[csReverseCost]);
+	x->csr.nodes = 0;
+	x->csr.handles = (a_star_node_t*)(base + at[csHandles]);
+	x->csr.dims = header->dims;
+	x->csr.coords = header->dims ? (const long*)(base + at[csCoords]) : 0;
+
+	*csr = &x->csr;
+	return 0;
+}
+
+void a_star_csr_unmap(a_star_csr_t* csr) {
+	csr_mapping_t* x = (csr_mapping_t*)csr;
+	munmap(x->base, x->size);
+	free(x);
+}
+
+long a_star_csr_euclidean(const a_star_node_t* n1, const a_star_node_t* n2, void* csr) {
+	const a_star_csr_t* x = (const a_star_csr_t*)csr;
+	const long *c1, *c2;
+	double sum = 0;
+	size_t d;
+	if( ! x->coords )
+		return 0;
+	c1 = &x->coords[NODE_ID(n1) * x->dims];
+	c2 = &x->coords[NODE_ID(n2) * x->dims];
+	for(d=0; d < x->dims; d++)
+		sum += (double)(c1[d] - c2[d]) * (c1[d] - c2[d]);
+	return (long)sqrt(sum);
+}
+
+void a_star_csr_euclidean_batch(const a_star_id_t* ids, size_t n, a_star_id_t target, long* h, void* csr) {
+	const a_star_csr_t* x = (const a_star_csr_t*)csr;
+	const long* t;
+	size_t i, d;
+	if( ! x->coords ) {
+		memset(h, 0, sizeof(long) * n);
+		return;
+	}
+	t = &x->coords[target * x->dims];
+	// independent iterations over plain arrays, left for the compiler to vectorise
+	for(i=0; i < n; i++) {
+		const long* c = &x->coords[ids[i] * x->dims];
+		double sum = 0;
+		for(d=0; d < x->dims; d++)
+			sum += (double)(c[d] - t[d]) * (c[d] - t[d]);
+		h[i] = (long)sqrt(sum);
+	}
+}
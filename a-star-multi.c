@@ -0,0 +1,243 @@
+// a-star-multi.c
+// One-to-many search: a single A* expansion from the start that settles a set
+// of goals, guided by the nearest goal that is still pending.
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include "a-star.h"
+#include "a-star-internal.h"
+
+typedef struct _goal_t {
+	a_star_id_t id;
+	size_t index;	// into the caller's goals and results
+} goal_t;
+
+typedef struct _multi_t {
+	const a_star_csr_t* csr;
+	a_star_search_ctx_t* ctx;
+	a_star_distance_func_t h_dist;
+	void* cookie;
+	goal_t* goals;	// sorted by id
+	size_t ngoals;
+	a_star_id_t* pending;	// distinct goals not reached yet
+	size_t npending;
+	unsigned int* hAt;	// per node: goals reached when its estimate was taken
+	unsigned int reached;	// distinct goals reached
+} multi_t;
+
+static int cmp_goals(const void* g1, const void* g2) {
+	a_star_id_t id1 = ((const goal_t*)g1)->id, id2 = ((const goal_t*)g2)->id;
+	return id1 < id2 ? -1 : id1 > id2;
+}
+
+/**
+ * Least estimate from node 'n' to a pending goal; min of admissible estimates,
+ * so admissible for every one of them.
+ **/
+static long estimate(multi_t* x, a_star_id_t n) {
+	a_star_node_t* node;
+	long h, best = LONG_MAX;
+	size_t i;
+	x->hAt[n] = x->reached;
+	if( ! x->h_dist || ! x->npending )
+		return 0;
+	node = a_star_csr_node_at(x->csr, n);
+	for(i=0; i < x->npending; i++) {
+		h = (*x->h_dist)(node, a_star_csr_node_at(x->csr, x->pending[i]), x->cookie);
+		A_STAR_STAT(x->ctx, heuristicCalls);
+		if( h < best )
+			best = h;
+	}
+	return best;
+}
+
+/**
+ * First goal entry for node 'n', or null if it is not a goal.
+ **/
+static const goal_t* find_goal(const multi_t* x, a_star_id_t n) {
+	size_t lo = 0, hi = x->ngoals;
+	while( lo < hi ) {
+		size_t mid = (lo + hi) / 2;
+		if( x->goals[mid].id < n )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < x->ngoals && x->goals[lo].id == n ? &x->goals[lo] : 0;
+}
+
+static int node_path(const multi_t* x, a_star_id_t end, a_star_node_t*** path) {
+	a_star_id_t step;
+	int i, n;
+	for(step=end, n=0; step != A_STAR_NONE; step=x->ctx->prev[step], n++)
+		;
+	*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
+	for(step=end, i=n-1; step != A_STAR_NONE; step=x->ctx->prev[step], i--)
+		(*path)[i] = a_star_csr_node_at(x->csr, step);
+	return n;
+}
+
+int a_star_search_multi(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t** goals,
+		size_t ngoals,
+		size_t k,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_result_t* results
+		) {
+	a_star_id_t idBegin;
+	multi_t x;
+	size_t i, found = 0;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
+
+	// arguments validation
+	if( ! csr || (! csr->nodes && ! csr->handles) || ! ctx || ! begin )
+		return -1;
+	if( (! goals || ! results) && ngoals )
+		return -1;
+	if( csr->nnodes > ctx->capacity )
+		return -1;
+	idBegin = NODE_ID(begin);
+	if( idBegin >= csr->nnodes )
+		return -1;
+	for(i=0; i < ngoals; i++)
+		if( ! goals[i] || NODE_ID(goals[i]) >= csr->nnodes )
+			return -1;
+
+	// initialization
+	for(i=0; i < ngoals; i++) {
+		results[i].status = 0;
+		results[i].path = 0;
+	}
+	if( ! ngoals )
+		return 0;
+
+	a_star_ctx_reset(ctx);
+
+	x.csr = csr;
+	x.ctx = ctx;
+	x.h_dist = h_dist;
+	x.cookie = cookie;
+	x.goals = (goal_t*)arena_alloc(ctx->scratch, sizeof(goal_t) * ngoals);
+	x.ngoals = ngoals;
+	x.pending = (a_star_id_t*)arena_alloc(ctx->scratch, sizeof(a_star_id_t) * ngoals);
+	x.npending = 0;
+	// only read for nodes estimated in this query, so left uninitialised
+	x.hAt = (unsigned int*)arena_alloc(ctx->scratch, sizeof(unsigned int) * csr->nnodes);
+	x.reached = 0;
+	for(i=0; i < ngoals; i++) {
+		x.goals[i].id = NODE_ID(goals[i]);
+		x.goals[i].index = i;
+	}
+	qsort(x.goals, ngoals, sizeof(goal_t), cmp_goals);
+	for(i=0; i < ngoals; i++)
+		if( ! i || x.goals[i].id != x.goals[i-1].id )
+			x.pending[x.npending++] = x.goals[i].id;
+
+	a_star_ctx_touch(ctx, idBegin);
+	ctx->g[idBegin] = 0;
+	ctx->h[idBegin] = ctx->f[idBegin] = estimate(&x, idBegin);
+	progressInfo.maxDistance = ctx->h[idBegin];
+	a_star_ctx_open(ctx, idBegin, ctx->f[idBegin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
+	while( pqueue_len(ctx->open) ) {
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		const goal_t* goal;
+
+		// the goal it was estimated by may have been reached since: a larger
+		// estimate, now that fewer goals remain, puts it back in line
+		if( x.hAt[curr] != x.reached ) {
+			long h = estimate(&x, curr);
+			if( h > ctx->h[curr] ) {
+				ctx->h[curr] = h;
+				ctx->f[curr] = ctx->g[curr] + h;
+				a_star_ctx_open(ctx, curr, ctx->f[curr]);
+				continue;
+			}
+		}
+		A_STAR_STAT(ctx, expansions);
+
+		if( progress && a_star_ctx_sampled(ctx, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analized = progressInfo.current = a_star_csr_node_at(csr, curr);
+			progressInfo.analizedId = progressInfo.currentId = curr;
+			(*progress)(&progressInfo, cookie);
+		}
+
+		ctx->closed[curr] = 1;
+
+		// a goal leaves the queue with its cheapest path, and no later one is cheaper
+		if( (goal = find_goal(&x, curr)) ) {
+			for(; goal < x.goals + x.ngoals && goal->id == curr && (! k || found < k); goal++, found++)
+				results[goal->index].status = node_path(&x, curr, &results[goal->index].path);
+			for(i=0; x.pending[i] != curr; i++)
+				;
+			x.pending[i] = x.pending[--x.npending];
+			x.reached++;
+			if( ! x.npending || (k && found >= k) )
+				break; // FINISH!
+		}
+
+		// the edges leaving 'curr' are contiguous
+		for(i=csr->offsets[curr]; i < csr->offsets[curr+1]; i++) {
+			a_star_id_t neighbor = csr->to[i];
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analized = a_star_csr_node_at(csr, neighbor);
+				progressInfo.analizedId = neighbor;
+				(*progress)(&progressInfo, cookie);
+			}
+			long gCost = ctx->g[curr] + csr->cost[i];
+			if( gCost >= ctx->g[neighbor] )
+				continue;
+			if( ctx->h[neighbor] == LONG_MAX )
+				ctx->h[neighbor] = estimate(&x, neighbor);
+			ctx->g[neighbor] = gCost;
+			ctx->f[neighbor] = gCost + ctx->h[neighbor];
+			ctx->prev[neighbor] = curr;
+			a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
+		}
+	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
+
+	return (int)found;
+}
+
+int a_star_shortest_paths(
+		a_star_graph_t* graph,
+		a_star_node_t** goals,
+		size_t ngoals,
+		size_t k,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_result_t* results
+		) {
+	a_star_search_ctx_t* ctx;
+	a_star_csr_t* csr;
+	int n;
+
+	// arguments validation
+	if( ! graph || ! graph->begin )
+		return -1;
+	if( ! g_dist )
+		return -1;
+
+	if( a_star_graph_prepare(graph, g_dist, cookie, &csr) < 0 )
+		return -1;
+	if( a_star_search_ctx_init(csr->nnodes, aqHeap, &ctx) < 0 ) {
+		a_star_csr_free(csr);
+		return -1;
+	}
+	n = a_star_search_multi(csr, ctx, graph->begin, goals, ngoals, k, h_dist, progress, cookie, results);
+	a_star_search_ctx_deinit(ctx);
+	a_star_csr_free(csr);
+
+	return n;
+}
@@ -1,143 +1,471 @@
 // a-star.c
 
+#include <stdint.h>
+#include <string.h>
 #include <limits.h>
 #include "dlist.h"
+#include "pqueue.h"
+#include "tpool.h"
 #include "a-star.h"
+#include "a-star-internal.h"
 
-typedef struct _a_star_node_info_t {
-	long g, h, f;
-	a_star_node_t* prev;
-	int close;
-} a_star_node_info_t;
+/**
+ * Stores the path into a new array when 'path' is given, otherwise into 'buf'
+ * provided it fits. Returns the number of steps either way.
+ **/
+static int get_path(const a_star_csr_t* csr, const a_star_search_ctx_t* ctx, a_star_id_t end,
+		a_star_node_t*** path, a_star_node_t** buf, size_t size) {
+	a_star_id_t step;
+	int i, n;
 
-#define	NINFO(n)	((a_star_node_info_t*)(n)->reserved)
+	// count path steps
+	for(step=end, n=0; step != A_STAR_NONE; step=ctx->prev[step], n++)
+		;
+	// build a path array
+	if( path ) {
+		buf = *path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
+		size = n;
+	}
+	if( n <= size )
+		for(step=end, i=0; step != A_STAR_NONE; step=ctx->prev[step], i++)
+			buf[n-i-1] = a_star_csr_node_at(csr, step);
 
-static a_star_node_info_t* create_node_info() {
-	a_star_node_info_t* ni = (a_star_node_info_t*)malloc(sizeof(a_star_node_info_t));
-	ni->g = ni->h = ni->f = LONG_MAX;
-	ni->prev = 0;
-	ni->close = 0;
-	return ni;
+	return n;
 }
 
-static int get_path(const a_star_graph_t* graph, a_star_node_t*** path) {
-	a_star_node_t* step;
+void a_star_ctx_reset(a_star_search_ctx_t* ctx) {
+	// stale stamps could only match again after the counter wraps around
+	if( ++ctx->generation == 0 ) {
+		memset(ctx->stamp, 0, sizeof(unsigned int) * ctx->capacity);
+		ctx->generation = 1;
+	}
+	pqueue_reset(ctx->open);
+	arena_reset(ctx->scratch);
+#ifndef A_STAR_NO_STATS
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+	ctx->phaseStart = a_star_clock_ns();
+#endif
+}
+
+int a_star_ctx_path(const a_star_search_ctx_t* ctx, a_star_id_t end, a_star_id_t** path, a_star_id_t* buf, size_t size) {
+	a_star_id_t step;
 	int i, n;
 
-	// count path steps
-	for(step=graph->end, n=0; step; step=NINFO(step)->prev, n++)
+	for(step=end, n=0; step != A_STAR_NONE; step=ctx->prev[step], n++)
 		;
-	// build a path array
-	*path = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * n);
-	for(step=graph->end, i=0; step; step=NINFO(step)->prev, i++)
-		(*path)[n-i-1] = step;
+	if( path ) {
+		buf = *path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * n);
+		size = n;
+	}
+	if( n <= size )
+		for(step=end, i=0; step != A_STAR_NONE; step=ctx->prev[step], i++)
+			buf[n-i-1] = step;
 
 	return n;
 }
 
-static int _cbCmpEdges(const void* v1, const void* v2) {
-	const a_star_edge_t* e1 = *(const a_star_edge_t**)v1;
-	const a_star_edge_t* e2 = *(const a_star_edge_t**)v2;
-	return e1->from - e2->from;
+int a_star_search_ctx_init(size_t nnodes, a_star_queue_t queue, a_star_search_ctx_t** ctx) {
+	a_star_search_ctx_t* x;
+	if( ! ctx || nnodes >= A_STAR_NONE )
+		return -1;
+	x = (a_star_search_ctx_t*)malloc(sizeof(a_star_search_ctx_t));
+	x->capacity = nnodes;
+	x->g = (long*)malloc(sizeof(long) * nnodes);
+	x->h = (long*)malloc(sizeof(long) * nnodes);
+	x->f = (long*)malloc(sizeof(long) * nnodes);
+	x->prev = (a_star_id_t*)malloc(sizeof(a_star_id_t) * nnodes);
+	x->closed = (unsigned char*)malloc(nnodes);
+	x->stamp = (unsigned int*)calloc(nnodes, sizeof(unsigned int));
+	x->generation = 0;
+	x->progressEvery = 1;
+	x->hBatch = 0;
+	x->batchIds = 0;
+	x->batchH = 0;
+	x->batchCapacity = 0;
+	memset(&x->stats, 0, sizeof(x->stats));
+	x->phaseStart = 0;
+	// list queue nodes are recycled through a pool, scratch memory is rewound per query
+	allocator_t allocator;
+	pool_init(dlist_node_size(), 0, &x->listNodes);
+	pool_allocator(x->listNodes, &allocator);
+	pqueue_init(queue == aqList ? pqList : queue == aqBucket ? pqBucket : pqHeap, nnodes, &allocator, &x->open);
+	arena_init(0, &x->scratch);
+	*ctx = x;
+	return 0;
+}
+
+void a_star_search_ctx_deinit(a_star_search_ctx_t* ctx) {
+	if( ! ctx )
+		return;
+	pqueue_deinit(ctx->open);
+	pool_deinit(ctx->listNodes);
+	arena_deinit(ctx->scratch);
+	free(ctx->g);
+	free(ctx->h);
+	free(ctx->f);
+	free(ctx->prev);
+	free(ctx->closed);
+	free(ctx->stamp);
+	free(ctx->batchIds);
+	free(ctx->batchH);
+	free(ctx);
+}
+
+int a_star_search_ctx_stats(const a_star_search_ctx_t* ctx, a_star_stats_t* stats) {
+	if( ! ctx || ! stats )
+		return -1;
+#ifndef A_STAR_NO_STATS
+	*stats = ctx->stats;
+	return 0;
+#else
+	memset(stats, 0, sizeof(*stats));
+	return -1;
+#endif
+}
+
+void a_star_search_ctx_progress_every(a_star_search_ctx_t* ctx, unsigned int every) {
+	if( ctx )
+		ctx->progressEvery = every ? every : 1;
 }
 
-static int _cmpNodes(const void* e1, const void* e2, void* cookie) {
-	const a_star_node_t* n1 = (const a_star_node_t*)e1;
-	const a_star_node_t* n2 = (const a_star_node_t*)e2;
-	long f1 = NINFO(n1)->f;
-	long f2 = NINFO(n2)->f;
-	return f1 - f2;
+void a_star_search_ctx_batch_heuristic(a_star_search_ctx_t* ctx, a_star_batch_distance_func_t h_batch) {
+	if( ctx )
+		ctx->hBatch = h_batch;
 }
 
-int a_star_shortest_path(
+int a_star_graph_prepare(
 		a_star_graph_t* graph,
 		a_star_distance_func_t g_dist,
+		void* cookie,
+		a_star_csr_t** csr
+		) {
+	a_star_csr_t* x;
+	size_t i;
+
+	// arguments validation
+	if( ! graph || ! graph->nodes || ! graph->edges || ! csr )
+		return -1;
+	if( graph->nnodes >= A_STAR_NONE )
+		return -1;
+
+	x = (a_star_csr_t*)malloc(sizeof(a_star_csr_t));
+	x->nnodes = graph->nnodes;
+	x->nedges = graph->nedges;
+	x->nodes = graph->nodes;
+	x->handles = 0;
+	x->dims = 0;
+	x->coords = 0;
+	x->offsets = (size_t*)calloc(graph->nnodes + 1, sizeof(size_t));
+	x->to = (a_star_id_t*)malloc(sizeof(a_star_id_t) * graph->nedges);
+	x->cost = (long*)malloc(sizeof(long) * graph->nedges);
+	x->roffsets = (size_t*)calloc(graph->nnodes + 1, sizeof(size_t));
+	x->from = (a_star_id_t*)malloc(sizeof(a_star_id_t) * graph->nedges);
+	x->rcost = (long*)malloc(sizeof(long) * graph->nedges);
+
+	// number the nodes
+	for(i=0; i < graph->nnodes; i++)
+		graph->nodes[i]->reserved = (void*)(uintptr_t)i;
+
+	// count out-degrees, then turn them into row offsets
+	for(i=0; i < graph->nedges; i++)
+		x->offsets[NODE_ID(graph->edges[i]->from) + 1]++;
+	for(i=0; i < graph->nnodes; i++)
+		x->offsets[i+1] += x->offsets[i];
+
+	// scatter edges into their rows (stable, so per-node edge order is kept)
+	size_t* fill = (size_t*)malloc(sizeof(size_t) * graph->nnodes);
+	for(i=0; i < graph->nnodes; i++)
+		fill[i] = x->offsets[i];
+	for(i=0; i < graph->nedges; i++) {
+		const a_star_edge_t* e = graph->edges[i];
+		size_t k = fill[NODE_ID(e->from)]++;
+		x->to[k] = NODE_ID(e->to);
+		x->cost[k] = e->cost + (g_dist ? (*g_dist)(e->from, e->to, cookie) : 0);
+	}
+
+	// reverse rows, from the forward ones so that costs are not computed twice
+	for(i=0; i < graph->nedges; i++)
+		x->roffsets[x->to[i] + 1]++;
+	for(i=0; i < graph->nnodes; i++)
+		x->roffsets[i+1] += x->roffsets[i];
+	for(i=0; i < graph->nnodes; i++)
+		fill[i] = x->roffsets[i];
+	for(i=0; i < graph->nnodes; i++) {
+		size_t e;
+		for(e=x->offsets[i]; e < x->offsets[i+1]; e++) {
+			size_t k = fill[x->to[e]]++;
+			x->from[k] = (a_star_id_t)i;
+			x->rcost[k] = x->cost[e];
+		}
+	}
+	free(fill);
+
+	*csr = x;
+	return 0;
+}
+
+void a_star_csr_free(a_star_csr_t* csr) {
+	if( ! csr )
+		return;
+	if( csr->handles ) {
+		a_star_csr_unmap(csr);
+		return;
+	}
+	free(csr->offsets);
+	free(csr->to);
+	free(csr->cost);
+	free(csr->roffsets);
+	free(csr->from);
+	free(csr->rcost);
+	free(csr);
+}
+
+a_star_node_t* a_star_csr_node(const a_star_csr_t* csr, a_star_id_t id) {
+	if( ! csr || id >= csr->nnodes || (! csr->nodes && ! csr->handles) )
+		return 0;
+	return a_star_csr_node_at(csr, id);
+}
+
+/**
+ * Estimates, in one batch call, every neighbour of 'curr' that has no estimate yet.
+ **/
+static void estimate_neighbors(const a_star_csr_t* csr, a_star_search_ctx_t* ctx, a_star_id_t curr,
+		a_star_id_t end, void* cookie) {
+	size_t i, n = 0, degree = csr->offsets[curr+1] - csr->offsets[curr];
+	if( degree > ctx->batchCapacity ) {
+		ctx->batchCapacity = degree * 2;
+		ctx->batchIds = (a_star_id_t*)realloc(ctx->batchIds, sizeof(a_star_id_t) * ctx->batchCapacity);
+		ctx->batchH = (long*)realloc(ctx->batchH, sizeof(long) * ctx->batchCapacity);
+	}
+	for(i=csr->offsets[curr]; i < csr->offsets[curr+1]; i++) {
+		a_star_id_t neighbor = csr->to[i];
+		a_star_ctx_touch(ctx, neighbor);
+		if( ctx->h[neighbor] == LONG_MAX )
+			ctx->batchIds[n++] = neighbor;
+	}
+	if( ! n )
+		return;
+	(*ctx->hBatch)(ctx->batchIds, n, end, ctx->batchH, cookie);
+	for(i=0; i < n; i++)
+		ctx->h[ctx->batchIds[i]] = ctx->batchH[i];
+#ifndef A_STAR_NO_STATS
+	ctx->stats.heuristicCalls += n;
+#endif
+}
+
+static int csr_search(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
 		a_star_distance_func_t h_dist,
 		a_star_progress_func_t progress,
 		void* cookie,
-		a_star_node_t*** path
+		a_star_node_t*** path,
+		a_star_node_t** buf,
+		size_t size
 		) {
-	dlist_t *l_open;
-	int i, n=0, complete=0;
-	a_star_progress_info_t progressInfo={0,0,0,0,0};
+	a_star_id_t idBegin, idEnd;
+	int n=0, complete=0;
+	size_t i;
+	a_star_progress_info_t progressInfo={0,0,0,0,0,0,0};
 
 	// arguments validation
-	if( ! graph || ! graph->nodes || ! graph->edges || ! graph->begin || ! graph->end )
+	if( ! csr || (! csr->nodes && ! csr->handles) || ! ctx || ! begin || ! end )
 		return -1;
-	if( ! g_dist || ! h_dist )
+	if( ! h_dist && ! ctx->hBatch )
 		return -1;
-	if( ! path )
+	if( csr->nnodes > ctx->capacity )
+		return -1;
+	idBegin = NODE_ID(begin);
+	idEnd = NODE_ID(end);
+	if( idBegin >= csr->nnodes || idEnd >= csr->nnodes )
 		return -1;
 
 	// initialization
-	progressInfo.maxDistance = h_dist(graph->begin, graph->end, cookie);
-	dlist_init(0, _cmpNodes, 0, &l_open);
+	if( path )
+		*path = 0;
 
-	*path = 0;
+	a_star_ctx_reset(ctx);
 
-	// sort edges by 'from'
-	qsort(graph->edges, graph->nedges, sizeof(a_star_edge_t*), _cbCmpEdges);
-
-	// attach private data to each node
-	for(i=0; i < graph->nnodes; i++)
-		graph->nodes[i]->reserved = create_node_info();
-
-	dlist_push_ordered(l_open, graph->begin);
+	a_star_ctx_touch(ctx, idBegin);
+	ctx->g[idBegin] = 0;
+	if( ctx->hBatch )
+		(*ctx->hBatch)(&idBegin, 1, idEnd, &ctx->h[idBegin], cookie);
+	else
+		ctx->h[idBegin] = h_dist(begin, end, cookie);
+	ctx->f[idBegin] = ctx->h[idBegin];
+	A_STAR_STAT(ctx, heuristicCalls);
+	progressInfo.maxDistance = ctx->h[idBegin];
+	a_star_ctx_open(ctx, idBegin, ctx->f[idBegin]);
+	A_STAR_STAT_PHASE(ctx, initTime);
 	for(;;) {
-		// since l_open is ordered by F-cost, the first element should be the lowest
-		a_star_node_t* curr = (a_star_node_t*)dlist_get_front(l_open);
-		if( ! curr )
+		// the open queue is keyed by F-cost, so its top is the lowest
+		if( ! pqueue_len(ctx->open) )
 			break; // FAILED!
+		a_star_id_t curr = pqueue_pop(ctx->open);
+		A_STAR_STAT(ctx, expansions);
 
-		if( progress ) {
-			progressInfo.nframe++;
-			progressInfo.currDistance = h_dist(curr, graph->end, cookie);
-			progressInfo.analized = progressInfo.current = curr;
+		if( progress && a_star_ctx_sampled(ctx, ++progressInfo.nframe) ) {
+			progressInfo.currDistance = ctx->h[curr];
+			progressInfo.analized = progressInfo.current = a_star_csr_node_at(csr, curr);
+			progressInfo.analizedId = progressInfo.currentId = curr;
 			(*progress)(&progressInfo, cookie);
 		}
 
-		dlist_remove(l_open, curr);
-		NINFO(curr)->close = 1;
+		ctx->closed[curr] = 1;
 
-		if( curr == graph->end ) {
+		if( curr == idEnd ) {
 			complete = 1;
 			break; // FINISH!
 		}
 
-		// search edges sorted array for beginning of 'from'==curr
-		for(i=0; i < graph->nedges && graph->edges[i]->from != curr; i++)
-			;
-		for(; i < graph->nedges && graph->edges[i]->from==curr; i++) {
-			a_star_node_t* neighbor = graph->edges[i]->to;
-			if( NINFO(neighbor)->close )
-				continue;
-			if( dlist_exists(l_open, neighbor) )
-				continue;
-			if( progress ) {
-				progressInfo.analized = neighbor;
+		if( ctx->hBatch )
+			estimate_neighbors(csr, ctx, curr, idEnd, cookie);
+
+		// the edges leaving 'curr' are contiguous
+		for(i=csr->offsets[curr]; i < csr->offsets[curr+1]; i++) {
+			a_star_id_t neighbor = csr->to[i];
+			a_star_ctx_touch(ctx, neighbor);
+			if( progress && ctx->progressEvery == 1 && ! ctx->closed[neighbor] ) {
+				progressInfo.analized = a_star_csr_node_at(csr, neighbor);
+				progressInfo.analizedId = neighbor;
 				(*progress)(&progressInfo, cookie);
 			}
-			long gCost = (*g_dist)(curr, neighbor, cookie) + graph->edges[i]->cost;
-			if( gCost > NINFO(neighbor)->g )
-				continue;
-			long hCost = (*h_dist)(neighbor, graph->end, cookie);
-			if( gCost == NINFO(neighbor)->g && hCost >= NINFO(neighbor)->h )
+			long gCost = ctx->g[curr] + csr->cost[i];
+			if( gCost >= ctx->g[neighbor] )
 				continue;
-			NINFO(neighbor)->g = gCost;
-			NINFO(neighbor)->h = hCost;
-			NINFO(neighbor)->f = gCost + hCost;
-			NINFO(neighbor)->prev = curr;
-			dlist_push_ordered(l_open, neighbor);
+			if( ctx->h[neighbor] == LONG_MAX ) {
+				ctx->h[neighbor] = (*h_dist)(a_star_csr_node_at(csr, neighbor), end, cookie);
+				A_STAR_STAT(ctx, heuristicCalls);
+			}
+			ctx->g[neighbor] = gCost;
+			ctx->f[neighbor] = gCost + ctx->h[neighbor];
+			ctx->prev[neighbor] = curr;
+			// a cheaper way into a closed node re-opens it (inconsistent heuristics)
+			a_star_ctx_open(ctx, neighbor, ctx->f[neighbor]);
 		}
 	}
+	A_STAR_STAT_PHASE(ctx, searchTime);
 
 	if( complete )
-		n = get_path(graph, path);
+		n = get_path(csr, ctx, idEnd, path, buf, size);
+	A_STAR_STAT_PHASE(ctx, pathTime);
 
-	for(i=0; i < graph->nnodes; i++)
-		free(graph->nodes[i]->reserved);
+	return n;
+}
 
-	dlist_deinit(l_open);
+int a_star_csr_shortest_path(
+		const a_star_csr_t* csr,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		) {
+	a_star_search_ctx_t* ctx;
+	int n;
+
+	if( ! csr )
+		return -1;
+	if( a_star_search_ctx_init(csr->nnodes, queue, &ctx) < 0 )
+		return -1;
+	n = a_star_search(csr, ctx, begin, end, h_dist, progress, cookie, path);
+	a_star_search_ctx_deinit(ctx);
 
 	return n;
 }
+
+int a_star_search(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t*** path
+		) {
+	if( ! path )
+		return -1;
+	return csr_search(csr, ctx, begin, end, h_dist, progress, cookie, path, 0, 0);
+}
+
+int a_star_search_buf(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t** buf,
+		size_t size
+		) {
+	if( ! buf && size )
+		return -1;
+	return csr_search(csr, ctx, begin, end, h_dist, progress, cookie, 0, buf, size);
+}
+
+typedef struct _a_star_batch_t {
+	const a_star_csr_t* csr;
+	const a_star_query_t* queries;
+	a_star_result_t* results;
+	a_star_search_ctx_t** ctxs;	// one per worker
+	a_star_distance_func_t h_dist;
+	void* cookie;
+} a_star_batch_t;
+
+static void _batchJob(int worker, size_t index, void* cookie) {
+	a_star_batch_t* b = (a_star_batch_t*)cookie;
+	a_star_result_t* r = &b->results[index];
+	r->path = 0;
+	r->status = a_star_search(b->csr, b->ctxs[worker],
+			b->queries[index].begin, b->queries[index].end,
+			b->h_dist, 0, b->cookie, &r->path);
+}
+
+int a_star_shortest_path_batch(
+		const a_star_csr_t* csr,
+		const a_star_query_t* queries,
+		size_t nqueries,
+		a_star_distance_func_t h_dist,
+		void* cookie,
+		a_star_queue_t queue,
+		int nthreads,
+		a_star_result_t* results
+		) {
+	a_star_batch_t b;
+	int i, nworkers, nfound=0;
+	size_t k;
+
+	// arguments validation
+	if( ! csr || ! h_dist || (nqueries && (! queries || ! results)) )
+		return -1;
+
+	nworkers = tpool_workers(nthreads, nqueries);
+	b.csr = csr;
+	b.queries = queries;
+	b.results = results;
+	b.h_dist = h_dist;
+	b.cookie = cookie;
+	b.ctxs = (a_star_search_ctx_t**)calloc(nworkers, sizeof(a_star_search_ctx_t*));
+	for(i=0; i < nworkers; i++)
+		if( a_star_search_ctx_init(csr->nnodes, queue, &b.ctxs[i]) < 0 )
+			break;
+
+	if( i == nworkers && tpool_run(nworkers, nqueries, _batchJob, &b) > 0 ) {
+		for(k=0; k < nqueries; k++)
+			if( results[k].status > 0 )
+				nfound++;
+	} else
+		nfound = -1;
+
+	for(i=0; i < nworkers; i++)
+		a_star_search_ctx_deinit(b.ctxs[i]);
+	free(b.ctxs);
+
+	return nfound;
+}
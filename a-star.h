@@ -5,8 +5,15 @@
 
 #include <stdlib.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int a_star_id_t;	// node index within a prepared graph
+#define	A_STAR_NONE	((a_star_id_t)-1)
+
 typedef struct _a_star_node_t {
-	void* reserved;	// for use by a-star algorithm only!
+	void* reserved;	// for use by a-star algorithm only! (node index, see a_star_graph_prepare())
 } a_star_node_t;
 
 typedef struct _a_star_edge_t {
@@ -22,14 +29,161 @@ typedef struct _a_star_graph_t {
 	a_star_node_t *begin, *end;
 } a_star_graph_t;
 
+/**
+ * Compressed-sparse-row adjacency of a graph, built by a_star_graph_prepare().
+ * The edges leaving node i are to[offsets[i]..offsets[i+1]-1] with matching cost[],
+ * and the edges entering it are from[roffsets[i]..roffsets[i+1]-1] with matching rcost[].
+ **/
+typedef struct _a_star_csr_t {
+	size_t nnodes, nedges;
+	size_t* offsets;	// nnodes+1 entries
+	a_star_id_t* to;
+	long* cost;
+	size_t* roffsets;	// nnodes+1 entries
+	a_star_id_t* from;
+	long* rcost;
+	a_star_node_t** nodes;	// node by index (borrowed from the source graph), null if loaded
+	a_star_node_t* handles;	// node by index of a graph loaded by a_star_csr_load(), null otherwise
+	size_t dims;	// coordinates per node, 0 if none
+	const long* coords;	// dims entries per node, for a_star_csr_euclidean()
+} a_star_csr_t;
+
+/**
+ * Per-query search state (G/H/F costs, back-links, closed flags and the open queue).
+ * A context serves one query at a time, so concurrent queries on a shared
+ * prepared graph need one context each (e.g. one per worker thread).
+ **/
+typedef struct _a_star_search_ctx_t a_star_search_ctx_t;
+
+typedef struct _a_star_query_t {
+	a_star_node_t *begin, *end;
+} a_star_query_t;
+
+typedef struct _a_star_result_t {
+	int status;	// path length, 0 if there is no path, or a negative value on error
+	a_star_node_t** path;	// should be deallocated using free()
+} a_star_result_t;
+
+/**
+ * Built-in grid heuristics, in A_STAR_STRAIGHT_COST / A_STAR_DIAGONAL_COST units.
+ **/
+typedef enum _a_star_heuristic_t {
+	ahDefault	= 0,	// octile on 8-connected grids, Manhattan on 4-connected ones
+	ahManhattan	= 1,	// overestimates on 8-connected grids: faster, paths may be longer
+	ahOctile	= 2,
+	ahChebyshev	= 3,
+	ahEuclidean	= 4,	// scaled so that a diagonal step costs A_STAR_DIAGONAL_COST, thus admissible
+} a_star_heuristic_t;
+
+/**
+ * Implicit grid graph: neighbours are generated during the search, so no
+ * nodes or edges are materialised. Cell (row, column) has id row*columns+column.
+ * A straight move costs A_STAR_STRAIGHT_COST and a diagonal one A_STAR_DIAGONAL_COST,
+ * multiplied by the cost of the entered cell when a cost layer is given.
+ **/
+typedef struct _a_star_grid_t {
+	int rows, columns;
+	const unsigned char* obstacles;	// one bit per cell, set if blocked (bit id%8 of byte id/8)
+	const unsigned char* cost;	// optional per-cell cost multiplier (0 is taken as 1), may be null
+	int connectivity;	// 4 or 8
+	int cutCorners;	// let diagonal moves pass between blocked straight neighbours
+	a_star_heuristic_t heuristic;	// of the grid searches
+} a_star_grid_t;
+
+#define	A_STAR_STRAIGHT_COST	10
+#define	A_STAR_DIAGONAL_COST	14
+#define	A_STAR_GRID_ID(g, row, column)	((a_star_id_t)(row) * (g)->columns + (column))
+#define	A_STAR_GRID_BLOCKED(g, id)	((g)->obstacles[(id) >> 3] & (1U << ((id) & 7)))
+#define	A_STAR_GRID_BITMAP_SIZE(rows, columns)	(((size_t)(rows) * (columns) + 7) / 8)
+
+/**
+ * Row by row reader of a grid map file, opened by a_star_map_open().
+ **/
+typedef struct _a_star_map_reader_t a_star_map_reader_t;
+
+/**
+ * JPS+ jump distance tables of a grid, built by a_star_jps_prepare().
+ **/
+typedef struct _a_star_jps_t a_star_jps_t;
+
+/**
+ * ALT landmark distance tables of a prepared graph, built by a_star_alt_build().
+ **/
+typedef struct _a_star_alt_t a_star_alt_t;
+
+/**
+ * Contraction hierarchy of a prepared graph, built by a_star_ch_build().
+ **/
+typedef struct _a_star_ch_t a_star_ch_t;
+
+/**
+ * Incremental (D* Lite) planner on a grid, created by a_star_dstar_init().
+ **/
+typedef struct _a_star_dstar_t a_star_dstar_t;
+
+/**
+ * Distances and first moves of every grid cell towards one goal, built by a_star_flow_build().
+ **/
+typedef struct _a_star_flow_t a_star_flow_t;
+
+/**
+ * Clustered abstraction of a grid for hierarchical search, built by a_star_hpa_build().
+ **/
+typedef struct _a_star_hpa_t a_star_hpa_t;
+
+/**
+ * Bounded LRU cache of query results, created by a_star_cache_init().
+ **/
+typedef struct _a_star_cache_t a_star_cache_t;
+
+typedef struct _a_star_cache_stats_t {
+	unsigned long hits;	// queries answered by an entry for the same endpoints
+	unsigned long subpathHits;	// queries answered by a slice of a longer cached path
+	unsigned long misses;
+	unsigned long evictions;	// entries dropped to stay within the memory bound
+	size_t entries;
+	size_t bytes;	// held by the entries and the buckets of their index
+} a_star_cache_stats_t;
+
 typedef struct _a_star_progress_info_t {
 	long nframe;
 	unsigned long currDistance, maxDistance;
 	a_star_node_t *analized, *current;
+	a_star_id_t analizedId, currentId;
 } a_star_progress_info_t;
 
+typedef enum _a_star_queue_t {
+	aqHeap	= 0,	// indexed d-ary heap (default)
+	aqList	= 1,	// ordered linked list
+	aqBucket	= 2,	// bucket per integer F-cost
+} a_star_queue_t;
+
+/**
+ * Counters of the last query run on a search context, see a_star_search_ctx_stats().
+ * A bidirectional query keeps the counters of each side in its own context, and
+ * its phase times in the forward one.
+ **/
+typedef struct _a_star_stats_t {
+	unsigned long expansions;	// nodes taken off the open queue
+	unsigned long pushes;	// insertions into the open queue
+	unsigned long reopens;	// insertions of closed nodes
+	unsigned long decreaseKeys;	// cheaper keys for nodes already open
+	unsigned long heuristicCalls;
+	size_t maxOpen;	// largest size of the open queue
+	unsigned long long initTime, searchTime, pathTime;	// ns spent in each phase
+} a_star_stats_t;
+
 typedef long(*a_star_distance_func_t)(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie);
+/**
+ * Heuristic of 'n' nodes at once: h[i] is the estimate from node ids[i] to node 'target'.
+ **/
+typedef void (*a_star_batch_distance_func_t)(const a_star_id_t* ids, size_t n, a_star_id_t target, long* h, void* cookie);
 typedef void (*a_star_progress_func_t)(const a_star_progress_info_t* info, void* cookie);
+/**
+ * Path found by an anytime search, costing at most 'bound' times the cheapest.
+ * The path array is only valid during the call.
+ **/
+typedef void (*a_star_improve_func_t)(a_star_node_t* const* path, int n, long cost, double bound, void* cookie);
 
 /**
  * Returns length of path on success, or a negative value on error.
@@ -46,4 +200,579 @@ int a_star_shortest_path(
 		a_star_node_t*** path
 		);
 
+/**
+ * Same as a_star_shortest_path(), using the given open-list implementation.
+ **/
+int a_star_shortest_path_ex(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		);
+
+/**
+ * Compiles the graph into a CSR adjacency that can serve any number of queries.
+ * Each edge cost is 'cost' plus g_dist(from, to) when g_dist is given.
+ * Numbers the nodes (through their 'reserved' field); the edge array is left untouched.
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_csr_free().
+ **/
+int a_star_graph_prepare(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		void* cookie,
+		a_star_csr_t** csr
+		);
+void a_star_csr_free(a_star_csr_t* csr);
+
+/**
+ * Node with the given index, or null if out of range. This is how the nodes of a
+ * loaded graph, which has no source graph, are passed to the searches.
+ **/
+a_star_node_t* a_star_csr_node(const a_star_csr_t* csr, a_star_id_t id);
+
+/**
+ * Writes the prepared graph to a file, with 'dims' coordinates per node when
+ * 'coords' is given (those of a loaded graph are kept otherwise).
+ * The arrays are stored as they are laid out in memory, so a file can only be
+ * loaded on a platform with the same byte order and type sizes.
+ * Returns 0 on success, or a negative value on error.
+ **/
+int a_star_csr_save(const a_star_csr_t* csr, const long* coords, size_t dims, const char* file);
+
+/**
+ * Maps a file written by a_star_csr_save() read-only and searches it in place:
+ * nothing is parsed or copied, and processes loading the same file share its pages.
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_csr_free().
+ **/
+int a_star_csr_load(const char* file, a_star_csr_t** csr);
+
+/**
+ * Euclidean distance between the coordinates of two nodes of 'csr' (the cookie),
+ * for graphs whose coordinates are in edge cost units.
+ **/
+long a_star_csr_euclidean(const a_star_node_t* n1, const a_star_node_t* n2, void* csr);
+void a_star_csr_euclidean_batch(const a_star_id_t* ids, size_t n, a_star_id_t target, long* h, void* csr);
+
+/**
+ * Same as a_star_shortest_path_ex(), searching a prepared graph between the given nodes.
+ **/
+int a_star_csr_shortest_path(
+		const a_star_csr_t* csr,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		);
+
+/**
+ * Allocates search state for graphs of up to 'nnodes' nodes.
+ * Returns 0 on success, or a negative value on error.
+ **/
+int a_star_search_ctx_init(size_t nnodes, a_star_queue_t queue, a_star_search_ctx_t** ctx);
+void a_star_search_ctx_deinit(a_star_search_ctx_t* ctx);
+
+/**
+ * Copies the statistics of the last query run on 'ctx'.
+ * Returns 0 on success, or a negative value when the library was built with
+ * A_STAR_NO_STATS defined, in which case no statistics are kept.
+ **/
+int a_star_search_ctx_stats(const a_star_search_ctx_t* ctx, a_star_stats_t* stats);
+
+/**
+ * Reports only every 'every'-th expansion to the progress callback of queries
+ * run on 'ctx', and none of the neighbours; 0 or 1 (the default) reports all.
+ **/
+void a_star_search_ctx_progress_every(a_star_search_ctx_t* ctx, unsigned int every);
+
+/**
+ * Makes a_star_search() and a_star_search_buf() on 'ctx' estimate all the new
+ * neighbours of an expanded node in a single 'h_batch' call (the start node in a
+ * call of its own), in place of h_dist, which may then be null; null restores h_dist.
+ **/
+void a_star_search_ctx_batch_heuristic(a_star_search_ctx_t* ctx, a_star_batch_distance_func_t h_batch);
+
+/**
+ * Same as a_star_csr_shortest_path(), keeping all search state in 'ctx'.
+ * The prepared graph is only read, so any number of threads may search
+ * it at the same time, each with its own context.
+ **/
+int a_star_search(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t*** path
+		);
+
+/**
+ * Same as a_star_search(), storing the path into the caller's buffer, which
+ * makes steady-state queries on a reused context free of heap allocations.
+ * Returns the length of the path; like snprintf(), the path is only stored
+ * when that length does not exceed 'size'.
+ **/
+int a_star_search_buf(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t** buf,
+		size_t size
+		);
+
+/**
+ * Answers many queries on a shared prepared graph, using 'nthreads' worker
+ * threads (<= 0 for one per online CPU) that steal work from each other.
+ * Each worker reuses a single search context for all the queries it runs.
+ * results[i] receives the outcome of queries[i]; h_dist must be reentrant.
+ * Returns the number of queries for which a path was found, or a negative value on error.
+ **/
+int a_star_shortest_path_batch(
+		const a_star_csr_t* csr,
+		const a_star_query_t* queries,
+		size_t nqueries,
+		a_star_distance_func_t h_dist,
+		void* cookie,
+		a_star_queue_t queue,
+		int nthreads,
+		a_star_result_t* results
+		);
+
+/**
+ * One search from 'begin' to all the 'ngoals' nodes of 'goals', expanding the
+ * region they share once instead of once per goal. A node is estimated by the
+ * least h_dist() to a goal not reached yet (h_dist may be null: no estimate,
+ * as in Dijkstra's algorithm), and is re-estimated as goals are reached.
+ * Goals are reached cheapest first; the search stops once every goal is reached
+ * or, if 'k' is not 0, the k cheapest ones (the k nearest).
+ * results[i] receives the path to goals[i], with status 0 if it was not reached.
+ * Returns the number of goals reached, or a negative value on error.
+ **/
+int a_star_search_multi(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t** goals,
+		size_t ngoals,
+		size_t k,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_result_t* results
+		);
+
+/**
+ * Same as a_star_search_multi(), from graph->begin on an unprepared graph, as
+ * a_star_shortest_path() does for a single goal (graph->end is not used).
+ **/
+int a_star_shortest_paths(
+		a_star_graph_t* graph,
+		a_star_node_t** goals,
+		size_t ngoals,
+		size_t k,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_result_t* results
+		);
+
+/**
+ * Creates a cache of paths holding up to 'maxBytes' bytes of entries and of the
+ * hash buckets that index them; the least recently used entries are evicted to
+ * make room. The buckets are kept until the cache is deallocated.
+ * Entries are keyed by their endpoints and a graph version chosen by the
+ * caller, which must change whenever the graph or its costs do: entries of
+ * other versions are never returned, and age out.
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_cache_deinit().
+ **/
+int a_star_cache_init(size_t maxBytes, a_star_cache_t** cache);
+void a_star_cache_deinit(a_star_cache_t* cache);
+void a_star_cache_clear(a_star_cache_t* cache);
+void a_star_cache_stats(const a_star_cache_t* cache, a_star_cache_stats_t* stats);
+
+/**
+ * Looks for the path from 'begin' to 'end': an entry for these endpoints, or
+ * a cached path through both of them in this order, whose slice between them
+ * is optimal too.
+ * Returns 1 if found, with its length in 'n' (0 if it is known that there is
+ * no path) and 'path' pointing into the cache, valid until the next insertion
+ * or clear; 0 if not found, or a negative value on error.
+ **/
+int a_star_cache_lookup(
+		a_star_cache_t* cache,
+		unsigned long version,
+		const a_star_node_t* begin,
+		const a_star_node_t* end,
+		a_star_node_t* const** path,
+		int* n
+		);
+
+/**
+ * Copies the optimal path of 'n' nodes from 'begin' to 'end' (n is 0 if there
+ * is none) into the cache, replacing any entry for the same endpoints.
+ * Returns 1 if cached, 0 if the path does not fit in the cache even alone, or
+ * a negative value on error.
+ **/
+int a_star_cache_insert(
+		a_star_cache_t* cache,
+		unsigned long version,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_node_t* const* path,
+		int n
+		);
+
+/**
+ * Same as a_star_shortest_path_ex(), answered from the cache when it can be,
+ * and cached otherwise.
+ **/
+int a_star_cached_shortest_path(
+		a_star_cache_t* cache,
+		unsigned long version,
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_queue_t queue,
+		a_star_node_t*** path
+		);
+
+/**
+ * ARA* anytime search: finds a path costing at most 'weight' (>= 1) times the
+ * cheapest with the heuristic inflated by 'weight', then lowers the inflation
+ * and improves the path, reusing the search state, until the path is optimal
+ * or 'deadlineUs' microseconds have passed since the call (0 for no deadline).
+ * The first path is always searched to the end; a larger weight finds it sooner.
+ * Each path found is reported to 'improve', if given, with the bound it was
+ * proven within. The bounds hold for consistent h_dist.
+ * On return 'bound' (may be null) receives the bound of the returned path.
+ * Returns length of path, 0 if there is none, or a negative value on error.
+ * If greater then zero, the returned path array should be deallocated using free().
+ **/
+int a_star_search_anytime(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* ctx,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		double weight,
+		unsigned long deadlineUs,
+		a_star_progress_func_t progress,
+		a_star_improve_func_t improve,
+		void* cookie,
+		a_star_node_t*** path,
+		double* bound
+		);
+
+/**
+ * Same as a_star_search_anytime(), from graph->begin to graph->end on an
+ * unprepared graph; the deadline includes preparing it.
+ **/
+int a_star_shortest_path_anytime(
+		a_star_graph_t* graph,
+		a_star_distance_func_t g_dist,
+		a_star_distance_func_t h_dist,
+		double weight,
+		unsigned long deadlineUs,
+		a_star_improve_func_t improve,
+		void* cookie,
+		a_star_node_t*** path,
+		double* bound
+		);
+
+/**
+ * Built-in heuristic between two cells 'dRow' rows and 'dCol' columns apart.
+ * ahDefault is taken as octile.
+ **/
+long a_star_heuristic(a_star_heuristic_t heuristic, long dRow, long dCol);
+
+/**
+ * Searches an implicit grid from cell 'begin' to cell 'end', using the grid's
+ * heuristic, built into a copy of the search loop made for each of them.
+ * 'ctx' must hold at least rows*columns nodes. Progress reports cell ids only.
+ * Returns length of path on success, or a negative value on error.
+ * If greater then zero, the returned array of cell ids should be deallocated using free().
+ **/
+int a_star_grid_search(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		);
+
+/**
+ * Same as a_star_grid_search(), storing the path into the caller's buffer
+ * (see a_star_search_buf()).
+ **/
+int a_star_grid_search_buf(
+		const a_star_grid_t* grid,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t* buf,
+		size_t size
+		);
+
+/**
+ * Opens a grid map file and reads its size: a MovingAI benchmark map (.map), where
+ * '.', 'G' and 'S' are passable, or a binary PGM (P5) occupancy grid, where only
+ * bright cells are (occupied and unknown ones are blocked).
+ * Returns 0 on success, or a negative value on error.
+ * The reader should be deallocated using a_star_map_close().
+ **/
+int a_star_map_open(const char* file, a_star_map_reader_t** reader, int* rows, int* columns);
+
+/**
+ * Reads the next row into 'blocked', one byte per cell, non-zero if blocked.
+ * Returns 1 on success, 0 after the last row, or a negative value on error.
+ **/
+int a_star_map_read_row(a_star_map_reader_t* reader, unsigned char* blocked);
+void a_star_map_close(a_star_map_reader_t* reader);
+
+/**
+ * Reads a whole grid map file into 'grid', as an 8-connected grid without corner cutting.
+ * Returns 0 on success, or a negative value on error.
+ * The obstacle bitmap should be deallocated using free().
+ **/
+int a_star_map_load(const char* file, a_star_grid_t* grid);
+
+/**
+ * Precomputes JPS+ jump distances (8 per cell) for a uniform-cost, 8-connected
+ * grid that allows cutting corners. The obstacles must not change afterwards.
+ * Returns 0 on success, or a negative value on error (or an unsupported grid).
+ * The result should be deallocated using a_star_jps_free().
+ **/
+int a_star_jps_prepare(const a_star_grid_t* grid, a_star_jps_t** jps);
+void a_star_jps_free(a_star_jps_t* jps);
+
+/**
+ * Same as a_star_grid_search(), using Jump Point Search: only jump points are
+ * expanded, and the path is returned cell by cell. With 'jps' given (JPS+),
+ * jumps are read from its tables instead of being scanned.
+ * Grids other than uniform-cost, 8-connected with corner cutting are searched
+ * with a_star_grid_search().
+ **/
+int a_star_jps_search(
+		const a_star_grid_t* grid,
+		const a_star_jps_t* jps,
+		a_star_search_ctx_t* ctx,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		);
+
+/**
+ * Bidirectional A*: grows one frontier from 'begin' (guided by h_dist(n, end)) and one
+ * from 'end' over the reverse edges (guided by h_dist(begin, n)), always expanding the
+ * smaller one, and stops once the best meeting path cannot be improved.
+ * The path is optimal when h_dist is consistent.
+ * Both contexts must hold the graph; otherwise same as a_star_search().
+ **/
+int a_star_bidir_search(
+		const a_star_csr_t* csr,
+		a_star_search_ctx_t* forward,
+		a_star_search_ctx_t* backward,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_distance_func_t h_dist,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_node_t*** path
+		);
+
+/**
+ * ALT preprocessing: picks up to 'nlandmarks' landmarks spread far apart and
+ * stores the exact distances from and to each of them (32-bit, per node).
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_alt_free().
+ **/
+int a_star_alt_build(const a_star_csr_t* csr, size_t nlandmarks, a_star_alt_t** alt);
+void a_star_alt_free(a_star_alt_t* alt);
+
+/**
+ * Writes/reads the tables to/from a file (native byte order).
+ * Loaded tables are only valid for a graph prepared from the same nodes and edges.
+ * Return 0 on success, or a negative value on error.
+ **/
+int a_star_alt_save(const a_star_alt_t* alt, const char* file);
+int a_star_alt_load(const char* file, a_star_alt_t** alt);
+
+/**
+ * Triangle-inequality lower bound on the distance between two node indices.
+ * The bound is consistent, so it is safe for a_star_bidir_search() as well.
+ **/
+long a_star_alt_estimate(const a_star_alt_t* alt, a_star_id_t n1, a_star_id_t n2);
+
+/**
+ * a_star_distance_func_t form of a_star_alt_estimate(), to be given as h_dist
+ * with the tables as cookie, on nodes numbered by a_star_graph_prepare().
+ **/
+long a_star_alt_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* alt);
+
+/**
+ * Contracts every node of the graph in order of importance, adding shortcut
+ * edges that preserve shortest distances among the remaining nodes.
+ * The hierarchy borrows the node array of a prepared graph, and copies the node
+ * handles of a loaded one; either way it does not refer to the CSR, which may be
+ * freed. Paths on a loaded graph list the hierarchy's handles.
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_ch_free().
+ **/
+int a_star_ch_build(const a_star_csr_t* csr, a_star_ch_t** ch);
+void a_star_ch_free(a_star_ch_t* ch);
+size_t a_star_ch_shortcuts(const a_star_ch_t* ch);	// number of shortcut edges added
+
+/**
+ * Bidirectional Dijkstra over the hierarchy, each side only moving to higher
+ * ranked nodes; shortcuts are unpacked, so the path lists original nodes.
+ * Both contexts must hold the graph; otherwise same as a_star_search().
+ **/
+int a_star_ch_search(
+		const a_star_ch_t* ch,
+		a_star_search_ctx_t* forward,
+		a_star_search_ctx_t* backward,
+		a_star_node_t* begin,
+		a_star_node_t* end,
+		a_star_node_t*** path
+		);
+
+/**
+ * Creates an incremental planner from cell 'begin' to cell 'end' of the grid.
+ * The planner keeps referring to the grid's obstacle and cost layers, which the
+ * caller may change between plans provided it reports the changed cells.
+ * Returns 0 on success, or a negative value on error.
+ * The planner should be deallocated using a_star_dstar_deinit().
+ **/
+int a_star_dstar_init(const a_star_grid_t* grid, a_star_id_t begin, a_star_id_t end, a_star_dstar_t** planner);
+void a_star_dstar_deinit(a_star_dstar_t* planner);
+
+/**
+ * Reports cells that were blocked, unblocked or had their cost changed since the
+ * last plan; the affected search state is repaired by the next plan.
+ * Returns 0 on success, or a negative value on error.
+ **/
+int a_star_dstar_update(a_star_dstar_t* planner, const a_star_id_t* cells, size_t ncells);
+
+/**
+ * Moves the start to another cell (e.g. as the agent follows the path), keeping
+ * the search state. Returns 0 on success, or a negative value on error.
+ **/
+int a_star_dstar_move(a_star_dstar_t* planner, a_star_id_t begin);
+
+/**
+ * Plans from the current start, reusing the state of the previous plan.
+ * Progress reports cell ids only, of the cells the repair expands.
+ * Returns length of path on success, or a negative value on error.
+ * If greater then zero, the returned array of cell ids should be deallocated using free().
+ **/
+int a_star_dstar_plan(a_star_dstar_t* planner, a_star_progress_func_t progress, void* cookie, a_star_id_t** path);
+
+/**
+ * HPA* preprocessing: cuts the grid into clusters of clusterSize x clusterSize
+ * cells (<= 0 for a default of 32), places entrances on the free runs of their
+ * borders and computes the distances across each cluster between its entrances,
+ * one cluster at a time on 'nthreads' threads (<= 0 for one per online CPU).
+ * The grid's obstacle and cost layers are borrowed; the caller may change them
+ * between searches provided it reports the changed cells.
+ * Returns 0 on success, or a negative value on error.
+ * The result should be deallocated using a_star_hpa_free().
+ **/
+int a_star_hpa_build(const a_star_grid_t* grid, int clusterSize, int nthreads, a_star_hpa_t** hpa);
+void a_star_hpa_free(a_star_hpa_t* hpa);
+
+/**
+ * Reports cells that were blocked, unblocked or had their cost changed; the
+ * clusters around them are rebuilt, the others are kept.
+ * Returns 0 on success, or a negative value on error.
+ **/
+int a_star_hpa_update(a_star_hpa_t* hpa, const a_star_id_t* cells, size_t ncells);
+
+/**
+ * Number of entrances, the nodes of the abstract graph.
+ **/
+size_t a_star_hpa_nodes(const a_star_hpa_t* hpa);
+
+/**
+ * Searches the abstract graph from cell 'begin' to cell 'end', then refines the
+ * abstract path into cells by searching only the clusters it crosses. Paths
+ * keep to the entrances between clusters, so they are near-optimal, typically
+ * within a few percent of the cheapest.
+ * One query at a time: the search state is kept in 'hpa'. Progress reports the
+ * cells of the entrances expanded.
+ * Returns length of path on success, or a negative value on error.
+ * If greater then zero, the returned array of cell ids should be deallocated using free().
+ **/
+int a_star_hpa_search(
+		a_star_hpa_t* hpa,
+		a_star_id_t begin,
+		a_star_id_t end,
+		a_star_progress_func_t progress,
+		void* cookie,
+		a_star_id_t** path
+		);
+
+/**
+ * Counters of the last abstract search, as a_star_search_ctx_stats() gives them.
+ **/
+int a_star_hpa_stats(const a_star_hpa_t* hpa, a_star_stats_t* stats);
+
+/**
+ * Computes the cost of the cheapest path from every cell of the grid to 'goal',
+ * and the first move of such a path, with the moves and costs of
+ * a_star_grid_search(). Delta-stepping settles the distances on 'nthreads'
+ * threads (<= 0 for one per online CPU); 5 bytes are kept per cell.
+ * The grid's obstacles and costs are borrowed, and must not change while the
+ * field is in use.
+ * Returns 0 on success, or a negative value on error (including grids on which
+ * a path could cost 2^32 or more).
+ * The result should be deallocated using a_star_flow_free().
+ **/
+int a_star_flow_build(const a_star_grid_t* grid, a_star_id_t goal, int nthreads, a_star_flow_t** flow);
+void a_star_flow_free(a_star_flow_t* flow);
+
+/**
+ * Cost of the cheapest path from 'cell' to the goal, or a negative value if there is none.
+ **/
+long a_star_flow_distance(const a_star_flow_t* flow, a_star_id_t cell);
+
+/**
+ * First move from 'cell' towards the goal, as a direction 0-7 (N, E, S, W, NW,
+ * NE, SE, SW), or a negative value at the goal and where there is no path.
+ **/
+int a_star_flow_direction(const a_star_flow_t* flow, a_star_id_t cell);
+
+/**
+ * Path from 'begin' to the goal, read off the field in time linear in its length.
+ * Returns length of path, 0 if there is none, or a negative value on error.
+ * If greater then zero, the returned array of cell ids should be deallocated using free().
+ **/
+int a_star_flow_path(const a_star_flow_t* flow, a_star_id_t begin, a_star_id_t** path);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,711 @@
+// a-star.hpp
+// Header-only C++17 A* engine. The graph, the heuristic, the open queue and the
+// cost type are template parameters, so that each combination gets a search loop
+// of its own with every edge scan, estimate and queue operation inlined.
+// Nodes are plain integer ids; nothing has to embed a_star_node_t.
+
+#ifndef _A_STAR_HPP_
+#define _A_STAR_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "a-star.h"
+
+namespace astar {
+
+/**
+ * Cost type properties: "no path yet" is infinity where the type has one, its
+ * maximum otherwise.
+ **/
+template<class Cost>
+struct cost_traits {
+	static constexpr Cost infinity() {
+		return std::numeric_limits<Cost>::has_infinity
+			? std::numeric_limits<Cost>::infinity() : std::numeric_limits<Cost>::max();
+	}
+};
+
+/**
+ * What the search needs from a graph: its node and cost types, its node count,
+ * and the edges leaving a node, passed one by one to f(to, cost).
+ * Specialise it to search a type of your own without wrapping it in an adapter.
+ **/
+template<class Graph>
+struct graph_traits {
+	using node_type = typename Graph::node_type;
+	using cost_type = typename Graph::cost_type;
+
+	static std::size_t size(const Graph& graph) {
+		return graph.size();
+	}
+	template<class F>
+	static void for_each_edge(const Graph& graph, node_type n, F&& f) {
+		graph.for_each_edge(n, std::forward<F>(f));
+	}
+};
+
+/*
+ * Graph adapters
+ */
+
+/**
+ * View of compressed-sparse-row arrays: the edges leaving node i are
+ * to[offsets[i]..offsets[i+1]-1] with matching cost[]. Nothing is copied.
+ **/
+template<class Cost = long, class Node = a_star_id_t>
+class csr_graph {
+public:
+	using node_type = Node;
+	using cost_type = Cost;
+
+	csr_graph(std::size_t nnodes, const std::size_t* offsets, const Node* to, const Cost* cost)
+		: nnodes_(nnodes), offsets_(offsets), to_(to), cost_(cost) {}
+	// forward edges of a graph prepared by a_star_graph_prepare() or loaded by a_star_csr_load()
+	explicit csr_graph(const a_star_csr_t& csr)
+		: csr_graph(csr.nnodes, csr.offsets, csr.to, csr.cost) {}
+
+	std::size_t size() const {
+		return nnodes_;
+	}
+	template<class F>
+	void for_each_edge(Node n, F&& f) const {
+		for(std::size_t i=offsets_[n]; i < offsets_[n+1]; i++)
+			f(to_[i], cost_[i]);
+	}
+
+private:
+	std::size_t nnodes_;
+	const std::size_t* offsets_;
+	const Node* to_;
+	const Cost* cost_;
+};
+
+template<class Cost, class Node = a_star_id_t>
+struct edge {
+	Node from, to;
+	Cost cost;
+};
+
+/**
+ * Explicit edge list, compiled on construction into the same CSR layout as
+ * a_star_graph_prepare() builds (stable, so the edges of a node keep their order).
+ **/
+template<class Cost = long, class Node = a_star_id_t>
+class edge_list_graph {
+public:
+	using node_type = Node;
+	using cost_type = Cost;
+
+	/**
+	 * 'edge_at(i)', for i in [0..nedges), returns the i-th edge as an astar::edge.
+	 **/
+	template<class EdgeAt>
+	edge_list_graph(std::size_t nnodes, std::size_t nedges, EdgeAt&& edge_at)
+			: offsets_(nnodes + 1, 0), to_(nedges), cost_(nedges) {
+		std::vector<edge<Cost, Node>> edges;
+		edges.reserve(nedges);
+		for(std::size_t i=0; i < nedges; i++) {
+			edges.push_back(edge_at(i));
+			offsets_[edges.back().from + 1]++;
+		}
+		for(std::size_t i=0; i < nnodes; i++)
+			offsets_[i+1] += offsets_[i];
+		std::vector<std::size_t> fill(offsets_.begin(), offsets_.end() - 1);
+		for(const auto& e : edges) {
+			std::size_t k = fill[e.from]++;
+			to_[k] = e.to;
+			cost_[k] = e.cost;
+		}
+	}
+	edge_list_graph(std::size_t nnodes, const std::vector<edge<Cost, Node>>& edges)
+		: edge_list_graph(nnodes, edges.size(), [&edges](std::size_t i) { return edges[i]; }) {}
+
+	std::size_t size() const {
+		return offsets_.size() - 1;
+	}
+	template<class F>
+	void for_each_edge(Node n, F&& f) const {
+		for(std::size_t i=offsets_[n]; i < offsets_[n+1]; i++)
+			f(to_[i], cost_[i]);
+	}
+
+private:
+	std::vector<std::size_t> offsets_;
+	std::vector<Node> to_;
+	std::vector<Cost> cost_;
+};
+
+/**
+ * Implicit grid (see a_star_grid_t), with the moves and costs of a_star_grid_search().
+ **/
+template<class Cost = long>
+class grid_graph {
+public:
+	using node_type = a_star_id_t;
+	using cost_type = Cost;
+
+	explicit grid_graph(const a_star_grid_t& grid) : grid_(grid) {}
+
+	std::size_t size() const {
+		return (std::size_t)grid_.rows * grid_.columns;
+	}
+	const a_star_grid_t& grid() const {
+		return grid_;
+	}
+	template<class F>
+	void for_each_edge(node_type n, F&& f) const {
+		// N, E, S, W, then NW, NE, SE, SW
+		static constexpr int dRows[8] = {-1, 0, 1, 0, -1, -1, 1, 1};
+		static constexpr int dCols[8] = {0, 1, 0, -1, -1, 1, 1, -1};
+		int row = n / grid_.columns, column = n % grid_.columns;
+		bool straight[4];
+		if( blocked(row, column) )
+			return;
+		for(int d=0; d < 4; d++)
+			if( (straight[d] = ! blocked(row + dRows[d], column + dCols[d])) )
+				move(row + dRows[d], column + dCols[d], A_STAR_STRAIGHT_COST, f);
+		if( grid_.connectivity != 8 )
+			return;
+		for(int d=4; d < 8; d++) {
+			int r = row + dRows[d], c = column + dCols[d];
+			// the straight moves flanking each diagonal: NW is N and W, NE is N and E, ...
+			if( blocked(r, c) )
+				continue;
+			if( ! grid_.cutCorners && ! (straight[d < 6 ? 0 : 2] && straight[d == 5 || d == 6 ? 1 : 3]) )
+				continue;
+			move(r, c, A_STAR_DIAGONAL_COST, f);
+		}
+	}
+
+private:
+	bool blocked(int row, int column) const {
+		return row < 0 || row >= grid_.rows || column < 0 || column >= grid_.columns
+			|| A_STAR_GRID_BLOCKED(&grid_, A_STAR_GRID_ID(&grid_, row, column));
+	}
+	template<class F>
+	void move(int row, int column, long step, F& f) const {
+		node_type to = A_STAR_GRID_ID(&grid_, row, column);
+		if( grid_.cost && grid_.cost[to] > 1 )
+			step *= grid_.cost[to];
+		f(to, (Cost)step);
+	}
+
+	const a_star_grid_t& grid_;
+};
+
+/*
+ * Heuristics: h(n, goal), a lower bound of the cost from node n to the goal
+ */
+
+struct zero_heuristic {
+	template<class Node>
+	constexpr long operator()(Node, Node) const {
+		return 0;
+	}
+};
+
+/**
+ * Built-in grid heuristic (see a_star_heuristic_t) fixed at compile time, in the
+ * integer cost units of grid_graph.
+ **/
+template<a_star_heuristic_t Kind>
+class grid_heuristic {
+public:
+	static_assert(Kind != ahDefault, "pick the heuristic matching the grid's connectivity");
+
+	explicit grid_heuristic(const a_star_grid_t& grid) : columns_(grid.columns) {}
+
+	long operator()(a_star_id_t n, a_star_id_t goal) const {
+		long dRow = (long)(n / columns_) - (long)(goal / columns_);
+		long dCol = (long)(n % columns_) - (long)(goal % columns_);
+		dRow = dRow < 0 ? -dRow : dRow;
+		dCol = dCol < 0 ? -dCol : dCol;
+		long lo = dRow < dCol ? dRow : dCol, hi = dRow < dCol ? dCol : dRow;
+		if constexpr( Kind == ahManhattan )
+			return A_STAR_STRAIGHT_COST * (dRow + dCol);
+		else if constexpr( Kind == ahChebyshev )
+			return A_STAR_STRAIGHT_COST * hi;
+		else if constexpr( Kind == ahEuclidean )
+			return isqrt(A_STAR_DIAGONAL_COST * A_STAR_DIAGONAL_COST / 2 * (dRow * dRow + dCol * dCol));
+		else
+			return A_STAR_DIAGONAL_COST * lo + A_STAR_STRAIGHT_COST * (hi - lo);
+	}
+
+private:
+	static long isqrt(long n) {
+		long r = (long)std::sqrt((double)n);
+		while( r * r > n )
+			r--;
+		while( (r + 1) * (r + 1) <= n )
+			r++;
+		return r;
+	}
+
+	int columns_;
+};
+
+/**
+ * Euclidean distance between node coordinates, 'dims' of them per node (as kept
+ * by a graph loaded with a_star_csr_load()), in the cost type of the search.
+ **/
+template<class Cost = long>
+class euclidean_heuristic {
+public:
+	euclidean_heuristic(const long* coords, std::size_t dims) : coords_(coords), dims_(dims) {}
+	explicit euclidean_heuristic(const a_star_csr_t& csr) : coords_(csr.coords), dims_(csr.dims) {}
+
+	Cost operator()(a_star_id_t n, a_star_id_t goal) const {
+		const long *c1 = &coords_[n * dims_], *c2 = &coords_[goal * dims_];
+		double sum = 0;
+		for(std::size_t d=0; d < dims_; d++)
+			sum += (double)(c1[d] - c2[d]) * (c1[d] - c2[d]);
+		return (Cost)std::sqrt(sum);
+	}
+
+private:
+	const long* coords_;
+	std::size_t dims_;
+};
+
+/*
+ * Open queues: min-priority queues of node ids in [0..capacity). Pushing a queued
+ * node changes its key. clear() only costs as much as the queue holds.
+ */
+
+/**
+ * Indexed d-ary heap, the default (as pqHeap).
+ **/
+template<class Cost, class Node = a_star_id_t>
+class dary_heap {
+public:
+	void reserve(std::size_t capacity) {
+		pos_.assign(capacity, npos);
+		heap_.clear();
+		heap_.reserve(capacity);
+	}
+	void clear() {
+		for(const auto& e : heap_)
+			pos_[e.id] = npos;
+		heap_.clear();
+	}
+	bool empty() const {
+		return heap_.empty();
+	}
+	std::size_t size() const {
+		return heap_.size();
+	}
+	void push(Node id, Cost key) {
+		std::size_t i = pos_[id];
+		if( i == npos ) {
+			heap_.push_back(entry{key, id});
+			sift_up(heap_.size() - 1);
+		} else if( key < heap_[i].key ) {
+			heap_[i].key = key;
+			sift_up(i);
+		} else if( key > heap_[i].key ) {
+			heap_[i].key = key;
+			sift_down(i);
+		}
+	}
+	Node pop() {
+		Node id = heap_[0].id;
+		pos_[id] = npos;
+		entry last = heap_.back();
+		heap_.pop_back();
+		if( ! heap_.empty() ) {
+			heap_[0] = last;
+			sift_down(0);
+		}
+		return id;
+	}
+
+private:
+	struct entry {
+		Cost key;
+		Node id;
+	};
+	static constexpr std::size_t npos = (std::size_t)-1;
+	static constexpr std::size_t D = 4;	// heap arity
+
+	void place(std::size_t i, const entry& e) {
+		heap_[i] = e;
+		pos_[e.id] = i;
+	}
+	void sift_up(std::size_t i) {
+		entry e = heap_[i];
+		while( i > 0 ) {
+			std::size_t parent = (i - 1) / D;
+			if( heap_[parent].key <= e.key )
+				break;
+			place(i, heap_[parent]);
+			i = parent;
+		}
+		place(i, e);
+	}
+	void sift_down(std::size_t i) {
+		entry e = heap_[i];
+		std::size_t len = heap_.size();
+		for(;;) {
+			std::size_t first = i * D + 1, last = first + D, best = i;
+			Cost bestKey = e.key;
+			if( first >= len )
+				break;
+			if( last > len )
+				last = len;
+			for(std::size_t c=first; c < last; c++)
+				if( heap_[c].key < bestKey ) {
+					best = c;
+					bestKey = heap_[c].key;
+				}
+			if( best == i )
+				break;
+			place(i, heap_[best]);
+			i = best;
+		}
+		place(i, e);
+	}
+
+	std::vector<entry> heap_;
+	std::vector<std::size_t> pos_;	// heap position per id, npos if not queued
+};
+
+/**
+ * Bucket per integer key (Dial, as pqBucket), LIFO within a bucket. Integer costs only.
+ **/
+template<class Cost, class Node = a_star_id_t>
+class bucket_queue {
+public:
+	static_assert(std::is_integral<Cost>::value, "bucket_queue needs integer costs");
+
+	void reserve(std::size_t capacity) {
+		key_.assign(capacity, 0);
+		next_.assign(capacity, none);
+		prev_.assign(capacity, none);
+		queued_.assign(capacity, 0);
+		heads_.assign(64, none);
+		len_ = 0;
+	}
+	void clear() {
+		for(std::size_t b=cursor_; len_ && b < heads_.size(); b++)
+			while( heads_[b] != none )
+				unlink(heads_[b]);
+		cursor_ = 0;
+	}
+	bool empty() const {
+		return ! len_;
+	}
+	std::size_t size() const {
+		return len_;
+	}
+	void push(Node id, Cost key) {
+		if( queued_[id] ) {
+			if( key_[id] == key )
+				return;
+			unlink(id);
+		}
+		link(id, key);
+	}
+	Node pop() {
+		while( heads_[cursor_] == none )
+			cursor_++;
+		Node id = heads_[cursor_];
+		unlink(id);
+		return id;
+	}
+
+private:
+	static constexpr Node none = std::numeric_limits<Node>::max();
+
+	void unlink(Node id) {
+		Node next = next_[id], prev = prev_[id];
+		if( prev != none )
+			next_[prev] = next;
+		else
+			heads_[(std::size_t)(key_[id] - base_)] = next;
+		if( next != none )
+			prev_[next] = prev;
+		queued_[id] = 0;
+		len_--;
+	}
+	void link(Node id, Cost key) {
+		if( ! len_ ) {
+			// every bucket is empty, start the range at this key
+			base_ = key;
+			cursor_ = 0;
+		} else if( key < base_ ) {
+			// the range grows downwards: shift the buckets up
+			heads_.insert(heads_.begin(), (std::size_t)(base_ - key), none);
+			base_ = key;
+			cursor_ = 0;
+		}
+		std::size_t b = (std::size_t)(key - base_);
+		if( b >= heads_.size() && cursor_ >= heads_.size() / 2 ) {
+			// the buckets below the cursor are empty: drop them rather than grow,
+			// when they are at least half, so that each move is paid for by pops
+			std::size_t drop = cursor_;
+			std::move(heads_.begin() + drop, heads_.end(), heads_.begin());
+			std::fill(heads_.end() - drop, heads_.end(), none);
+			base_ += (Cost)drop;
+			cursor_ = 0;
+			b -= drop;
+		}
+		if( b >= heads_.size() )
+			heads_.resize(b * 2, none);
+		key_[id] = key;
+		prev_[id] = none;
+		next_[id] = heads_[b];
+		if( heads_[b] != none )
+			prev_[heads_[b]] = id;
+		heads_[b] = id;
+		queued_[id] = 1;
+		len_++;
+		if( b < cursor_ )
+			cursor_ = b;
+	}
+
+	std::vector<Node> heads_;	// first id of each bucket, bucket i holds key base+i
+	std::vector<Cost> key_;
+	std::vector<Node> next_, prev_;
+	std::vector<unsigned char> queued_;
+	std::size_t len_ = 0, cursor_ = 0;	// no bucket below the cursor is used
+	Cost base_ = 0;
+};
+
+/**
+ * Ordered linked list (as pqList), FIFO among equal keys: linear time pushes.
+ **/
+template<class Cost, class Node = a_star_id_t>
+class list_queue {
+public:
+	void reserve(std::size_t capacity) {
+		key_.assign(capacity, 0);
+		next_.assign(capacity, none);
+		prev_.assign(capacity, none);
+		queued_.assign(capacity, 0);
+		head_ = none;
+		len_ = 0;
+	}
+	void clear() {
+		while( head_ != none )
+			pop();
+	}
+	bool empty() const {
+		return ! len_;
+	}
+	std::size_t size() const {
+		return len_;
+	}
+	void push(Node id, Cost key) {
+		Node c, p = none;
+		if( queued_[id] )
+			unlink(id);
+		key_[id] = key;
+		for(c=head_; c != none && ! (key < key_[c]); c=next_[c])
+			p = c;
+		next_[id] = c;
+		prev_[id] = p;
+		if( p != none )
+			next_[p] = id;
+		else
+			head_ = id;
+		if( c != none )
+			prev_[c] = id;
+		queued_[id] = 1;
+		len_++;
+	}
+	Node pop() {
+		Node id = head_;
+		unlink(id);
+		return id;
+	}
+
+private:
+	static constexpr Node none = std::numeric_limits<Node>::max();
+
+	void unlink(Node id) {
+		Node next = next_[id], prev = prev_[id];
+		if( prev != none )
+			next_[prev] = next;
+		else
+			head_ = next;
+		if( next != none )
+			prev_[next] = prev;
+		queued_[id] = 0;
+		len_--;
+	}
+
+	std::vector<Cost> key_;
+	std::vector<Node> next_, prev_;
+	std::vector<unsigned char> queued_;
+	Node head_ = none;
+	std::size_t len_ = 0;
+};
+
+/**
+ * Search observer whose calls compile away. A visitor of your own gets
+ * expand(n, h) as node n leaves the open queue, and examine(n) for every
+ * neighbour of it that is not closed.
+ **/
+struct null_visitor {
+	template<class Node, class Cost>
+	void expand(Node, Cost) {}
+	template<class Node>
+	void examine(Node) {}
+};
+
+/**
+ * A* search state over 'Graph', reusable for any number of queries one at a time:
+ * resetting it between queries costs as much as the previous query touched.
+ * 'Queue' is instantiated as Queue<Cost, node_type>; edge costs and estimates are
+ * converted to 'Cost'. The graph is referenced, so it must outlive the search.
+ **/
+template<
+	class Graph,
+	class Heuristic,
+	template<class, class> class Queue = dary_heap,
+	class Cost = typename graph_traits<Graph>::cost_type
+>
+class search {
+public:
+	using traits = graph_traits<Graph>;
+	using node_type = typename traits::node_type;
+	using cost_type = Cost;
+	static constexpr node_type none = std::numeric_limits<node_type>::max();
+
+	search(const Graph& graph, Heuristic h)
+			: graph_(graph), h_(std::move(h)), n_(traits::size(graph)),
+			g_(n_), h_cache_(n_), prev_(n_), stamp_(n_, 0), closed_(n_) {
+		open_.reserve(n_);
+	}
+
+	/**
+	 * Searches from 'begin' to 'end'. Returns true if a path was found; it is then
+	 * read with path() and its cost with cost(end).
+	 **/
+	template<class Visitor = null_visitor>
+	bool run(node_type begin, node_type end, Visitor&& visitor = Visitor()) {
+		if( begin >= n_ || end >= n_ )
+			return false;
+		reset();
+
+		touch(begin);
+		g_[begin] = 0;
+		h_cache_[begin] = (Cost)h_(begin, end);
+		open_.push(begin, h_cache_[begin]);
+		while( ! open_.empty() ) {
+			// the open queue is keyed by F-cost, so its top is the lowest
+			node_type curr = open_.pop();
+			expansions_++;
+			visitor.expand(curr, h_cache_[curr]);
+			closed_[curr] = 1;
+			if( curr == end )
+				return true;
+
+			Cost gCurr = g_[curr];
+			traits::for_each_edge(graph_, curr, [&](node_type neighbor, auto edgeCost) {
+				touch(neighbor);
+				if( ! closed_[neighbor] )
+					visitor.examine(neighbor);
+				Cost gCost = gCurr + (Cost)edgeCost;
+				if( ! (gCost < g_[neighbor]) )
+					return;
+				if( h_cache_[neighbor] == cost_traits<Cost>::infinity() )
+					h_cache_[neighbor] = (Cost)h_(neighbor, end);
+				g_[neighbor] = gCost;
+				prev_[neighbor] = curr;
+				// a cheaper way into a closed node re-opens it (inconsistent heuristics)
+				closed_[neighbor] = 0;
+				open_.push(neighbor, gCost + h_cache_[neighbor]);
+			});
+		}
+		return false;
+	}
+
+	/**
+	 * Cost of the best path found to 'n' by the last run(), infinity if none.
+	 **/
+	Cost cost(node_type n) const {
+		return n < n_ && stamp_[n] == generation_ ? g_[n] : cost_traits<Cost>::infinity();
+	}
+
+	/**
+	 * Path of the last run() to 'end', begin first, appended to 'out' (an output
+	 * iterator or a pointer to at least path_length(end) slots).
+	 **/
+	template<class OutputIt>
+	void path(node_type end, OutputIt out) const {
+		std::vector<node_type> steps;
+		for(node_type step=end; step != none; step=prev_[step])
+			steps.push_back(step);
+		for(auto i=steps.rbegin(); i != steps.rend(); ++i)
+			*out++ = *i;
+	}
+	std::size_t path_length(node_type end) const {
+		std::size_t n = 0;
+		for(node_type step=end; step != none; step=prev_[step])
+			n++;
+		return n;
+	}
+
+	/**
+	 * Nodes expanded by the last run().
+	 **/
+	std::size_t expansions() const {
+		return expansions_;
+	}
+
+private:
+	void reset() {
+		// stale stamps could only match again after the counter wraps around
+		if( ++generation_ == 0 ) {
+			std::fill(stamp_.begin(), stamp_.end(), 0);
+			generation_ = 1;
+		}
+		open_.clear();
+		expansions_ = 0;
+	}
+	void touch(node_type n) {
+		if( stamp_[n] != generation_ ) {
+			stamp_[n] = generation_;
+			g_[n] = h_cache_[n] = cost_traits<Cost>::infinity();
+			prev_[n] = none;
+			closed_[n] = 0;
+		}
+	}
+
+	const Graph& graph_;
+	Heuristic h_;
+	Queue<Cost, node_type> open_;
+	std::size_t n_;
+	std::vector<Cost> g_, h_cache_;
+	std::vector<node_type> prev_;
+	std::vector<unsigned int> stamp_;
+	std::vector<unsigned char> closed_;
+	unsigned int generation_ = 0;
+	std::size_t expansions_ = 0;
+};
+
+/**
+ * One-shot search: fills 'path' (begin first) and returns its length, 0 if there
+ * is no path.
+ **/
+template<template<class, class> class Queue = dary_heap, class Graph, class Heuristic>
+std::size_t shortest_path(const Graph& graph, Heuristic h, typename graph_traits<Graph>::node_type begin,
+		typename graph_traits<Graph>::node_type end, std::vector<typename graph_traits<Graph>::node_type>& path) {
+	search<Graph, Heuristic, Queue> s(graph, std::move(h));
+	path.clear();
+	if( ! s.run(begin, end) )
+		return 0;
+	s.path(end, std::back_inserter(path));
+	return path.size();
+}
+
+} // namespace astar
+
+#endif
@@ -0,0 +1,138 @@
+// arena.c
+
+#include "arena.h"
+
+#define	ALIGNMENT	16
+#define	ALIGN(n)	(((n) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+typedef struct _arena_block_t {
+	struct _arena_block_t* next;
+	size_t size, used;
+} arena_block_t;
+
+#define	BLOCK_DATA(b)	((char*)(b) + ALIGN(sizeof(arena_block_t)))
+
+typedef struct _arena_context_t {
+	arena_block_t *head, *current;
+	size_t blockSize, nblocks;
+} arena_context_t;
+
+typedef struct _pool_item_t {
+	struct _pool_item_t* next;
+} pool_item_t;
+
+typedef struct _pool_context_t {
+	arena_t* arena;
+	size_t elemSize;
+	pool_item_t* free;
+} pool_context_t;
+
+void arena_init(size_t blockSize, arena_t** a) {
+	arena_context_t* x = (arena_context_t*)malloc(sizeof(arena_context_t));
+	x->head = x->current = 0;
+	x->blockSize = blockSize ? blockSize : 64 * 1024;
+	x->nblocks = 0;
+	*a = x;
+}
+
+void arena_deinit(arena_t* a) {
+	arena_context_t* x = (arena_context_t*)a;
+	arena_block_t* b = x->head;
+	while( b ) {
+		arena_block_t* next = b->next;
+		free(b);
+		b = next;
+	}
+	free(x);
+}
+
+void arena_reset(arena_t* a) {
+	arena_context_t* x = (arena_context_t*)a;
+	arena_block_t* b;
+	for(b=x->head; b; b=b->next)
+		b->used = 0;
+	x->current = x->head;
+}
+
+void* arena_alloc(arena_t* a, size_t size) {
+	arena_context_t* x = (arena_context_t*)a;
+	arena_block_t* b = x->current;
+	size = ALIGN(size ? size : 1);
+	// move on to the next retained block that fits
+	while( b && b->used + size > b->size )
+		b = b->next;
+	if( ! b ) {
+		size_t blockSize = size > x->blockSize ? size : x->blockSize;
+		b = (arena_block_t*)malloc(ALIGN(sizeof(arena_block_t)) + blockSize);
+		if( ! b )
+			return 0;
+		b->size = blockSize;
+		b->used = 0;
+		// appended after the current block, to be reused in this order after a reset
+		if( x->current ) {
+			b->next = x->current->next;
+			x->current->next = b;
+		} else {
+			b->next = x->head;
+			x->head = b;
+		}
+		x->nblocks++;
+	}
+	x->current = b;
+	void* p = BLOCK_DATA(b) + b->used;
+	b->used += size;
+	return p;
+}
+
+size_t arena_blocks(arena_t* a) {
+	arena_context_t* x = (arena_context_t*)a;
+	return x->nblocks;
+}
+
+void pool_init(size_t elemSize, size_t elemsPerBlock, pool_t** p) {
+	pool_context_t* x = (pool_context_t*)malloc(sizeof(pool_context_t));
+	x->elemSize = ALIGN(elemSize < sizeof(pool_item_t) ? sizeof(pool_item_t) : elemSize);
+	x->free = 0;
+	arena_init(x->elemSize * (elemsPerBlock ? elemsPerBlock : 1024), &x->arena);
+	*p = x;
+}
+
+void pool_deinit(pool_t* p) {
+	pool_context_t* x = (pool_context_t*)p;
+	arena_deinit(x->arena);
+	free(x);
+}
+
+void* pool_alloc(pool_t* p) {
+	pool_context_t* x = (pool_context_t*)p;
+	pool_item_t* e = x->free;
+	if( e ) {
+		x->free = e->next;
+		return e;
+	}
+	return arena_alloc(x->arena, x->elemSize);
+}
+
+void pool_release(pool_t* p, void* e) {
+	pool_context_t* x = (pool_context_t*)p;
+	pool_item_t* item = (pool_item_t*)e;
+	if( ! e )
+		return;
+	item->next = x->free;
+	x->free = item;
+}
+
+static void* _poolAlloc(size_t size, void* cookie) {
+	pool_context_t* x = (pool_context_t*)cookie;
+	return size <= x->elemSize ? pool_alloc(x) : 0;
+}
+
+static void _poolRelease(void* e, void* cookie) {
+	pool_release(cookie, e);
+}
+
+void pool_allocator(pool_t* p, allocator_t* allocator) {
+	allocator->alloc = _poolAlloc;
+	allocator->release = _poolRelease;
+	allocator->cookie = p;
+}
@@ -0,0 +1,41 @@
+// arena.h
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdlib.h>
+
+/**
+ * Pluggable allocator. A null allocator_t pointer stands for malloc()/free().
+ **/
+typedef struct _allocator_t {
+	void*(*alloc)(size_t size, void* cookie);
+	void(*release)(void* p, void* cookie);
+	void* cookie;
+} allocator_t;
+
+/**
+ * Arena: bump allocation from large blocks. Memory is given back all at once
+ * by arena_reset(), which keeps the blocks for reuse, or arena_deinit().
+ **/
+typedef void arena_t;
+
+void arena_init(size_t blockSize, arena_t** a);
+void arena_deinit(arena_t* a);
+void arena_reset(arena_t* a);
+void* arena_alloc(arena_t* a, size_t size);
+size_t arena_blocks(arena_t* a);	// number of blocks obtained from malloc() so far
+
+/**
+ * Pool: fixed-size elements carved from a private arena and recycled through a
+ * free list, so that steady-state alloc/release cycles never reach malloc().
+ **/
+typedef void pool_t;
+
+void pool_init(size_t elemSize, size_t elemsPerBlock, pool_t** p);
+void pool_deinit(pool_t* p);
+void* pool_alloc(pool_t* p);
+void pool_release(pool_t* p, void* e);
+void pool_allocator(pool_t* p, allocator_t* allocator);	// allocator_t view of the pool
+
+#endif
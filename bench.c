@@ -0,0 +1,422 @@
+// bench.c
+// a-star-bench: times the search engines over a matrix of seeded random maps.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "a-star.h"
+#include "_version.h"
+
+#define	MAX_VALUES	16
+
+typedef enum _bench_engine_t {
+	beGrid	= 0,	// implicit grid
+	beGraph	= 1,	// explicit graph, prepared once per map
+	beJps	= 2,	// jump point search
+	beJpsPlus	= 3,	// jump point search with precomputed jumps
+	beHpa	= 4,	// hierarchical search over clusters, built once per map
+} bench_engine_t;
+
+static const char* engineNames[] = {"grid", "graph", "jps", "jps+", "hpa", 0};
+static const char* queueNames[] = {"heap", "list", "bucket", 0};
+
+typedef struct _bench_list_t {
+	int values[MAX_VALUES];
+	int n;
+} bench_list_t;
+
+typedef struct _bench_parameters_t {
+	bench_list_t sizes, barriers, connectivity, engines, queues;
+	int seeds, queries, json;
+} bench_parameters_t;
+static bench_parameters_t parameters;
+
+typedef struct _bench_map_t {
+	a_star_grid_t grid;
+	unsigned char* obstacles;
+	a_star_id_t* ends;	// begin/end cell pairs, one per query
+	// explicit graph engine: a node per cell (blocked ones unconnected)
+	a_star_node_t* nodes;
+	a_star_graph_t graph;
+	a_star_csr_t* csr;
+	long expanded;	// counted by the progress callback
+} bench_map_t;
+
+typedef struct _bench_result_t {
+	int found;
+	double wallNs;
+	long expanded;
+	long allocs;
+	long peakRss;	// KiB
+} bench_result_t;
+
+/**
+ * Allocation counting: on glibc the allocator entry points are interposed here,
+ * so calls from the (statically linked) library are counted as well.
+ **/
+static long nallocs;
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+void* malloc(size_t size) { nallocs++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size) { nallocs++; return __libc_calloc(n, size); }
+void* realloc(void* p, size_t size) { nallocs++; return __libc_realloc(p, size); }
+#	define	ALLOCS_COUNTED	1
+#else
+#	define	ALLOCS_COUNTED	0
+#endif
+
+/**
+ * splitmix64, so that a seed gives the same map on every platform.
+ **/
+static unsigned long long rngState;
+static unsigned long long rng_next() {
+	unsigned long long z = (rngState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static double now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss() {
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;	// bytes there
+#else
+	return ru.ru_maxrss;
+#endif
+}
+
+/**
+ * Octile/Manhattan distance between graph nodes, which are indexed like cells.
+ **/
+static long graph_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	const bench_map_t* m = (const bench_map_t*)cookie;
+	const a_star_grid_t* g = &m->grid;
+	long dRow = labs((long)((n1 - m->nodes) / g->columns) - (long)((n2 - m->nodes) / g->columns));
+	long dCol = labs((long)((n1 - m->nodes) % g->columns) - (long)((n2 - m->nodes) % g->columns));
+	if( g->connectivity != 8 )
+		return A_STAR_STRAIGHT_COST * (dRow + dCol);
+	return dRow < dCol
+		? A_STAR_DIAGONAL_COST * dRow + A_STAR_STRAIGHT_COST * (dCol - dRow)
+		: A_STAR_DIAGONAL_COST * dCol + A_STAR_STRAIGHT_COST * (dRow - dCol);
+}
+
+static void create_graph(bench_map_t* m) {
+	static const int dRows[8] = {-1, 0, 1, 0, -1, -1, 1, 1};
+	static const int dCols[8] = {0, 1, 0, -1, -1, 1, 1, -1};
+	const a_star_grid_t* g = &m->grid;
+	size_t i, ncells = (size_t)g->rows * g->columns;
+	int d;
+
+	m->nodes = (a_star_node_t*)calloc(ncells, sizeof(a_star_node_t));
+	m->graph.nodes = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * ncells);
+	m->graph.edges = (a_star_edge_t**)malloc(sizeof(a_star_edge_t*) * ncells * g->connectivity);
+	m->graph.nnodes = ncells;
+	m->graph.nedges = 0;
+	for(i=0; i < ncells; i++) {
+		int row = i / g->columns, column = i % g->columns;
+		m->graph.nodes[i] = &m->nodes[i];
+		if( A_STAR_GRID_BLOCKED(g, i) )
+			continue;
+		for(d=0; d < g->connectivity; d++) {
+			int r = row + dRows[d], c = column + dCols[d];
+			if( r < 0 || r >= g->rows || c < 0 || c >= g->columns || A_STAR_GRID_BLOCKED(g, A_STAR_GRID_ID(g, r, c)) )
+				continue;
+			a_star_edge_t* e = (a_star_edge_t*)malloc(sizeof(a_star_edge_t));
+			e->from = &m->nodes[i];
+			e->to = &m->nodes[A_STAR_GRID_ID(g, r, c)];
+			e->cost = 0;
+			m->graph.edges[m->graph.nedges++] = e;
+		}
+	}
+	m->graph.begin = m->graph.end = 0;
+	if( a_star_graph_prepare(&m->graph, graph_distance, m, &m->csr) < 0 ) {
+		fprintf(stderr, "Failed preparing the graph!\n");
+		exit(99);
+	}
+}
+
+static void create_map(bench_map_t* m, int size, int barriers, int connectivity, int seed, int withGraph) {
+	size_t i, ncells = (size_t)size * size;
+	rngState = (unsigned long long)seed;
+	m->obstacles = (unsigned char*)calloc(A_STAR_GRID_BITMAP_SIZE(size, size), 1);
+	for(i=0; i < ncells; i++)
+		if( rng_next() % 100 < (unsigned)barriers )
+			m->obstacles[i >> 3] |= 1U << (i & 7);
+	m->grid.rows = m->grid.columns = size;
+	m->grid.obstacles = m->obstacles;
+	m->grid.cost = 0;
+	m->grid.connectivity = connectivity;
+	m->grid.cutCorners = 1;
+	m->grid.heuristic = ahDefault;
+	// query ends are kept free
+	m->ends = (a_star_id_t*)malloc(sizeof(a_star_id_t) * 2 * parameters.queries);
+	for(i=0; i < 2 * (size_t)parameters.queries; i++) {
+		m->ends[i] = (a_star_id_t)(rng_next() % ncells);
+		m->obstacles[m->ends[i] >> 3] &= ~(1U << (m->ends[i] & 7));
+	}
+	m->nodes = 0;
+	m->graph.nodes = 0;
+	m->graph.edges = 0;
+	m->graph.nedges = 0;
+	m->csr = 0;
+	if( withGraph )
+		create_graph(m);
+}
+
+static void free_map(bench_map_t* m) {
+	size_t i;
+	a_star_csr_free(m->csr);
+	for(i=0; i < m->graph.nedges; i++)
+		free(m->graph.edges[i]);
+	free(m->graph.edges);
+	free(m->graph.nodes);
+	free(m->nodes);
+	free(m->ends);
+	free(m->obstacles);
+}
+
+static void count_expansions(const a_star_progress_info_t* info, void* cookie) {
+	// the expanded node is reported as both the analized and the current one
+	if( info->analizedId == info->currentId )
+		((bench_map_t*)cookie)->expanded++;
+}
+
+/**
+ * One query; expansions are counted into the map when asked.
+ **/
+static int run_query(bench_map_t* m, bench_engine_t engine, a_star_jps_t* jps, a_star_hpa_t* hpa,
+		a_star_search_ctx_t* ctx, a_star_id_t begin, a_star_id_t end, int count) {
+	a_star_progress_func_t progress = count ? count_expansions : 0;
+	int n;
+	switch( engine ) {
+		case beGraph: {
+			a_star_node_t** path;
+			n = a_star_search(m->csr, ctx, &m->nodes[begin], &m->nodes[end], graph_distance, progress, m, &path);
+			if( n > 0 )
+				free(path);
+			break;
+		}
+		case beJps:
+		case beJpsPlus: {
+			a_star_id_t* path;
+			n = a_star_jps_search(&m->grid, jps, ctx, begin, end, progress, m, &path);
+			if( n > 0 )
+				free(path);
+			break;
+		}
+		case beHpa: {
+			a_star_id_t* path;
+			n = a_star_hpa_search(hpa, begin, end, progress, m, &path);
+			if( n > 0 )
+				free(path);
+			break;
+		}
+		case beGrid:
+		default: {
+			a_star_id_t* path;
+			n = a_star_grid_search(&m->grid, ctx, begin, end, progress, m, &path);
+			if( n > 0 )
+				free(path);
+			break;
+		}
+	}
+	return n;
+}
+
+static void run_config(bench_map_t* m, bench_engine_t engine, a_star_queue_t queue, bench_result_t* result) {
+	a_star_search_ctx_t* ctx;
+	a_star_jps_t* jps = 0;
+	a_star_hpa_t* hpa = 0;
+	a_star_stats_t stats;
+	int q, counted=1;
+	double start;
+
+	memset(result, 0, sizeof(bench_result_t));
+	if( a_star_search_ctx_init((size_t)m->grid.rows * m->grid.columns, queue, &ctx) < 0 ) {
+		fprintf(stderr, "Failed allocating search context!\n");
+		exit(99);
+	}
+	if( engine == beJpsPlus && a_star_jps_prepare(&m->grid, &jps) < 0 )
+		jps = 0;	// plain grid search for unsupported grids
+	if( engine == beHpa && a_star_hpa_build(&m->grid, 0, 0, &hpa) < 0 ) {
+		fprintf(stderr, "Failed building the cluster hierarchy!\n");
+		exit(99);
+	}
+
+	// timed pass without progress callbacks, expansions come from the search statistics
+	nallocs = 0;
+	start = now_ns();
+	for(q=0; q < parameters.queries; q++) {
+		if( run_query(m, engine, jps, hpa, ctx, m->ends[2*q], m->ends[2*q+1], 0) > 0 )
+			result->found++;
+		// hpa expansions are those of its abstract graph
+		if( (engine == beHpa ? a_star_hpa_stats(hpa, &stats) : a_star_search_ctx_stats(ctx, &stats)) < 0 )
+			counted = 0;
+		result->expanded += stats.expansions;
+	}
+	result->wallNs = now_ns() - start;
+	result->allocs = ALLOCS_COUNTED ? nallocs : -1;
+	if( ! counted ) {
+		// a library built without statistics: count through the progress callback instead
+		m->expanded = 0;
+		for(q=0; q < parameters.queries; q++)
+			run_query(m, engine, jps, hpa, ctx, m->ends[2*q], m->ends[2*q+1], 1);
+		result->expanded = m->expanded;
+	}
+	result->peakRss = peak_rss();
+
+	a_star_jps_free(jps);
+	a_star_hpa_free(hpa);
+	a_star_search_ctx_deinit(ctx);
+}
+
+static void print_result(int first, bench_engine_t engine, a_star_queue_t queue, int size, int barriers,
+		int connectivity, int seed, const bench_result_t* r) {
+	double wallMs = r->wallNs / 1e6;
+	double perSecond = r->wallNs > 0 ? r->expanded / (r->wallNs / 1e9) : 0;
+	double nsPerExpansion = r->expanded ? r->wallNs / r->expanded : 0;
+	if( parameters.json ) {
+		printf("%s\n  {\"engine\": \"%s\", \"queue\": \"%s\", \"size\": %d, \"barriers\": %d, \"connectivity\": %d, "
+			"\"seed\": %d, \"queries\": %d, \"found\": %d, \"wall_ms\": %.3f, \"expanded\": %ld, "
+			"\"expansions_per_sec\": %.0f, \"ns_per_expansion\": %.1f, \"allocs\": %ld, \"peak_rss_kb\": %ld}",
+			first ? "" : ",", engineNames[engine], queueNames[queue], size, barriers, connectivity,
+			seed, parameters.queries, r->found, wallMs, r->expanded,
+			perSecond, nsPerExpansion, r->allocs, r->peakRss);
+	} else {
+		if( first )
+			printf("engine,queue,size,barriers,connectivity,seed,queries,found,wall_ms,expanded,"
+				"expansions_per_sec,ns_per_expansion,allocs,peak_rss_kb\n");
+		printf("%s,%s,%d,%d,%d,%d,%d,%d,%.3f,%ld,%.0f,%.1f,%ld,%ld\n",
+			engineNames[engine], queueNames[queue], size, barriers, connectivity,
+			seed, parameters.queries, r->found, wallMs, r->expanded,
+			perSecond, nsPerExpansion, r->allocs, r->peakRss);
+	}
+	fflush(stdout);
+}
+
+/**
+ * Parses a comma separated list of numbers, or of names when 'names' is given.
+ **/
+static void parse_list(const char* arg, const char** names, bench_list_t* list) {
+	char* copy = strdup(arg);
+	char *token, *save;
+	list->n = 0;
+	for(token=strtok_r(copy, ",", &save); token && list->n < MAX_VALUES; token=strtok_r(0, ",", &save)) {
+		if( names ) {
+			int i;
+			for(i=0; names[i] && strcasecmp(names[i], token) != 0; i++)
+				;
+			if( ! names[i] ) {
+				fprintf(stderr, "Invalid value '%s'!\n", token);
+				exit(99);
+			}
+			list->values[list->n++] = i;
+		} else
+			list->values[list->n++] = atoi(token);
+	}
+	free(copy);
+}
+
+static const char __help[] =
+"a-star-bench - benchmarks the a-star search engines\n"
+"-------------------------------------------------------\n"
+"Usage:\n"
+"	a-star-bench {r|b|d|s|n|x|q|j|h}\n"
+"Options:\n"
+"	-r <size>{,<size>}\n"
+"		Square grid sizes (default: 64,256,1024)\n"
+"	-b <ratio>{,<ratio>}\n"
+"		Barrier ratios in procentage (default: 0,20,35)\n"
+"	-d <4|8>{,<4|8>}\n"
+"		Connectivity, 8 allows cutting corners (default: 4,8)\n"
+"	-s <seeds>\n"
+"		#of random maps per combination, seeded 1..seeds (default: 3)\n"
+"	-n <queries>\n"
+"		#of random queries per map (default: 20)\n"
+"	-x <grid|graph|jps|jps+|hpa>{,...}\n"
+"		Search engines (default: grid)\n"
+"	-q <heap|list|bucket>{,...}\n"
+"		Open list implementations (default: heap)\n"
+"	-j\n"
+"		JSON output (default: CSV)\n"
+"	-h\n"
+"		Show this help information\n"
+"Expansions are taken from the search statistics. Allocations are counted on glibc\n"
+"only (-1 elsewhere); peak RSS is that of the whole run so far.\n"
+;
+
+int main(int argc, char** argv) {
+	int opt, s, b, d, e, q, seed, first = 1;
+
+	parse_list("64,256,1024", 0, &parameters.sizes);
+	parse_list("0,20,35", 0, &parameters.barriers);
+	parse_list("4,8", 0, &parameters.connectivity);
+	parse_list("grid", engineNames, &parameters.engines);
+	parse_list("heap", queueNames, &parameters.queues);
+	parameters.seeds = 3;
+	parameters.queries = 20;
+	parameters.json = 0;
+
+	while( (opt=getopt(argc, argv, "r:b:d:s:n:x:q:jh")) != -1 ) {
+		switch( opt ) {
+			case 'r': parse_list(optarg, 0, &parameters.sizes); break;
+			case 'b': parse_list(optarg, 0, &parameters.barriers); break;
+			case 'd': parse_list(optarg, 0, &parameters.connectivity); break;
+			case 's': parameters.seeds = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'n': parameters.queries = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'x': parse_list(optarg, engineNames, &parameters.engines); break;
+			case 'q': parse_list(optarg, queueNames, &parameters.queues); break;
+			case 'j': parameters.json = 1; break;
+			case 'h':
+			default:
+				printf("%s\n", __help);
+				exit(opt == 'h' ? 0 : 99);
+		}
+	}
+	for(d=0; d < parameters.connectivity.n; d++)
+		if( parameters.connectivity.values[d] != 4 && parameters.connectivity.values[d] != 8 ) {
+			fprintf(stderr, "Invalid connectivity!\n");
+			exit(99);
+		}
+
+	if( parameters.json )
+		printf("{\"version\": \"%s\", \"results\": [", appversion());
+	for(s=0; s < parameters.sizes.n; s++)
+		for(b=0; b < parameters.barriers.n; b++)
+			for(d=0; d < parameters.connectivity.n; d++)
+				for(seed=1; seed <= parameters.seeds; seed++) {
+					bench_map_t map;
+					int withGraph = 0;
+					for(e=0; e < parameters.engines.n; e++)
+						withGraph |= parameters.engines.values[e] == beGraph;
+					create_map(&map, parameters.sizes.values[s], parameters.barriers.values[b],
+						parameters.connectivity.values[d], seed, withGraph);
+					for(e=0; e < parameters.engines.n; e++)
+						for(q=0; q < parameters.queues.n; q++) {
+							bench_result_t result;
+							run_config(&map, parameters.engines.values[e], parameters.queues.values[q], &result);
+							print_result(first, parameters.engines.values[e], parameters.queues.values[q],
+								parameters.sizes.values[s], parameters.barriers.values[b],
+								parameters.connectivity.values[d], seed, &result);
+							first = 0;
+						}
+					free_map(&map);
+				}
+	if( parameters.json )
+		printf("\n]}\n");
+
+	return 0;
+}
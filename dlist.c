@@ -13,15 +13,40 @@ typedef struct _dlist_context_t {
 	dlist_dtor dtor;
 	void* context;
 	size_t len;
+	allocator_t allocator;
 } dlist_context_t;
 
+static inline dlist_node_t* node_alloc(dlist_context_t* x) {
+	return (dlist_node_t*)(x->allocator.alloc
+		? (*x->allocator.alloc)(sizeof(dlist_node_t), x->allocator.cookie)
+		: malloc(sizeof(dlist_node_t)));
+}
+
+static inline void node_free(dlist_context_t* x, dlist_node_t* n) {
+	if( x->allocator.release )
+		(*x->allocator.release)(n, x->allocator.cookie);
+	else
+		free(n);
+}
+
+size_t dlist_node_size() {
+	return sizeof(dlist_node_t);
+}
+
 void dlist_init(dlist_dtor dtor, dlist_predicate_t pred, void* context, dlist_t** l) {
+	dlist_init_ex(dtor, pred, context, 0, l);
+}
+
+void dlist_init_ex(dlist_dtor dtor, dlist_predicate_t pred, void* context, const allocator_t* allocator, dlist_t** l) {
 	dlist_context_t* x = (dlist_context_t*)malloc(sizeof(dlist_context_t));
 	x->dtor = dtor;
 	x->pred = pred;
 	x->context = context;
 	x->head = x->tail = 0;
 	x->len = 0;
+	x->allocator.alloc = allocator ? allocator->alloc : 0;
+	x->allocator.release = allocator ? allocator->release : 0;
+	x->allocator.cookie = allocator ? allocator->cookie : 0;
 	*l = x;
 }
 
@@ -37,7 +62,7 @@ void dlist_reset(dlist_t* l) {
 		dlist_node_t* next = e->next;
 		if( e->data && x->dtor )
 			(*x->dtor)(e->data);
-		free(e);
+		node_free(x, e);
 		e = next;
 	}
 	x->head = x->tail = 0;
@@ -55,7 +80,7 @@ void dlist_push_back(dlist_t* l, void* e) {
 		dlist_push_ordered(l, e);
 		return;
 	}
-	dlist_node_t* n = (dlist_node_t*)malloc(sizeof(dlist_node_t));
+	dlist_node_t* n = node_alloc(x);
 	n->next = 0;
 	n->prev = x->tail;
 	n->data = e;
@@ -73,7 +98,7 @@ void dlist_push_front(dlist_t* l, void* e) {
 		dlist_push_ordered(l, e);
 		return;
 	}
-	dlist_node_t* n = (dlist_node_t*)malloc(sizeof(dlist_node_t));
+	dlist_node_t* n = node_alloc(x);
 	n->data = e;
 	n->prev = 0;
 	n->next = x->head;
@@ -92,7 +117,7 @@ void dlist_push_ordered(dlist_t* l, void* e) {
 		return;
 	}
 	dlist_node_t* c;
-	dlist_node_t* n = (dlist_node_t*)malloc(sizeof(dlist_node_t));
+	dlist_node_t* n = node_alloc(x);
 	n->data = e;
 	n->prev = n->next = 0;
 	c = x->head;
@@ -102,14 +127,15 @@ void dlist_push_ordered(dlist_t* l, void* e) {
 		c = c->next;
 	}
 	n->next = c;
-	if( c ) {
-		if( c->prev )
-			c->prev->next = n;
+	n->prev = c ? c->prev : x->tail;
+	if( n->prev )
+		n->prev->next = n;
+	else
+		x->head = n;
+	if( c )
 		c->prev = n;
-	} else
+	else
 		x->tail = n;
-	if( x->head == c )
-		x->head = n;
 	++x->len;
 }
 
@@ -169,7 +195,7 @@ void dlist_remove(dlist_t* l, void* elem) {
 				x->tail = e->prev;
 			if( e->data && x->dtor )
 				(*x->dtor)(e->data);
-			free(e);
+			node_free(x, e);
 			x->len--;
 			break;
 		}
@@ -219,7 +245,7 @@ void* dlist_pop_front(dlist_t* l) {
 	else
 		x->tail = 0;
 	x->head = e->next;
-	free(e);
+	node_free(x, e);
 	x->len--;
 	return data;
 }
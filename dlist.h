@@ -4,12 +4,14 @@
 #define _DLIST_H_
 
 #include <stdlib.h>
+#include "arena.h"
 
 typedef void dlist_t;
 typedef void(*dlist_dtor)(void*);
 typedef int(*dlist_predicate_t)(const void* e1, const void* e2, void* context);
 
 void dlist_init(dlist_dtor dtor, dlist_predicate_t pred, void* context, dlist_t** l);
+void dlist_init_ex(dlist_dtor dtor, dlist_predicate_t pred, void* context, const allocator_t* allocator, dlist_t** l);
 void dlist_deinit(dlist_t* l);
 void dlist_reset(dlist_t* l);
 size_t dlist_len(dlist_t* l);
@@ -24,5 +26,6 @@ int dlist_enum_ex(dlist_t* l, int(*cb)(int index, void* data, void* cookie), voi
 void dlist_detach(dlist_t* l, size_t* n, void*** a);
 void dlist_toarray(dlist_t* l, size_t* n, void*** a);
 void* dlist_get_front(dlist_t* l);
+size_t dlist_node_size();	// bytes allocated per element, for sizing pool allocators
 
 #endif
@@ -27,11 +27,33 @@ typedef enum _options_t {
 	oAnimate	= 1U << 1,
 } options_t;
 
+typedef enum _engine_t {
+	eGraph	= 0,	// explicit edge list
+	eGrid	= 1,	// implicit grid
+	eJps	= 2,	// jump point search
+	eJpsPlus	= 3,	// jump point search with precomputed jumps
+	eBidir	= 4,	// bidirectional search of the explicit graph
+	eCh	= 5,	// contraction hierarchy of the explicit graph
+	eDstar	= 6,	// incremental replanning over barrier edits
+	eFlow	= 7,	// flow field of every cell towards the end
+	eHpa	= 8,	// hierarchical search over clusters of cells
+	eAra	= 9,	// anytime weighted search of the explicit graph
+} engine_t;
+
 typedef struct _app_parameters_t {
 	int rows, columns, barriers, startRow, startCol, endRow, endCol;
 	unsigned int options;
+	a_star_queue_t queue;
+	engine_t engine;
+	int landmarks;
+	const char* map;	// map file, instead of random barriers
+	a_star_heuristic_t heuristic;	// of the grid engines
+	int clusterSize;	// of the hpa engine
+	double weight;	// initial inflation of the ara engine
+	int deadline;	// ms, of the ara engine, 0 if none
 } app_parameters_t;
 static app_parameters_t parameters={0};
+static a_star_alt_t* alt=0;
 
 typedef enum _cell_attributes_t {
 	caRegular	= 0,
@@ -47,6 +69,7 @@ typedef struct _cell_t {
 	a_star_node_t a;
 	int row, column;
 	unsigned int attributes;
+	signed char flow;	// first move towards the end in a flow field, -1 if none
 } cell_t;
 
 typedef struct _edge_t {
@@ -102,6 +125,7 @@ static grid_t* create_grid(int rows, int columns) {
 			cell->row = r;
 			cell->column = c;
 			cell->attributes = 0;
+			cell->flow = -1;
 		}
 	setEnds(g, getcell(g, 0, 0), getcell(g, rows-1, columns-1));
 	return g;
@@ -110,6 +134,32 @@ static void free_grid(grid_t* g) {
 	free(g->g);
 	free(g);
 }
+static grid_t* load_grid(const char* file) {
+	a_star_map_reader_t* reader;
+	unsigned char* blocked;
+	int rows, columns, r, c;
+	grid_t* g;
+
+	if( a_star_map_open(file, &reader, &rows, &columns) < 0 )
+		return 0;
+	g = create_grid(rows, columns);
+	// one row at a time, the file is never held in memory
+	blocked = (unsigned char*)malloc(columns);
+	for(r=0; r < rows; r++) {
+		if( a_star_map_read_row(reader, blocked) != 1 ) {
+			free(blocked);
+			free_grid(g);
+			a_star_map_close(reader);
+			return 0;
+		}
+		for(c=0; c < columns; c++)
+			if( blocked[c] )
+				getcell(g, r, c)->attributes |= caBarrier;
+	}
+	free(blocked);
+	a_star_map_close(reader);
+	return g;
+}
 static void set_random_barriers(grid_t* g, int ratio) {
 	int i, nBarriers;
 	ratio = minmax(ratio, 0, 90);
@@ -191,13 +241,29 @@ static void free_graph(a_star_graph_t* graph) {
 	free(graph->edges);
 	free(graph);
 }
+static unsigned char* obstacles_from_grid(const grid_t* g) {
+	int i, ncells = g->rows * g->columns;
+	unsigned char* obstacles = (unsigned char*)calloc(A_STAR_GRID_BITMAP_SIZE(g->rows, g->columns), 1);
+	for(i=0; i < ncells; i++)
+		if( g->g[i].attributes & caBarrier )
+			obstacles[i >> 3] |= 1U << (i & 7);
+	return obstacles;
+}
 static long distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
 	const cell_t* c1 = (const cell_t*)n1;
 	const cell_t* c2 = (const cell_t*)n2;
 	long dRow = c2->row - c1->row;
 	long dCol = c2->column - c1->column;
-	return floor(10 * pow(dRow * dRow + dCol * dCol, .5));
+	return (long)sqrt(100.0 * (dRow * dRow + dCol * dCol));
+}
+static long alt_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	// both bounds are consistent, so is the larger one
+	long h1 = a_star_alt_distance(n1, n2, alt), h2 = distance(n1, n2, cookie);
+	return h1 > h2 ? h1 : h2;
 }
+// flow field directions, in a_star_flow_direction() order
+static const char* const arrows[8] = {"\u2191", "\u2192", "\u2193", "\u2190", "\u2196", "\u2197", "\u2198", "\u2199"};
+
 static void draw(const grid_t* g, const a_star_progress_info_t* progress) {
 	int r, c;
 	if( parameters.options & oAnimate ) {
@@ -230,6 +296,8 @@ static void draw(const grid_t* g, const a_star_progress_info_t* progress) {
 				printf("\e[97mA");
 			else if( cell->attributes & caAnalized )
 				printf("\e[34m?");
+			else if( cell->flow >= 0 )
+				printf("\e[36m%s", arrows[(int)cell->flow]);
 			else
 				printf("\e[90m.");
 			printf("\e[0m  ");
@@ -257,6 +325,8 @@ static void drawPlain(const grid_t* g) {
 				printf("A");
 			else if( cell->attributes & caAnalized )
 				printf("?");
+			else if( cell->flow >= 0 )
+				printf("%s", arrows[(int)cell->flow]);
 			else
 				printf(".");
 			printf("  ");
@@ -270,14 +340,16 @@ static void apply_path(grid_t* g, int n, cell_t** steps) {
 		steps[i]->attributes |= caPathStep;
 }
 static void progress(const a_star_progress_info_t* pi, void* cookie) {
-	cell_t* cAnalized = (cell_t*)pi->analized;
+	grid_t* grid = (grid_t*)cookie;
+	// graph nodes are cells, implicit grid ids are cell indices
+	cell_t* cAnalized = pi->analized ? (cell_t*)pi->analized
+		: pi->analizedId != A_STAR_NONE ? &grid->g[pi->analizedId] : 0;
 	if( cAnalized )
 		cAnalized->attributes |= caAnalized;
-	if( cookie ) {
-		grid_t* grid = (grid_t*)cookie;
+	if( parameters.options & oAnimate ) {
 		if( grid->current )
 			grid->current->attributes &= ~caCurrent;
-		grid->current = (cell_t*)pi->current;
+		grid->current = pi->current ? (cell_t*)pi->current : &grid->g[pi->currentId];
 		grid->current->attributes |= caCurrent;
 		draw(grid, pi);
 		usleep(1000*10);
@@ -288,42 +360,277 @@ typedef struct _barrier_t {
 	int fromRow, fromCol;
 	int toRow, toCol;
 } barrier_t;
+static int barrier_cells(const grid_t* g, const barrier_t* b, cell_t** cells) {
+	int n = 0;
+	if( b->toRow < 0 || b->toCol < 0 ) {
+		// single dot
+		cell_t* c = getcell(g, b->fromRow, b->fromCol);
+		if( c && (c->attributes & (caStart | caEnd))==0 )
+			cells[n++] = c;
+	} else if( b->fromRow == b->toRow ) {
+		// horizontal line
+		int i;
+		for(i=b->fromCol; i <= b->toCol; i++) {
+			cell_t* c = getcell(g, b->fromRow, i);
+			if( c && (c->attributes & (caStart | caEnd))==0 )
+				cells[n++] = c;
+		}
+	} else if( b->fromCol == b->toCol ) {
+		// vertical line
+		int i;
+		for(i=b->fromRow; i <= b->toRow; i++) {
+			cell_t* c = getcell(g, i, b->fromCol);
+			if( c && (c->attributes & (caStart | caEnd))==0 )
+				cells[n++] = c;
+		}
+	}
+	return n;
+}
 static void applyBarrierSpecs(grid_t* g, dlist_t* barriers) {
+	cell_t** cells = (cell_t**)malloc(sizeof(cell_t*) * max(g->rows, g->columns));
 	for(;;) {
 		barrier_t* b = (barrier_t*)dlist_pop_front(barriers);
+		int i, n;
 		if( ! b )
 			break;
-		if( b->toRow < 0 || b->toCol < 0 ) {
-			// single dot
-			cell_t* c = getcell(g, b->fromRow, b->fromCol);
-			if( c && (c->attributes & (caStart | caEnd))==0 )
-				c->attributes |= caBarrier;
-		} else if( b->fromRow == b->toRow ) {
-			// horizontal line
-			int i;
-			for(i=b->fromCol; i <= b->toCol; i++) {
-				cell_t* c = getcell(g, b->fromRow, i);
-				if( c && (c->attributes & (caStart | caEnd))==0 )
-					c->attributes |= caBarrier;
-			}
-		} else if( b->fromCol == b->toCol ) {
-			// vertical line
-			int i;
-			for(i=b->fromRow; i <= b->toRow; i++) {
-				cell_t* c = getcell(g, i, b->fromCol);
-				if( c && (c->attributes & (caStart | caEnd))==0 )
-					c->attributes |= caBarrier;
+		n = barrier_cells(g, b, cells);
+		for(i=0; i < n; i++)
+			cells[i]->attributes |= caBarrier;
+		free(b);
+	}
+	free(cells);
+}
+
+static void improve(a_star_node_t* const* path, int n, long cost, double bound, void* cookie) {
+	fprintf(stderr, "Path of %d steps, cost %ld, within %.2f of the cheapest\n", n, cost, bound);
+}
+
+static int search_graph(grid_t* grid, cell_t*** path) {
+	a_star_graph_t* graph;
+	a_star_csr_t* csr;
+	a_star_distance_func_t h_dist = distance;
+	int n;
+
+	graph_from_grid(grid, &graph);
+	if( a_star_graph_prepare(graph, distance, 0, &csr) < 0 ) {
+		fprintf(stderr, "Failed preparing the graph!\n");
+		exit(99);
+	}
+	if( parameters.landmarks > 0 ) {
+		if( a_star_alt_build(csr, parameters.landmarks, &alt) < 0 ) {
+			fprintf(stderr, "Failed building the landmark tables!\n");
+			exit(99);
+		}
+		h_dist = alt_distance;
+	}
+
+	if( parameters.engine == eAra ) {
+		a_star_search_ctx_t* ctx;
+		double bound;
+		if( a_star_search_ctx_init(csr->nnodes, parameters.queue, &ctx) < 0 ) {
+			fprintf(stderr, "Failed allocating search context!\n");
+			exit(99);
+		}
+		n=a_star_search_anytime(csr, ctx, graph->begin, graph->end, h_dist, parameters.weight,
+				parameters.deadline * 1000UL, progress, improve, grid, (a_star_node_t***)path, &bound);
+		a_star_search_ctx_deinit(ctx);
+	} else if( parameters.engine == eBidir || parameters.engine == eCh ) {
+		a_star_search_ctx_t *forward, *backward;
+		if( a_star_search_ctx_init(csr->nnodes, parameters.queue, &forward) < 0
+				|| a_star_search_ctx_init(csr->nnodes, parameters.queue, &backward) < 0 ) {
+			fprintf(stderr, "Failed allocating search context!\n");
+			exit(99);
+		}
+		if( parameters.engine == eCh ) {
+			a_star_ch_t* ch;
+			if( a_star_ch_build(csr, &ch) < 0 ) {
+				fprintf(stderr, "Failed building the contraction hierarchy!\n");
+				exit(99);
 			}
+			n=a_star_ch_search(ch, forward, backward, graph->begin, graph->end, (a_star_node_t***)path);
+			a_star_ch_free(ch);
+		} else
+			n=a_star_bidir_search(csr, forward, backward, graph->begin, graph->end, h_dist, progress,
+					grid, (a_star_node_t***)path);
+		a_star_search_ctx_deinit(forward);
+		a_star_search_ctx_deinit(backward);
+	} else
+		n=a_star_csr_shortest_path(csr, graph->begin, graph->end, h_dist, progress,
+				grid, parameters.queue, (a_star_node_t***)path);
+
+	a_star_alt_free(alt);
+	alt = 0;
+	a_star_csr_free(csr);
+	free_graph(graph);
+	return n;
+}
+static int search_grid(grid_t* grid, cell_t*** path) {
+	a_star_grid_t ag;
+	a_star_jps_t* jps=0;
+	a_star_search_ctx_t* ctx;
+	a_star_id_t* ids=0;
+	int i, n;
+
+	ag.rows = grid->rows;
+	ag.columns = grid->columns;
+	ag.obstacles = obstacles_from_grid(grid);
+	ag.cost = 0;
+	ag.connectivity = (parameters.options & oCutCorners) ? 8 : 4;
+	ag.cutCorners = 1;
+	ag.heuristic = parameters.heuristic;
+
+	if( a_star_search_ctx_init((size_t)grid->rows * grid->columns, parameters.queue, &ctx) < 0 ) {
+		fprintf(stderr, "Failed allocating search context!\n");
+		exit(99);
+	}
+
+	if( parameters.engine == eJpsPlus && a_star_jps_prepare(&ag, &jps) < 0 )
+		jps = 0; // not applicable, plain search below
+
+	if( parameters.engine == eJps || jps )
+		n=a_star_jps_search(&ag, jps, ctx, grid->start - grid->g, grid->end - grid->g, progress, grid, &ids);
+	else
+		n=a_star_grid_search(&ag, ctx, grid->start - grid->g, grid->end - grid->g, progress, grid, &ids);
+	if( n > 0 ) {
+		*path = (cell_t**)malloc(sizeof(cell_t*) * n);
+		for(i=0; i < n; i++)
+			(*path)[i] = &grid->g[ids[i]];
+	}
+
+	free(ids);
+	a_star_jps_free(jps);
+	a_star_search_ctx_deinit(ctx);
+	free((void*)ag.obstacles);
+	return n;
+}
+
+static int search_dstar(grid_t* grid, dlist_t* edits, cell_t*** path) {
+	a_star_grid_t ag;
+	a_star_dstar_t* planner;
+	a_star_id_t *ids=0, *changed;
+	cell_t** cells;
+	int i, n;
+
+	ag.rows = grid->rows;
+	ag.columns = grid->columns;
+	ag.obstacles = obstacles_from_grid(grid);
+	ag.cost = 0;
+	ag.connectivity = (parameters.options & oCutCorners) ? 8 : 4;
+	ag.cutCorners = 1;
+	ag.heuristic = parameters.heuristic;
+
+	if( a_star_dstar_init(&ag, grid->start - grid->g, grid->end - grid->g, &planner) < 0 ) {
+		fprintf(stderr, "Failed creating the planner!\n");
+		exit(99);
+	}
+	cells = (cell_t**)malloc(sizeof(cell_t*) * max(grid->rows, grid->columns));
+	changed = (a_star_id_t*)malloc(sizeof(a_star_id_t) * max(grid->rows, grid->columns));
+
+	// plan once, then replay the edits: each one toggles its cells and repairs the plan
+	n = a_star_dstar_plan(planner, progress, grid, &ids);
+	for(;;) {
+		barrier_t* b = (barrier_t*)dlist_pop_front(edits);
+		int k;
+		if( ! b )
+			break;
+		k = barrier_cells(grid, b, cells);
+		for(i=0; i < k; i++) {
+			changed[i] = cells[i] - grid->g;
+			cells[i]->attributes ^= caBarrier;
+			((unsigned char*)ag.obstacles)[changed[i] >> 3] ^= 1U << (changed[i] & 7);
 		}
 		free(b);
+		// only the cells of this repair are shown as analized
+		for(i=0; i < grid->rows * grid->columns; i++)
+			grid->g[i].attributes &= ~caAnalized;
+		a_star_dstar_update(planner, changed, k);
+		free(ids);
+		n = a_star_dstar_plan(planner, progress, grid, &ids);
+	}
+	if( n > 0 ) {
+		*path = (cell_t**)malloc(sizeof(cell_t*) * n);
+		for(i=0; i < n; i++)
+			(*path)[i] = &grid->g[ids[i]];
+	}
+
+	free(ids);
+	free(changed);
+	free(cells);
+	a_star_dstar_deinit(planner);
+	free((void*)ag.obstacles);
+	return n;
+}
+
+static int search_flow(grid_t* grid, cell_t*** path) {
+	a_star_grid_t ag;
+	a_star_flow_t* flow;
+	a_star_id_t* ids=0;
+	int i, n;
+
+	ag.rows = grid->rows;
+	ag.columns = grid->columns;
+	ag.obstacles = obstacles_from_grid(grid);
+	ag.cost = 0;
+	ag.connectivity = (parameters.options & oCutCorners) ? 8 : 4;
+	ag.cutCorners = 1;
+	ag.heuristic = parameters.heuristic;
+
+	if( a_star_flow_build(&ag, grid->end - grid->g, 0, &flow) < 0 ) {
+		fprintf(stderr, "Failed building the flow field!\n");
+		exit(99);
+	}
+	for(i=0; i < grid->rows * grid->columns; i++)
+		grid->g[i].flow = (signed char)a_star_flow_direction(flow, i);
+
+	n = a_star_flow_path(flow, grid->start - grid->g, &ids);
+	if( n > 0 ) {
+		*path = (cell_t**)malloc(sizeof(cell_t*) * n);
+		for(i=0; i < n; i++)
+			(*path)[i] = &grid->g[ids[i]];
+	}
+
+	free(ids);
+	a_star_flow_free(flow);
+	free((void*)ag.obstacles);
+	return n;
+}
+
+static int search_hpa(grid_t* grid, cell_t*** path) {
+	a_star_grid_t ag;
+	a_star_hpa_t* hpa;
+	a_star_id_t* ids=0;
+	int i, n;
+
+	ag.rows = grid->rows;
+	ag.columns = grid->columns;
+	ag.obstacles = obstacles_from_grid(grid);
+	ag.cost = 0;
+	ag.connectivity = (parameters.options & oCutCorners) ? 8 : 4;
+	ag.cutCorners = 1;
+	ag.heuristic = parameters.heuristic;
+
+	if( a_star_hpa_build(&ag, parameters.clusterSize, 0, &hpa) < 0 ) {
+		fprintf(stderr, "Failed building the cluster hierarchy!\n");
+		exit(99);
+	}
+	n = a_star_hpa_search(hpa, grid->start - grid->g, grid->end - grid->g, progress, grid, &ids);
+	if( n > 0 ) {
+		*path = (cell_t**)malloc(sizeof(cell_t*) * n);
+		for(i=0; i < n; i++)
+			(*path)[i] = &grid->g[ids[i]];
 	}
+
+	free(ids);
+	a_star_hpa_free(hpa);
+	free((void*)ag.obstacles);
+	return n;
 }
 
 static const char __help[] =
 "a-star - an A* Path Finding Algorithm Visualizer\n"
 "-------------------------------------------------------\n"
 "Usage:\n"
-"	a-start {r|c|b|s|e|l|a|d|h}\n"
+"	a-start {r|c|b|s|e|m|l|q|x|L|H|k|w|t|a|d|h}\n"
 "Options:\n"
 "	-r <rows>\n"
 "		#of rows\n"
@@ -335,8 +642,37 @@ static const char __help[] =
 "		Path start point (0-based)\n"
 "	-e <row:col>\n"
 "		Path end point (0-based)\n"
+"	-m <file>\n"
+"		Load the map from a MovingAI .map file or a binary PGM occupancy\n"
+"		grid instead of placing random barriers; -r and -c are ignored\n"
 "	-l <row>:<col>{..<row>:<col>}\n"
 "		Barrier point/line. Diagonal lines are not allowed.\n"
+"	-q <heap|list|bucket>\n"
+"		Open list implementation (default: heap)\n"
+"	-x <graph|bidir|ch|grid|jps|jps+|dstar|flow|hpa|ara>\n"
+"		Search engine: explicit graph (optionally bidirectional or over a\n"
+"		contraction hierarchy), implicit grid, or jump point search\n"
+"		(JPS needs -d, otherwise the grid engine is used) (default: graph)\n"
+"		dstar plans on the random barriers, then replays the -l edits one\n"
+"		by one, each toggling its cells, and repairs the plan after each\n"
+"		flow computes the first move of every cell towards the end point,\n"
+"		drawn as arrows, and reads the path off it\n"
+"		hpa searches the entrances between clusters of cells first, shown\n"
+"		as analized, then the cells of the clusters on the way\n"
+"		ara finds a path with an inflated heuristic first, then cheaper\n"
+"		ones until the cheapest is found or the deadline passes\n"
+"	-L <landmarks>\n"
+"		Use the ALT landmark heuristic with this many landmarks (graph engines)\n"
+"	-H <manhattan|octile|chebyshev|euclidean>\n"
+"		Heuristic of the grid engines (default: octile with -d, otherwise\n"
+"		manhattan)\n"
+"	-k <cells>\n"
+"		Cluster side of the hpa engine (default: 8)\n"
+"	-w <weight>\n"
+"		Initial heuristic inflation of the ara engine (default: 3)\n"
+"	-t <ms>\n"
+"		Deadline of the ara engine; the first path is always completed\n"
+"		(default: none)\n"
 "	-a\n"
 "		Animate\n"
 "	-d\n"
@@ -347,7 +683,6 @@ static const char __help[] =
 
 int main(int argc, char** argv) {
 	grid_t* grid;
-	a_star_graph_t* graph;
 	cell_t** path=0;
 	dlist_t* l_barriers;
 	int n, opt;
@@ -355,6 +690,8 @@ int main(int argc, char** argv) {
 	parameters.rows=20;
 	parameters.columns=20;
 	parameters.barriers=30;
+	parameters.clusterSize=8;
+	parameters.weight=3;
 	parameters.startRow=parameters.startCol=parameters.endRow=parameters.endCol=-1;
 
 	dlist_init(free, 0, 0, &l_barriers);
@@ -364,7 +701,7 @@ int main(int argc, char** argv) {
 		parameters.columns = (parameters.columns / 3) * 90 / 100; // 90% of the current terminal height
 	}
 
-	while( (opt=getopt(argc, argv, "r:c:b:s:e:l:adh")) != -1 ) {
+	while( (opt=getopt(argc, argv, "r:c:b:s:e:l:m:q:x:L:H:k:w:t:adh")) != -1 ) {
 		switch( opt ) {
 			case 'r': {
 				parameters.rows=max(atoi(optarg), 4);
@@ -379,15 +716,89 @@ int main(int argc, char** argv) {
 				break;
 			}
 			case 's': {
-				int c = sscanf(optarg, "%d:%d", &parameters.startRow, &parameters.startCol);
-				if( c > 0 ) parameters.startRow = minmax(parameters.startRow, 0, parameters.rows-1);
-				if( c > 1 ) parameters.startCol = minmax(parameters.startCol, 0, parameters.columns-1);
+				// clamped once the grid size is known
+				sscanf(optarg, "%d:%d", &parameters.startRow, &parameters.startCol);
 				break;
 			}
 			case 'e': {
-				int c = sscanf(optarg, "%d:%d", &parameters.endRow, &parameters.endCol);
-				if( c > 0 ) parameters.endRow = minmax(parameters.endRow, 0, parameters.rows-1);
-				if( c > 1 ) parameters.endCol = minmax(parameters.endCol, 0, parameters.columns-1);
+				sscanf(optarg, "%d:%d", &parameters.endRow, &parameters.endCol);
+				break;
+			}
+			case 'q': {
+				if( strcasecmp(optarg, "heap") == 0 )
+					parameters.queue = aqHeap;
+				else if( strcasecmp(optarg, "list") == 0 )
+					parameters.queue = aqList;
+				else if( strcasecmp(optarg, "bucket") == 0 )
+					parameters.queue = aqBucket;
+				else {
+					fprintf(stderr, "Invalid queue type!\n");
+					exit(99);
+				}
+				break;
+			}
+			case 'x': {
+				if( strcasecmp(optarg, "graph") == 0 )
+					parameters.engine = eGraph;
+				else if( strcasecmp(optarg, "bidir") == 0 )
+					parameters.engine = eBidir;
+				else if( strcasecmp(optarg, "ch") == 0 )
+					parameters.engine = eCh;
+				else if( strcasecmp(optarg, "dstar") == 0 )
+					parameters.engine = eDstar;
+				else if( strcasecmp(optarg, "flow") == 0 )
+					parameters.engine = eFlow;
+				else if( strcasecmp(optarg, "hpa") == 0 )
+					parameters.engine = eHpa;
+				else if( strcasecmp(optarg, "ara") == 0 )
+					parameters.engine = eAra;
+				else if( strcasecmp(optarg, "grid") == 0 )
+					parameters.engine = eGrid;
+				else if( strcasecmp(optarg, "jps") == 0 )
+					parameters.engine = eJps;
+				else if( strcasecmp(optarg, "jps+") == 0 )
+					parameters.engine = eJpsPlus;
+				else {
+					fprintf(stderr, "Invalid search engine!\n");
+					exit(99);
+				}
+				break;
+			}
+			case 'm': {
+				parameters.map = optarg;
+				break;
+			}
+			case 'L': {
+				parameters.landmarks=max(atoi(optarg), 0);
+				break;
+			}
+			case 'H': {
+				if( strcasecmp(optarg, "manhattan") == 0 )
+					parameters.heuristic = ahManhattan;
+				else if( strcasecmp(optarg, "octile") == 0 )
+					parameters.heuristic = ahOctile;
+				else if( strcasecmp(optarg, "chebyshev") == 0 )
+					parameters.heuristic = ahChebyshev;
+				else if( strcasecmp(optarg, "euclidean") == 0 )
+					parameters.heuristic = ahEuclidean;
+				else {
+					fprintf(stderr, "Invalid heuristic!\n");
+					exit(99);
+				}
+				break;
+			}
+			case 'k': {
+				parameters.clusterSize=max(atoi(optarg), 2);
+				break;
+			}
+			case 'w': {
+				parameters.weight=atof(optarg);
+				if( parameters.weight < 1 )
+					parameters.weight = 1;
+				break;
+			}
+			case 't': {
+				parameters.deadline=max(atoi(optarg), 0);
 				break;
 			}
 			case 'a': {
@@ -428,6 +839,16 @@ int main(int argc, char** argv) {
 		}
 	}
 
+	if( parameters.map ) {
+		if( ! (grid = load_grid(parameters.map)) ) {
+			fprintf(stderr, "Failed loading the map!\n");
+			exit(99);
+		}
+		parameters.rows = grid->rows;
+		parameters.columns = grid->columns;
+	} else
+		grid = create_grid(parameters.rows, parameters.columns);
+
 	if( parameters.startRow < 0)
 		parameters.startRow = 0;
 	if( parameters.startCol < 0 )
@@ -436,25 +857,48 @@ int main(int argc, char** argv) {
 		parameters.endRow = parameters.rows - 1;
 	if( parameters.endCol < 0 )
 		parameters.endCol = parameters.columns - 1;
+	parameters.startRow = min(parameters.startRow, parameters.rows-1);
+	parameters.startCol = min(parameters.startCol, parameters.columns-1);
+	parameters.endRow = min(parameters.endRow, parameters.rows-1);
+	parameters.endCol = min(parameters.endCol, parameters.columns-1);
 
-	grid = create_grid(parameters.rows, parameters.columns);
 	setEnds(grid,
 		getcell(grid, parameters.startRow, parameters.startCol),
 		getcell(grid, parameters.endRow, parameters.endCol));
+	if( (grid->start->attributes | grid->end->attributes) & caBarrier ) {
+		fprintf(stderr, "The start or end point is blocked!\n");
+		exit(99);
+	}
 
-	if( dlist_len(l_barriers) )
+	if( dlist_len(l_barriers) && parameters.engine != eDstar )
 		applyBarrierSpecs(grid, l_barriers);
-	else
+	else if( ! parameters.map )
 		set_random_barriers(grid, parameters.barriers);
 
-	graph_from_grid(grid, &graph);
-
 	// clear screen
 	if( parameters.options & oAnimate )
 		printf("\e[1;1H\e[2J"); // clear screen
 
-	n=a_star_shortest_path(graph, distance, distance, progress,
-			(parameters.options & oAnimate) ? grid : 0, (a_star_node_t***)&path);
+	switch( parameters.engine ) {
+		case eGrid:
+		case eJps:
+		case eJpsPlus:
+			n = search_grid(grid, &path);
+			break;
+		case eDstar:
+			n = search_dstar(grid, l_barriers, &path);
+			break;
+		case eFlow:
+			n = search_flow(grid, &path);
+			break;
+		case eHpa:
+			n = search_hpa(grid, &path);
+			break;
+		case eGraph:
+		default:
+			n = search_graph(grid, &path);
+			break;
+	}
 	if( n > 0 ) {
 		apply_path(grid, n, path);
 	}
@@ -471,7 +915,6 @@ int main(int argc, char** argv) {
 
 	dlist_deinit(l_barriers);
 	free(path);
-	free_graph(graph);
 	free_grid(grid);
 
 	return n == 0;
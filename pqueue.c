@@ -0,0 +1,349 @@
+// pqueue.c
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include "dlist.h"
+#include "pqueue.h"
+
+#define	HEAP_D	4	// heap arity
+
+typedef struct _pqueue_entry_t {
+	long key;
+	unsigned int id;
+} pqueue_entry_t;
+
+typedef struct _pqueue_context_t {
+	pqueue_kind_t kind;
+	size_t capacity, len;
+	unsigned int* pos;	// per-id heap position (or list membership), PQUEUE_NONE if not queued
+	// pqHeap
+	pqueue_entry_t* heap;
+	// pqList
+	dlist_t* list;
+	long* keys;	// (also pqBucket)
+	// pqBucket
+	unsigned int* heads;	// first id of each bucket, bucket i holds key base+i
+	unsigned int *next, *prev;	// per-id bucket links
+	size_t nbuckets, cursor;	// no bucket below the cursor is used
+	long base;
+} pqueue_context_t;
+
+#define	LIST_DATA(id)	((void*)((uintptr_t)(id) + 1))
+#define	LIST_ID(d)		((unsigned int)((uintptr_t)(d) - 1))
+
+static int _cmpListItems(const void* e1, const void* e2, void* context) {
+	const pqueue_context_t* x = (const pqueue_context_t*)context;
+	long k1 = x->keys[LIST_ID(e1)];
+	long k2 = x->keys[LIST_ID(e2)];
+	return k1 < k2 ? -1 : k1 > k2;
+}
+
+static inline void heap_place(pqueue_context_t* x, size_t i, pqueue_entry_t e) {
+	x->heap[i] = e;
+	x->pos[e.id] = (unsigned int)i;
+}
+
+static void heap_sift_up(pqueue_context_t* x, size_t i) {
+	pqueue_entry_t e = x->heap[i];
+	while( i > 0 ) {
+		size_t parent = (i - 1) / HEAP_D;
+		if( x->heap[parent].key <= e.key )
+			break;
+		heap_place(x, i, x->heap[parent]);
+		i = parent;
+	}
+	heap_place(x, i, e);
+}
+
+static void heap_sift_down(pqueue_context_t* x, size_t i) {
+	pqueue_entry_t e = x->heap[i];
+	for(;;) {
+		size_t c, first = i * HEAP_D + 1, last = first + HEAP_D, best = i;
+		long bestKey = e.key;
+		if( first >= x->len )
+			break;
+		if( last > x->len )
+			last = x->len;
+		for(c=first; c < last; c++)
+			if( x->heap[c].key < bestKey ) {
+				best = c;
+				bestKey = x->heap[c].key;
+			}
+		if( best == i )
+			break;
+		heap_place(x, i, x->heap[best]);
+		i = best;
+	}
+	heap_place(x, i, e);
+}
+
+static void heap_remove_at(pqueue_context_t* x, size_t i) {
+	unsigned int id = x->heap[i].id;
+	x->pos[id] = PQUEUE_NONE;
+	if( i == --x->len )
+		return;
+	long key = x->heap[i].key;
+	heap_place(x, i, x->heap[x->len]);
+	if( x->heap[i].key < key )
+		heap_sift_up(x, i);
+	else
+		heap_sift_down(x, i);
+}
+
+static void bucket_unlink(pqueue_context_t* x, unsigned int id) {
+	unsigned int next = x->next[id], prev = x->prev[id];
+	if( prev != PQUEUE_NONE )
+		x->next[prev] = next;
+	else
+		x->heads[x->keys[id] - x->base] = next;
+	if( next != PQUEUE_NONE )
+		x->prev[next] = prev;
+	x->pos[id] = PQUEUE_NONE;
+	x->len--;
+}
+
+static void bucket_link(pqueue_context_t* x, unsigned int id, long key) {
+	size_t i;
+	if( ! x->len ) {
+		// every bucket is empty, start the range at this key
+		x->base = key;
+		x->cursor = 0;
+	} else if( key < x->base ) {
+		// the range grows downwards: shift the buckets up
+		size_t shift = (size_t)(x->base - key), used = x->nbuckets;
+		while( used && x->heads[used-1] == PQUEUE_NONE )
+			used--;
+		if( used + shift > x->nbuckets ) {
+			while( used + shift > x->nbuckets )
+				x->nbuckets *= 2;
+			x->heads = (unsigned int*)realloc(x->heads, sizeof(unsigned int) * x->nbuckets);
+		}
+		memmove(x->heads + shift, x->heads, sizeof(unsigned int) * used);
+		for(i=0; i < shift; i++)
+			x->heads[i] = PQUEUE_NONE;
+		for(i=used + shift; i < x->nbuckets; i++)
+			x->heads[i] = PQUEUE_NONE;
+		x->base = key;
+		x->cursor = 0;
+	}
+	size_t b = (size_t)(key - x->base);
+	if( b >= x->nbuckets && x->cursor >= x->nbuckets / 2 ) {
+		// the buckets below the cursor are empty: drop them rather than grow,
+		// when they are at least half, so that each move is paid for by pops
+		size_t drop = x->cursor;
+		memmove(x->heads, x->heads + drop, sizeof(unsigned int) * (x->nbuckets - drop));
+		for(i=x->nbuckets - drop; i < x->nbuckets; i++)
+			x->heads[i] = PQUEUE_NONE;
+		x->base += drop;
+		x->cursor = 0;
+		b -= drop;
+	}
+	if( b >= x->nbuckets ) {
+		size_t n = x->nbuckets;
+		while( b >= x->nbuckets )
+			x->nbuckets *= 2;
+		x->heads = (unsigned int*)realloc(x->heads, sizeof(unsigned int) * x->nbuckets);
+		for(i=n; i < x->nbuckets; i++)
+			x->heads[i] = PQUEUE_NONE;
+	}
+	// LIFO within a bucket: among equal F-costs the latest (deepest) node comes first
+	x->keys[id] = key;
+	x->prev[id] = PQUEUE_NONE;
+	x->next[id] = x->heads[b];
+	if( x->heads[b] != PQUEUE_NONE )
+		x->prev[x->heads[b]] = id;
+	x->heads[b] = id;
+	x->pos[id] = 0;
+	x->len++;
+	if( b < x->cursor )
+		x->cursor = b;
+}
+
+static unsigned int bucket_top(pqueue_context_t* x) {
+	while( x->heads[x->cursor] == PQUEUE_NONE )
+		x->cursor++;
+	return x->heads[x->cursor];
+}
+
+void pqueue_init(pqueue_kind_t kind, size_t capacity, const allocator_t* allocator, pqueue_t** q) {
+	size_t i;
+	pqueue_context_t* x = (pqueue_context_t*)malloc(sizeof(pqueue_context_t));
+	x->kind = kind;
+	x->capacity = capacity;
+	x->len = 0;
+	x->pos = (unsigned int*)malloc(sizeof(unsigned int) * capacity);
+	for(i=0; i < capacity; i++)
+		x->pos[i] = PQUEUE_NONE;
+	x->heap = 0;
+	x->list = 0;
+	x->keys = 0;
+	x->heads = x->next = x->prev = 0;
+	x->nbuckets = x->cursor = 0;
+	x->base = 0;
+	switch( kind ) {
+		case pqBucket:
+			x->keys = (long*)malloc(sizeof(long) * capacity);
+			x->next = (unsigned int*)malloc(sizeof(unsigned int) * capacity);
+			x->prev = (unsigned int*)malloc(sizeof(unsigned int) * capacity);
+			x->nbuckets = 256;
+			x->heads = (unsigned int*)malloc(sizeof(unsigned int) * x->nbuckets);
+			for(i=0; i < x->nbuckets; i++)
+				x->heads[i] = PQUEUE_NONE;
+			break;
+		case pqList:
+			x->keys = (long*)malloc(sizeof(long) * capacity);
+			dlist_init_ex(0, _cmpListItems, x, allocator, &x->list);
+			break;
+		case pqHeap:
+		default:
+			x->kind = pqHeap;
+			x->heap = (pqueue_entry_t*)malloc(sizeof(pqueue_entry_t) * capacity);
+			break;
+	}
+	*q = x;
+}
+
+void pqueue_deinit(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	if( x->list )
+		dlist_deinit(x->list);
+	free(x->keys);
+	free(x->heads);
+	free(x->next);
+	free(x->prev);
+	free(x->heap);
+	free(x->pos);
+	free(x);
+}
+
+void pqueue_reset(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	while( x->len )
+		pqueue_pop(q);
+}
+
+size_t pqueue_len(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	return x->len;
+}
+
+int pqueue_exists(pqueue_t* q, unsigned int id) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	return x->pos[id] != PQUEUE_NONE;
+}
+
+void pqueue_push(pqueue_t* q, unsigned int id, long key) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	switch( x->kind ) {
+		case pqBucket: {
+			if( x->pos[id] != PQUEUE_NONE ) {
+				if( x->keys[id] == key )
+					break;
+				bucket_unlink(x, id);
+			}
+			bucket_link(x, id, key);
+			break;
+		}
+		case pqList: {
+			if( x->pos[id] != PQUEUE_NONE ) {
+				dlist_remove(x->list, LIST_DATA(id));
+				x->len--;
+			}
+			x->keys[id] = key;
+			x->pos[id] = 0;
+			dlist_push_ordered(x->list, LIST_DATA(id));
+			x->len++;
+			break;
+		}
+		case pqHeap: {
+			unsigned int i = x->pos[id];
+			if( i == PQUEUE_NONE ) {
+				pqueue_entry_t e = {key, id};
+				heap_place(x, x->len, e);
+				heap_sift_up(x, x->len++);
+			} else if( key < x->heap[i].key ) {
+				x->heap[i].key = key;
+				heap_sift_up(x, i);
+			} else if( key > x->heap[i].key ) {
+				x->heap[i].key = key;
+				heap_sift_down(x, i);
+			}
+			break;
+		}
+	}
+}
+
+unsigned int pqueue_top(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	if( ! x->len )
+		return PQUEUE_NONE;
+	switch( x->kind ) {
+		case pqList:
+			return LIST_ID(dlist_get_front(x->list));
+		case pqBucket:
+			return bucket_top(x);
+		case pqHeap:
+		default:
+			return x->heap[0].id;
+	}
+}
+
+long pqueue_top_key(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	if( ! x->len )
+		return LONG_MAX;
+	switch( x->kind ) {
+		case pqList:
+			return x->keys[LIST_ID(dlist_get_front(x->list))];
+		case pqBucket:
+			return x->keys[bucket_top(x)];
+		case pqHeap:
+		default:
+			return x->heap[0].key;
+	}
+}
+
+unsigned int pqueue_pop(pqueue_t* q) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	unsigned int id;
+	if( ! x->len )
+		return PQUEUE_NONE;
+	switch( x->kind ) {
+		case pqList:
+			id = LIST_ID(dlist_pop_front(x->list));
+			x->pos[id] = PQUEUE_NONE;
+			x->len--;
+			break;
+		case pqBucket:
+			id = bucket_top(x);
+			bucket_unlink(x, id);
+			break;
+		case pqHeap:
+		default:
+			id = x->heap[0].id;
+			heap_remove_at(x, 0);
+			break;
+	}
+	return id;
+}
+
+void pqueue_remove(pqueue_t* q, unsigned int id) {
+	pqueue_context_t* x = (pqueue_context_t*)q;
+	if( x->pos[id] == PQUEUE_NONE )
+		return;
+	switch( x->kind ) {
+		case pqList:
+			dlist_remove(x->list, LIST_DATA(id));
+			x->pos[id] = PQUEUE_NONE;
+			x->len--;
+			break;
+		case pqBucket:
+			bucket_unlink(x, id);
+			break;
+		case pqHeap:
+		default:
+			heap_remove_at(x, x->pos[id]);
+			break;
+	}
+}
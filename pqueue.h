@@ -0,0 +1,40 @@
+// pqueue.h
+
+#ifndef _PQUEUE_H_
+#define _PQUEUE_H_
+
+#include <stdlib.h>
+#include "arena.h"
+
+typedef void pqueue_t;
+
+typedef enum _pqueue_kind_t {
+	pqHeap	= 0,	// indexed d-ary heap
+	pqList	= 1,	// ordered linked list (dlist based)
+	pqBucket	= 2,	// bucket per integer key (Dial), for keys spanning a moderate range
+} pqueue_kind_t;
+
+#define PQUEUE_NONE	((unsigned int)-1)
+
+/**
+ * A min-priority queue of item ids in the range [0..capacity).
+ * Every item may appear at most once; pushing an item that is already
+ * queued updates its key (decrease-key or increase-key).
+ * The allocator (may be null) serves the nodes of a list-based queue.
+ * A bucket queue pushes and pops in O(1) amortised time when keys mostly grow
+ * (as A* F-costs do). Its buckets span the keys from the lowest queued one; empty
+ * buckets below it are dropped when the range needs room, so memory stays
+ * within a small factor of the widest spread of keys queued at one time.
+ **/
+void pqueue_init(pqueue_kind_t kind, size_t capacity, const allocator_t* allocator, pqueue_t** q);
+void pqueue_deinit(pqueue_t* q);
+void pqueue_reset(pqueue_t* q);
+size_t pqueue_len(pqueue_t* q);
+int pqueue_exists(pqueue_t* q, unsigned int id);
+void pqueue_push(pqueue_t* q, unsigned int id, long key);
+unsigned int pqueue_top(pqueue_t* q);
+long pqueue_top_key(pqueue_t* q);	// LONG_MAX if empty
+unsigned int pqueue_pop(pqueue_t* q);
+void pqueue_remove(pqueue_t* q, unsigned int id);
+
+#endif
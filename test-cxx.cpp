@@ -0,0 +1,83 @@
+// test-cxx.cpp
+// The C++ engine of a-star.hpp cross-checked against the reference Dijkstra of
+// test.c: through a_star_shortest_path_ex(), and directly over its graph types.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include "a-star.hpp"
+#include "test.h"
+
+namespace {
+
+/**
+ * Runs astar::search over 'graph' from 'begin' to 'end', and checks the cost it
+ * reports as well as the path it returns.
+ **/
+template<class Graph, class Heuristic>
+void check_search(const char* engine, const test_map_t* m, const Graph& graph, Heuristic h,
+		a_star_id_t begin, a_star_id_t end) {
+	astar::search<Graph, Heuristic> s(graph, h);
+	std::vector<a_star_id_t> path;
+	bool found = s.run(begin, end);
+
+	if( found ) {
+		s.path(end, std::back_inserter(path));
+		CHECK((long)s.cost(end) == m->dist[end], "%s reports a cost of %ld from %u to %u instead of %ld",
+			engine, (long)s.cost(end), begin, end, m->dist[end]);
+	}
+	check_path(engine, m, path.data(), (int)path.size(), begin, end, 1);
+}
+
+/**
+ * Same, with the built-in grid heuristic matching the map's connectivity.
+ **/
+template<class Graph>
+void check_grid_search(const char* engine, const test_map_t* m, const Graph& graph,
+		a_star_id_t begin, a_star_id_t end) {
+	if( m->grid.connectivity == 8 )
+		check_search(engine, m, graph, astar::grid_heuristic<ahOctile>(m->grid), begin, end);
+	else
+		check_search(engine, m, graph, astar::grid_heuristic<ahManhattan>(m->grid), begin, end);
+}
+
+} // namespace
+
+extern "C" void test_cxx(int seeds, int queries) {
+	static const a_star_queue_t queues[] = {aqHeap, aqList, aqBucket};
+	static const char* const names[] = {"cxx/heap", "cxx/list", "cxx/bucket"};
+	int conn, costs, seed, q, i;
+
+	for(conn=4; conn <= 8; conn += 4)
+		for(costs=0; costs <= 1; costs++)
+			for(seed=1; seed <= seeds; seed++) {
+				test_map_t m;
+				create_map(&m, 23 + seed % 5, 47 + seed % 13, 25, conn, 0, costs,
+					(unsigned long long)seed * 1000 + 700 + conn * 10 + costs);
+				// the id graph of the CSR, with the 32-bit costs of the template engine
+				std::vector<astar::edge<int32_t>> list;
+				for(size_t from=0; from < m.csr->nnodes; from++)
+					for(size_t e=m.csr->offsets[from]; e < m.csr->offsets[from+1]; e++)
+						list.push_back({(a_star_id_t)from, m.csr->to[e], (int32_t)m.csr->cost[e]});
+				astar::edge_list_graph<int32_t> edges(m.csr->nnodes, list);
+				astar::grid_graph<float> grid(m.grid);
+
+				for(q=0; q < queries; q++) {
+					a_star_id_t begin = free_cell(&m), end = free_cell(&m);
+					a_star_node_t** nodePath;
+					int n;
+
+					reference(&m, begin);
+					m.graph.begin = &m.nodes[begin];
+					m.graph.end = &m.nodes[end];
+					for(i=0; i < 3; i++) {
+						n = a_star_shortest_path_ex(&m.graph, graph_cost, graph_distance, 0, &m, queues[i], &nodePath);
+						CHECK(n >= 0, "%s failed from %u to %u", names[i], begin, end);
+						check_node_path(names[i], &m, nodePath, n, begin, end);
+					}
+					check_grid_search("cxx/grid<float>", &m, grid, begin, end);
+					check_grid_search("cxx/edges<int32_t>", &m, edges, begin, end);
+				}
+				free_map(&m);
+			}
+}
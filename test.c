@@ -0,0 +1,1208 @@
+// test.c
+// a-star-test: cross-checks the search engines against a plain Dijkstra on seeded random maps.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "a-star.h"
+#include "test.h"
+
+#define	NGOALS	4	// goals of each one-to-many search
+#define	NCHANGES	6	// cells toggled, and cells re-costed, in each round of map changes
+
+long nchecks, nfailures;
+
+/**
+ * Allocation counting: on glibc the allocator entry points are interposed here,
+ * so calls from the (statically linked) library are counted as well. Not under
+ * AddressSanitizer, which brings allocator entry points of its own.
+ **/
+static long nallocs;
+#if defined(__has_feature)
+#	if __has_feature(address_sanitizer)
+#		define	ASAN_BUILD	1
+#	endif
+#endif
+#if defined(__GLIBC__) && ! defined(__SANITIZE_ADDRESS__) && ! defined(ASAN_BUILD)
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+void* malloc(size_t size) { nallocs++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size) { nallocs++; return __libc_calloc(n, size); }
+void* realloc(void* p, size_t size) { nallocs++; return __libc_realloc(p, size); }
+#	define	ALLOCS_COUNTED	1
+#else
+#	define	ALLOCS_COUNTED	0
+#endif
+
+/**
+ * splitmix64, so that a seed gives the same map on every platform.
+ **/
+unsigned long long rngState;
+unsigned long long rng_next(void) {
+	unsigned long long z = (rngState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static int blocked(const a_star_grid_t* g, int row, int column) {
+	if( row < 0 || row >= g->rows || column < 0 || column >= g->columns )
+		return 1;
+	return A_STAR_GRID_BLOCKED(g, A_STAR_GRID_ID(g, row, column)) != 0;
+}
+
+/**
+ * Cost of the move between two cells, written out from the grid rules rather
+ * than shared with the library; a negative value if the move is not allowed.
+ **/
+long step_cost(const a_star_grid_t* g, a_star_id_t from, a_star_id_t to) {
+	int r1 = from / g->columns, c1 = from % g->columns;
+	int r2 = to / g->columns, c2 = to % g->columns;
+	int dr = r2 - r1, dc = c2 - c1;
+	long cost;
+	if( dr < -1 || dr > 1 || dc < -1 || dc > 1 || (dr == 0 && dc == 0) )
+		return -1;
+	if( blocked(g, r1, c1) || blocked(g, r2, c2) )
+		return -1;
+	if( dr && dc ) {
+		if( g->connectivity != 8 )
+			return -1;
+		if( ! g->cutCorners && (blocked(g, r1 + dr, c1) || blocked(g, r1, c1 + dc)) )
+			return -1;
+		cost = A_STAR_DIAGONAL_COST;
+	} else
+		cost = A_STAR_STRAIGHT_COST;
+	if( g->cost && g->cost[to] > 1 )
+		cost *= g->cost[to];
+	return cost;
+}
+
+/**
+ * Reference distances from 'begin' to every cell: Dijkstra's algorithm on a
+ * binary heap with lazy deletion, independent of the library's queues.
+ **/
+typedef struct _test_entry_t {
+	long dist;
+	a_star_id_t id;
+} test_entry_t;
+void reference(test_map_t* m, a_star_id_t begin) {
+	const a_star_grid_t* g = &m->grid;
+	size_t i, n = 0, ncells = (size_t)g->rows * g->columns;
+	test_entry_t* heap = (test_entry_t*)malloc(sizeof(test_entry_t) * (ncells * 8 + 1));
+	for(i=0; i < ncells; i++)
+		m->dist[i] = -1;
+	m->dist[begin] = 0;
+	heap[n++] = (test_entry_t){0, begin};
+	while( n ) {
+		test_entry_t top = heap[0], last = heap[--n];
+		size_t k = 0, child;
+		int dr, dc;
+		// sift the last entry down from the root
+		while( (child = 2 * k + 1) < n ) {
+			if( child + 1 < n && heap[child+1].dist < heap[child].dist )
+				child++;
+			if( last.dist <= heap[child].dist )
+				break;
+			heap[k] = heap[child];
+			k = child;
+		}
+		heap[k] = last;
+		if( top.dist > m->dist[top.id] )
+			continue;	// stale
+		for(dr=-1; dr <= 1; dr++)
+			for(dc=-1; dc <= 1; dc++) {
+				int r = top.id / g->columns + dr, c = top.id % g->columns + dc;
+				long cost;
+				if( r < 0 || r >= g->rows || c < 0 || c >= g->columns )
+					continue;
+				a_star_id_t next = A_STAR_GRID_ID(g, r, c);
+				if( (cost = step_cost(g, top.id, next)) < 0 )
+					continue;
+				if( m->dist[next] >= 0 && top.dist + cost >= m->dist[next] )
+					continue;
+				m->dist[next] = top.dist + cost;
+				// sift the new entry up
+				for(k=n++; k > 0 && heap[(k-1)/2].dist > m->dist[next]; k=(k-1)/2)
+					heap[k] = heap[(k-1)/2];
+				heap[k] = (test_entry_t){m->dist[next], next};
+			}
+	}
+	free(heap);
+}
+
+/**
+ * Cost of a path of cell ids from 'begin' to 'end', or a negative value if
+ * it does not join them through allowed moves.
+ **/
+long path_cost(const a_star_grid_t* g, const a_star_id_t* path, int n, a_star_id_t begin, a_star_id_t end) {
+	long cost = 0;
+	int i;
+	if( n <= 0 || path[0] != begin || path[n-1] != end )
+		return -1;
+	for(i=1; i < n; i++) {
+		long step = step_cost(g, path[i-1], path[i]);
+		if( step < 0 )
+			return -1;
+		cost += step;
+	}
+	return cost;
+}
+
+/**
+ * Same as path_cost(), for a path of graph nodes; 'path' is freed.
+ **/
+long node_path_cost(const test_map_t* m, a_star_node_t** path, int n, a_star_id_t begin, a_star_id_t end) {
+	a_star_id_t* ids;
+	long cost;
+	int i;
+	if( n <= 0 )
+		return -1;
+	ids = (a_star_id_t*)malloc(sizeof(a_star_id_t) * n);
+	for(i=0; i < n; i++)
+		ids[i] = (a_star_id_t)(path[i] - m->nodes);
+	cost = path_cost(&m->grid, ids, n, begin, end);
+	free(ids);
+	free(path);
+	return cost;
+}
+
+long graph_cost(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	const test_map_t* m = (const test_map_t*)cookie;
+	return step_cost(&m->grid, (a_star_id_t)(n1 - m->nodes), (a_star_id_t)(n2 - m->nodes));
+}
+
+long graph_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	const test_map_t* m = (const test_map_t*)cookie;
+	const a_star_grid_t* g = &m->grid;
+	long dRow = labs((long)((n1 - m->nodes) / g->columns) - (long)((n2 - m->nodes) / g->columns));
+	long dCol = labs((long)((n1 - m->nodes) % g->columns) - (long)((n2 - m->nodes) % g->columns));
+	return a_star_heuristic(g->connectivity == 8 ? ahOctile : ahManhattan, dRow, dCol);
+}
+
+void create_map(test_map_t* m, int rows, int columns, int barriers, int connectivity,
+		int cutCorners, int costs, unsigned long long seed) {
+	size_t i, ncells = (size_t)rows * columns;
+	int d;
+
+	rngState = seed;
+	memset(m, 0, sizeof(test_map_t));
+	m->obstacles = (unsigned char*)calloc(A_STAR_GRID_BITMAP_SIZE(rows, columns), 1);
+	for(i=0; i < ncells; i++)
+		if( rng_next() % 100 < (unsigned)barriers )
+			m->obstacles[i >> 3] |= 1U << (i & 7);
+	if( costs ) {
+		m->cost = (unsigned char*)malloc(ncells);
+		for(i=0; i < ncells; i++)
+			m->cost[i] = (unsigned char)(rng_next() % 5);	// 0 is taken as 1
+	}
+	m->grid.rows = rows;
+	m->grid.columns = columns;
+	m->grid.obstacles = m->obstacles;
+	m->grid.cost = m->cost;
+	m->grid.connectivity = connectivity;
+	m->grid.cutCorners = cutCorners;
+	m->grid.heuristic = ahDefault;
+	m->dist = (long*)malloc(sizeof(long) * ncells);
+
+	// the graph has the moves of the grid as edges, costed by graph_cost()
+	m->nodes = (a_star_node_t*)calloc(ncells, sizeof(a_star_node_t));
+	m->graph.nodes = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * ncells);
+	m->graph.edges = (a_star_edge_t**)malloc(sizeof(a_star_edge_t*) * ncells * 8);
+	m->graph.nnodes = ncells;
+	for(i=0; i < ncells; i++) {
+		m->graph.nodes[i] = &m->nodes[i];
+		for(d=0; d < 9; d++) {
+			int r = i / columns + d / 3 - 1, c = i % columns + d % 3 - 1;
+			if( r < 0 || r >= rows || c < 0 || c >= columns )
+				continue;
+			if( step_cost(&m->grid, (a_star_id_t)i, A_STAR_GRID_ID(&m->grid, r, c)) < 0 )
+				continue;
+			a_star_edge_t* e = (a_star_edge_t*)malloc(sizeof(a_star_edge_t));
+			e->from = &m->nodes[i];
+			e->to = &m->nodes[A_STAR_GRID_ID(&m->grid, r, c)];
+			e->cost = 0;
+			m->graph.edges[m->graph.nedges++] = e;
+		}
+	}
+	if( a_star_graph_prepare(&m->graph, graph_cost, m, &m->csr) < 0 ) {
+		fprintf(stderr, "Failed preparing the graph!\n");
+		exit(99);
+	}
+}
+
+void free_map(test_map_t* m) {
+	size_t i;
+	a_star_csr_free(m->csr);
+	for(i=0; i < m->graph.nedges; i++)
+		free(m->graph.edges[i]);
+	free(m->graph.edges);
+	free(m->graph.nodes);
+	free(m->nodes);
+	free(m->dist);
+	free(m->cost);
+	free(m->obstacles);
+}
+
+/**
+ * Picks a free cell; the map is expected to have one.
+ **/
+a_star_id_t free_cell(const test_map_t* m) {
+	a_star_id_t id;
+	do
+		id = (a_star_id_t)(rng_next() % ((size_t)m->grid.rows * m->grid.columns));
+	while( A_STAR_GRID_BLOCKED(&m->grid, id) );
+	return id;
+}
+
+/**
+ * Checks an id path of 'engine' against the reference distance to 'end'; a
+ * near-optimal engine may return a dearer path.
+ **/
+void check_path(const char* engine, const test_map_t* m, const a_star_id_t* path, int n,
+		a_star_id_t begin, a_star_id_t end, int optimal) {
+	long expected = m->dist[end], cost;
+	if( expected < 0 ) {
+		CHECK(n == 0, "%s found a path of %d cells from %u to %u where there is none", engine, n, begin, end);
+		return;
+	}
+	cost = path_cost(&m->grid, path, n, begin, end);
+	CHECK(cost >= 0, "%s returned an invalid path (%d cells) from %u to %u", engine, n, begin, end);
+	if( cost >= 0 && optimal )
+		CHECK(cost == expected, "%s path from %u to %u costs %ld instead of %ld", engine, begin, end, cost, expected);
+	else if( cost >= 0 )
+		CHECK(cost >= expected, "%s path from %u to %u costs %ld, less than the cheapest %ld", engine, begin, end, cost, expected);
+}
+void check_node_path(const char* engine, const test_map_t* m, a_star_node_t** path, int n,
+		a_star_id_t begin, a_star_id_t end) {
+	long expected = m->dist[end], cost;
+	if( expected < 0 ) {
+		CHECK(n == 0, "%s found a path of %d cells from %u to %u where there is none", engine, n, begin, end);
+		if( n > 0 )
+			free(path);
+		return;
+	}
+	cost = node_path_cost(m, path, n, begin, end);
+	CHECK(cost == expected, "%s path from %u to %u costs %ld instead of %ld", engine, begin, end, cost, expected);
+}
+
+/**
+ * Runs one query on every engine that supports the map.
+ **/
+static void check_query(test_map_t* m, a_star_jps_t* jps, a_star_ch_t* ch, a_star_hpa_t* hpa,
+		a_star_search_ctx_t** ctxs, a_star_id_t begin, a_star_id_t end, const a_star_id_t* goals) {
+	const a_star_grid_t* g = &m->grid;
+	a_star_node_t** nodePath;
+	a_star_id_t* path;
+	a_star_result_t results[NGOALS];
+	a_star_node_t* goalNodes[NGOALS];
+	a_star_flow_t* flow;
+	a_star_dstar_t* planner;
+	double bound;
+	int q, i, n;
+
+	reference(m, begin);
+
+	for(q=0; q < 3; q++) {
+		static const char* const names[] = {"grid/heap", "grid/list", "grid/bucket"};
+		n = a_star_grid_search(g, ctxs[q], begin, end, 0, 0, &path);
+		check_path(names[q], m, path, n, begin, end, 1);
+		if( n > 0 )
+			free(path);
+	}
+
+	n = a_star_jps_search(g, 0, ctxs[0], begin, end, 0, 0, &path);
+	check_path("jps", m, path, n, begin, end, 1);
+	if( n > 0 )
+		free(path);
+	if( jps ) {
+		n = a_star_jps_search(g, jps, ctxs[0], begin, end, 0, 0, &path);
+		check_path("jps+", m, path, n, begin, end, 1);
+		if( n > 0 )
+			free(path);
+	}
+
+	n = a_star_search(m->csr, ctxs[0], &m->nodes[begin], &m->nodes[end], graph_distance, 0, m, &nodePath);
+	check_node_path("graph", m, nodePath, n, begin, end);
+	n = a_star_bidir_search(m->csr, ctxs[0], ctxs[1], &m->nodes[begin], &m->nodes[end], graph_distance, 0, m, &nodePath);
+	check_node_path("bidir", m, nodePath, n, begin, end);
+	n = a_star_ch_search(ch, ctxs[0], ctxs[1], &m->nodes[begin], &m->nodes[end], &nodePath);
+	check_node_path("ch", m, nodePath, n, begin, end);
+	n = a_star_search_anytime(m->csr, ctxs[0], &m->nodes[begin], &m->nodes[end], graph_distance, 3, 0,
+			0, 0, m, &nodePath, &bound);
+	CHECK(n <= 0 || bound == 1, "ara stopped at a bound of %.3f without a deadline", bound);
+	check_node_path("ara", m, nodePath, n, begin, end);
+
+	for(i=0; i < NGOALS; i++)
+		goalNodes[i] = &m->nodes[goals[i]];
+	n = a_star_search_multi(m->csr, ctxs[0], &m->nodes[begin], goalNodes, NGOALS, 0, graph_distance, 0, m, results);
+	for(i=0; i < NGOALS; i++)
+		check_node_path("multi", m, results[i].path, results[i].status, begin, goals[i]);
+
+	if( a_star_flow_build(g, end, 2, &flow) == 0 ) {
+		long distance = a_star_flow_distance(flow, begin);
+		CHECK(distance == m->dist[end] || (distance < 0 && m->dist[end] < 0),
+			"flow distance from %u to %u is %ld instead of %ld", begin, end, distance, m->dist[end]);
+		n = a_star_flow_path(flow, begin, &path);
+		check_path("flow", m, path, n, begin, end, 1);
+		if( n > 0 )
+			free(path);
+		a_star_flow_free(flow);
+	} else
+		CHECK(0, "flow field to %u could not be built", end);
+
+	if( a_star_dstar_init(g, begin, end, &planner) == 0 ) {
+		n = a_star_dstar_plan(planner, 0, 0, &path);
+		check_path("dstar", m, path, n, begin, end, 1);
+		if( n > 0 )
+			free(path);
+		a_star_dstar_deinit(planner);
+	} else
+		CHECK(0, "planner from %u to %u could not be created", begin, end);
+
+	n = a_star_hpa_search(hpa, begin, end, 0, 0, &path);
+	check_path("hpa", m, path, n, begin, end, 0);
+	if( n > 0 )
+		free(path);
+}
+
+/**
+ * Random maps of every connectivity, corner rule and cost layer.
+ **/
+static void test_random_maps(int seeds, int queries) {
+	static const int barriers[] = {0, 20, 35};
+	a_star_search_ctx_t* ctxs[3];
+	int b, conn, cut, costs, seed, q, i;
+
+	for(b=0; b < (int)(sizeof(barriers) / sizeof(barriers[0])); b++)
+		for(conn=4; conn <= 8; conn += 4)
+			for(cut=0; cut <= 1; cut++)
+				for(costs=0; costs <= 1; costs++)
+					for(seed=1; seed <= seeds; seed++) {
+						test_map_t m;
+						a_star_jps_t* jps;
+						a_star_ch_t* ch;
+						a_star_hpa_t* hpa;
+						// rows and columns differ, and the columns straddle a 64-bit word
+						create_map(&m, 29 + seed % 7, 61 + seed % 11, barriers[b], conn, cut, costs,
+							(unsigned long long)seed * 1000 + b * 100 + conn * 10 + cut * 2 + costs);
+						if( a_star_search_ctx_init(m.csr->nnodes, aqHeap, &ctxs[0]) < 0
+								|| a_star_search_ctx_init(m.csr->nnodes, aqList, &ctxs[1]) < 0
+								|| a_star_search_ctx_init(m.csr->nnodes, aqBucket, &ctxs[2]) < 0 ) {
+							fprintf(stderr, "Failed allocating search context!\n");
+							exit(99);
+						}
+						if( a_star_jps_prepare(&m.grid, &jps) < 0 )
+							jps = 0;	// unsupported grid
+						if( a_star_ch_build(m.csr, &ch) < 0 || a_star_hpa_build(&m.grid, 8, 2, &hpa) < 0 ) {
+							fprintf(stderr, "Failed preprocessing the map!\n");
+							exit(99);
+						}
+						for(q=0; q < queries; q++) {
+							a_star_id_t begin = free_cell(&m), end = free_cell(&m), goals[NGOALS];
+							for(i=0; i < NGOALS; i++)
+								goals[i] = free_cell(&m);
+							check_query(&m, jps, ch, hpa, ctxs, begin, end, goals);
+						}
+						a_star_hpa_free(hpa);
+						a_star_ch_free(ch);
+						a_star_jps_free(jps);
+						for(i=0; i < 3; i++)
+							a_star_search_ctx_deinit(ctxs[i]);
+						free_map(&m);
+					}
+}
+
+/**
+ * D* Lite as an agent uses it: after each plan the start moves a few cells
+ * along the path, then cells are blocked, unblocked and re-costed, reported,
+ * and the next plan must be as cheap as a search from scratch.
+ **/
+static void test_dstar_updates(int seeds) {
+	const int rounds = 12, steps = 3;
+	int conn, cut, seed, round, i, n;
+
+	for(conn=4; conn <= 8; conn += 4)
+		for(cut=0; cut <= 1; cut++)
+			for(seed=1; seed <= seeds; seed++) {
+				test_map_t m;
+				a_star_dstar_t* planner;
+				a_star_id_t begin, end, changed[2 * NCHANGES], *path;
+
+				create_map(&m, 25, 40 + seed % 9, 20, conn, cut, 1, (unsigned long long)seed * 1000 + 800 + conn * 10 + cut);
+				begin = free_cell(&m);
+				end = free_cell(&m);
+				if( a_star_dstar_init(&m.grid, begin, end, &planner) < 0 ) {
+					fprintf(stderr, "Failed creating the planner!\n");
+					exit(99);
+				}
+				for(round=0; round < rounds; round++) {
+					n = a_star_dstar_plan(planner, 0, 0, &path);
+					reference(&m, begin);
+					check_path("dstar/replan", &m, path, n, begin, end, 1);
+					if( n > 1 ) {
+						// follow the path, whose cells are free until the changes below
+						begin = path[n - 1 < steps ? n - 1 : steps];
+						CHECK(a_star_dstar_move(planner, begin) == 0, "planner could not move to %u", begin);
+					}
+					if( n > 0 )
+						free(path);
+					for(i=0; i < NCHANGES; i++) {
+						a_star_id_t id;
+						do
+							id = (a_star_id_t)(rng_next() % ((size_t)m.grid.rows * m.grid.columns));
+						while( id == begin || id == end );
+						m.obstacles[id >> 3] ^= 1U << (id & 7);
+						changed[i] = id;
+						id = free_cell(&m);
+						m.cost[id] = (unsigned char)(rng_next() % 5);
+						changed[NCHANGES + i] = id;
+					}
+					CHECK(a_star_dstar_update(planner, changed, 2 * NCHANGES) == 0, "planner refused %d changed cells", 2 * NCHANGES);
+				}
+				a_star_dstar_deinit(planner);
+				free_map(&m);
+			}
+}
+
+/**
+ * HPA* after reported changes: blocked, unblocked and re-costed cells leave a
+ * hierarchy that searches like one built afresh on the changed map, and stays
+ * within reach of the reference.
+ **/
+static void test_hpa_updates(int seeds, int queries) {
+	const int rounds = 6;
+	int conn, seed, round, q, i;
+
+	for(conn=4; conn <= 8; conn += 4)
+		for(seed=1; seed <= seeds; seed++) {
+			test_map_t m;
+			a_star_hpa_t *hpa, *fresh;
+			a_star_id_t changed[2 * NCHANGES];
+
+			create_map(&m, 40, 50 + seed % 7, 20, conn, 0, 1, (unsigned long long)seed * 1000 + 900 + conn * 10);
+			if( a_star_hpa_build(&m.grid, 8, 2, &hpa) < 0 ) {
+				fprintf(stderr, "Failed preprocessing the map!\n");
+				exit(99);
+			}
+			for(round=0; round < rounds; round++) {
+				for(i=0; i < NCHANGES; i++) {
+					a_star_id_t id = (a_star_id_t)(rng_next() % ((size_t)m.grid.rows * m.grid.columns));
+					m.obstacles[id >> 3] ^= 1U << (id & 7);
+					changed[i] = id;
+					id = (a_star_id_t)(rng_next() % ((size_t)m.grid.rows * m.grid.columns));
+					m.cost[id] = (unsigned char)(rng_next() % 5);
+					changed[NCHANGES + i] = id;
+				}
+				CHECK(a_star_hpa_update(hpa, changed, 2 * NCHANGES) == 0, "hpa refused %d changed cells", 2 * NCHANGES);
+				if( a_star_hpa_build(&m.grid, 8, 2, &fresh) < 0 ) {
+					fprintf(stderr, "Failed preprocessing the map!\n");
+					exit(99);
+				}
+				CHECK(a_star_hpa_nodes(hpa) == a_star_hpa_nodes(fresh), "updated hpa has %zu entrances instead of %zu",
+					a_star_hpa_nodes(hpa), a_star_hpa_nodes(fresh));
+				for(q=0; q < queries; q++) {
+					a_star_id_t begin = free_cell(&m), end = free_cell(&m), *path;
+					long cost, expected = -1;
+					int n;
+					reference(&m, begin);
+					n = a_star_hpa_search(fresh, begin, end, 0, 0, &path);
+					if( n > 0 ) {
+						expected = path_cost(&m.grid, path, n, begin, end);
+						free(path);
+					}
+					n = a_star_hpa_search(hpa, begin, end, 0, 0, &path);
+					check_path("hpa/update", &m, path, n, begin, end, 0);
+					cost = n > 0 ? path_cost(&m.grid, path, n, begin, end) : -1;
+					CHECK(cost == expected, "updated hpa path from %u to %u costs %ld, %ld when built afresh",
+						begin, end, cost, expected);
+					if( n > 0 )
+						free(path);
+				}
+				a_star_hpa_free(fresh);
+			}
+			a_star_hpa_free(hpa);
+			free_map(&m);
+		}
+}
+
+/**
+ * Path cache: the same endpoints are answered whole, endpoints on a cached
+ * path by its slice, other graph versions never; no-path results are cached
+ * too, and a bounded cache evicts the least recently used entries and counts
+ * its index against the bound.
+ **/
+static void test_cache() {
+	test_map_t m;
+	a_star_cache_t* cache;
+	a_star_cache_stats_t stats;
+	a_star_node_t **path, **again, *const* cached;
+	a_star_node_t* chains[5][4];
+	a_star_id_t begin, end, wall, *ids;
+	size_t base, perEntry;
+	int n, k, i;
+
+	create_map(&m, 24, 36, 20, 8, 0, 1, 23);
+	if( a_star_cache_init(1 << 20, &cache) < 0 ) {
+		fprintf(stderr, "Failed creating the cache!\n");
+		exit(99);
+	}
+
+	// a path long enough to slice, then the same query again
+	do {
+		begin = free_cell(&m);
+		end = free_cell(&m);
+		reference(&m, begin);
+	} while( m.dist[end] < 0 || m.dist[end] < 6 * A_STAR_STRAIGHT_COST );
+	m.graph.begin = &m.nodes[begin];
+	m.graph.end = &m.nodes[end];
+	n = a_star_cached_shortest_path(cache, 1, &m.graph, graph_cost, graph_distance, 0, &m, aqHeap, &path);
+	k = a_star_cached_shortest_path(cache, 1, &m.graph, graph_cost, graph_distance, 0, &m, aqHeap, &again);
+	a_star_cache_stats(cache, &stats);
+	CHECK(stats.misses == 1 && stats.hits == 1, "cache counted %lu misses and %lu hits for a repeated query", stats.misses, stats.hits);
+	CHECK(k == n && n > 0 && ! memcmp(path, again, sizeof(a_star_node_t*) * n), "cache hit returned another path");
+	check_node_path("cache", &m, again, k, begin, end);
+
+	// a slice between two inner nodes, as cheap as searched from scratch
+	k = a_star_cache_lookup(cache, 1, path[1], path[n-2], &cached, &i);
+	a_star_cache_stats(cache, &stats);
+	CHECK(k == 1 && stats.subpathHits == 1 && i == n - 2 && ! memcmp(cached, path + 1, sizeof(a_star_node_t*) * i),
+		"cache did not slice its path of %d nodes", n);
+	if( k == 1 ) {
+		ids = (a_star_id_t*)malloc(sizeof(a_star_id_t) * i);
+		for(k=0; k < i; k++)
+			ids[k] = (a_star_id_t)(cached[k] - m.nodes);
+		reference(&m, ids[0]);
+		CHECK(path_cost(&m.grid, ids, i, ids[0], ids[i-1]) == m.dist[ids[i-1]], "cached slice is not the cheapest path");
+		free(ids);
+	}
+
+	// another version of the graph shares nothing
+	CHECK(a_star_cache_lookup(cache, 2, path[0], path[n-1], &cached, &i) == 0, "cache answered for another graph version");
+	CHECK(a_star_cache_lookup(cache, 2, path[1], path[n-2], &cached, &i) == 0, "cache sliced a path of another graph version");
+	free(path);
+
+	// no path to a blocked cell, cached as such
+	for(wall=0; ! A_STAR_GRID_BLOCKED(&m.grid, wall); wall++)
+		;
+	m.graph.end = &m.nodes[wall];
+	n = a_star_cached_shortest_path(cache, 1, &m.graph, graph_cost, graph_distance, 0, &m, aqHeap, &path);
+	k = a_star_cache_lookup(cache, 1, &m.nodes[begin], &m.nodes[wall], &cached, &i);
+	CHECK(n == 0 && k == 1 && i == 0, "no path to a blocked cell was not cached (%d, %d, %d)", n, k, i);
+	a_star_cache_deinit(cache);
+
+	// entries of 4 nodes on disjoint cells, sized from an unbounded cache
+	for(k=0; k < 5; k++)
+		for(i=0; i < 4; i++)
+			chains[k][i] = &m.nodes[k * 4 + i];
+	a_star_cache_init(1 << 20, &cache);
+	a_star_cache_insert(cache, 1, chains[0][0], chains[0][3], chains[0], 4);
+	a_star_cache_stats(cache, &stats);
+	base = stats.bytes;
+	a_star_cache_insert(cache, 1, chains[1][0], chains[1][3], chains[1], 4);
+	a_star_cache_stats(cache, &stats);
+	perEntry = stats.bytes - base;
+	a_star_cache_deinit(cache);
+
+	// room for three: after a hit on the first, the fourth evicts the second
+	a_star_cache_init(base + 2 * perEntry, &cache);
+	for(k=0; k < 3; k++)
+		CHECK(a_star_cache_insert(cache, 1, chains[k][0], chains[k][3], chains[k], 4) == 1, "cache refused entry %d", k);
+	a_star_cache_lookup(cache, 1, chains[0][0], chains[0][3], &cached, &i);
+	for(k=3; k < 5; k++)
+		a_star_cache_insert(cache, 1, chains[k][0], chains[k][3], chains[k], 4);
+	a_star_cache_stats(cache, &stats);
+	CHECK(stats.evictions == 2 && stats.entries == 3 && stats.bytes <= base + 2 * perEntry,
+		"bounded cache holds %zu entries in %zu bytes after %lu evictions", stats.entries, stats.bytes, stats.evictions);
+	for(k=0; k < 5; k++)
+		CHECK(a_star_cache_lookup(cache, 1, chains[k][0], chains[k][3], &cached, &i) == (k == 1 || k == 2 ? 0 : 1),
+			"entry %d was %s", k, k == 1 || k == 2 ? "kept over a more recent one" : "evicted out of order");
+	a_star_cache_deinit(cache);
+
+	// the first buckets of the index (256 pointers per table) are past this bound
+	a_star_cache_init(1024, &cache);
+	CHECK(a_star_cache_insert(cache, 1, chains[0][0], chains[0][3], chains[0], 4) == 0, "cache grew its index past its bound");
+	a_star_cache_stats(cache, &stats);
+	CHECK(stats.bytes <= 1024, "cache holds %zu bytes within a bound of 1024", stats.bytes);
+	a_star_cache_deinit(cache);
+	free_map(&m);
+}
+
+/**
+ * ALT landmarks: tables saved and loaded back give the same bounds, never
+ * above the reference, and guide searches to the cheapest paths; a truncated
+ * file or one of another format is refused.
+ **/
+static void test_alt(int queries) {
+	char file[] = "/tmp/a-star-test-XXXXXX";
+	test_map_t m;
+	a_star_alt_t *alt, *loaded;
+	a_star_search_ctx_t* ctx;
+	a_star_node_t** path;
+	FILE* f;
+	long size;
+	int fd, q, i, n;
+
+	create_map(&m, 30, 45, 20, 8, 0, 1, 31);
+	if( (fd = mkstemp(file)) < 0 ) {
+		fprintf(stderr, "Failed creating a temporary file!\n");
+		exit(99);
+	}
+	close(fd);
+	if( a_star_alt_build(m.csr, 6, &alt) < 0 || a_star_search_ctx_init(m.csr->nnodes, aqHeap, &ctx) < 0 ) {
+		fprintf(stderr, "Failed building the landmarks!\n");
+		exit(99);
+	}
+	CHECK(a_star_alt_save(alt, file) == 0 && a_star_alt_load(file, &loaded) == 0, "landmarks could not be saved and loaded back");
+
+	for(q=0; q < queries; q++) {
+		a_star_id_t begin = free_cell(&m), end;
+		reference(&m, begin);
+		for(i=0; i < NGOALS; i++) {
+			end = free_cell(&m);
+			CHECK(a_star_alt_estimate(loaded, begin, end) == a_star_alt_estimate(alt, begin, end),
+				"loaded landmarks bound %u to %u by %ld instead of %ld",
+				begin, end, a_star_alt_estimate(loaded, begin, end), a_star_alt_estimate(alt, begin, end));
+			CHECK(m.dist[end] < 0 || a_star_alt_estimate(loaded, begin, end) <= m.dist[end],
+				"landmarks bound %u to %u by %ld, above the cheapest %ld", begin, end,
+				a_star_alt_estimate(loaded, begin, end), m.dist[end]);
+		}
+		n = a_star_search(m.csr, ctx, &m.nodes[begin], &m.nodes[end], a_star_alt_distance, 0, loaded, &path);
+		check_node_path("alt", &m, path, n, begin, end);
+	}
+	a_star_alt_free(loaded);
+
+	// a file cut in half, then a file whose magic number is off
+	f = fopen(file, "rb");
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fclose(f);
+	CHECK(truncate(file, size / 2) == 0 && a_star_alt_load(file, &loaded) < 0, "landmarks loaded from a truncated file");
+	a_star_alt_save(alt, file);
+	f = fopen(file, "r+b");
+	fputc('X', f);
+	fclose(f);
+	CHECK(a_star_alt_load(file, &loaded) < 0, "landmarks loaded from a file with a bad magic number");
+
+	unlink(file);
+	a_star_search_ctx_deinit(ctx);
+	a_star_alt_free(alt);
+	free_map(&m);
+}
+
+/**
+ * Map files: a MovingAI map with CRLF line ends and a 16-bit PGM with a header
+ * comment load with the expected obstacles ('1' for blocked, a row per string);
+ * a short raster or a header without its "map" line are refused.
+ **/
+static void check_map_file(const char* file, const char* data, size_t size, const char* const* expected, int rows) {
+	a_star_grid_t g;
+	FILE* f = fopen(file, "wb");
+	int r, c, ok;
+
+	fwrite(data, 1, size, f);
+	fclose(f);
+	ok = a_star_map_load(file, &g) == 0;
+	if( ! expected ) {
+		CHECK(! ok, "map file of %zu bytes should have been refused", size);
+		if( ok )
+			free((void*)g.obstacles);
+		return;
+	}
+	CHECK(ok && g.rows == rows && g.columns == (int)strlen(expected[0]), "map file of %zu bytes did not load as %dx%zu",
+		size, rows, strlen(expected[0]));
+	if( ! ok )
+		return;
+	for(r=0; r < g.rows && r < rows; r++)
+		for(c=0; c < g.columns; c++)
+			CHECK(! A_STAR_GRID_BLOCKED(&g, A_STAR_GRID_ID(&g, r, c)) == (expected[r][c] == '0'),
+				"map cell %d,%d should be %s", r, c, expected[r][c] == '0' ? "free" : "blocked");
+	free((void*)g.obstacles);
+}
+static void test_map_files() {
+	static const char movingai[] = "type octile\r\nheight 3\r\nwidth 4\r\nmap\r\n.@.T\r\nGS..\r\n@@W.\r\n";
+	static const char* const movingaiCells[] = {"0101", "0000", "1110"};
+	// free, occupied, unknown grey; nearly white, light grey, free
+	static const char pgm[] = "P5\n# occupancy grid\n3 2\n65535\n"
+		"\xff\xff\x00\x00\x80\x00" "\xf0\x00\xc0\x00\xff\xff";
+	static const char* const pgmCells[] = {"011", "010"};
+	static const char shortPgm[] = "P5\n3 2\n255\n\xff\x00\x80\xff";
+	static const char shortMovingai[] = "type octile\nheight 3\nwidth 4\nmap\n.@.T\nGS..\n";
+	static const char noMapLine[] = "type octile\nheight 2\nwidth 2\n..\n..\n";
+	char file[] = "/tmp/a-star-test-XXXXXX";
+	int fd;
+
+	if( (fd = mkstemp(file)) < 0 ) {
+		fprintf(stderr, "Failed creating a temporary file!\n");
+		exit(99);
+	}
+	close(fd);
+	check_map_file(file, movingai, sizeof(movingai) - 1, movingaiCells, 3);
+	check_map_file(file, pgm, sizeof(pgm) - 1, pgmCells, 2);
+	check_map_file(file, shortPgm, sizeof(shortPgm) - 1, 0, 0);
+	check_map_file(file, shortMovingai, sizeof(shortMovingai) - 1, 0, 0);
+	check_map_file(file, noMapLine, sizeof(noMapLine) - 1, 0, 0);
+	unlink(file);
+}
+
+/**
+ * Batched queries on several threads: each result is the path the same query
+ * gets alone on a context of the same queue, and the cheapest one.
+ **/
+static void test_batch(int queries) {
+	static const a_star_queue_t queues[] = {aqHeap, aqList, aqBucket};
+	const int nqueries = 4 * queries;
+	test_map_t m;
+	a_star_query_t* batch;
+	a_star_result_t* results;
+	a_star_search_ctx_t* ctx;
+	a_star_node_t** path;
+	int k, q, n, found;
+
+	create_map(&m, 32, 48, 25, 8, 0, 1, 57);
+	batch = (a_star_query_t*)malloc(sizeof(a_star_query_t) * nqueries);
+	results = (a_star_result_t*)malloc(sizeof(a_star_result_t) * nqueries);
+	for(q=0; q < nqueries; q++) {
+		batch[q].begin = &m.nodes[free_cell(&m)];
+		batch[q].end = &m.nodes[free_cell(&m)];
+	}
+	for(k=0; k < 3; k++) {
+		if( a_star_search_ctx_init(m.csr->nnodes, queues[k], &ctx) < 0 ) {
+			fprintf(stderr, "Failed allocating search context!\n");
+			exit(99);
+		}
+		found = a_star_shortest_path_batch(m.csr, batch, nqueries, graph_distance, &m, queues[k], 3, results);
+		for(q=0; q < nqueries; q++) {
+			a_star_id_t begin = (a_star_id_t)(batch[q].begin - m.nodes), end = (a_star_id_t)(batch[q].end - m.nodes);
+			n = a_star_search(m.csr, ctx, batch[q].begin, batch[q].end, graph_distance, 0, &m, &path);
+			CHECK(results[q].status == n && (n <= 0 || ! memcmp(results[q].path, path, sizeof(a_star_node_t*) * n)),
+				"batched query %d from %u to %u differs from the same query alone (%d and %d nodes)",
+				q, begin, end, results[q].status, n);
+			found -= n > 0;
+			if( n > 0 )
+				free(path);
+			reference(&m, begin);
+			check_node_path("batch", &m, results[q].path, results[q].status, begin, end);
+		}
+		CHECK(found == 0, "batch counted %d paths more than its queries found", found);
+		a_star_search_ctx_deinit(ctx);
+	}
+	free(results);
+	free(batch);
+	free_map(&m);
+}
+
+/**
+ * Heuristic and progress callbacks that count their calls, for test_stats().
+ **/
+static long nestimates, nreports;
+static long counted_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	nestimates++;
+	return graph_distance(n1, n2, cookie);
+}
+static void counted_progress(const a_star_progress_info_t* info, void* cookie) {
+	nreports++;
+}
+
+/**
+ * Search statistics agree with what the callbacks saw: every estimate is
+ * counted, every expanded node was pushed and estimated, and a context that
+ * reports every k-th expansion reports that many, and no neighbours.
+ **/
+static void test_stats(int queries) {
+	static const unsigned int everies[] = {1, 3, 16};
+	test_map_t m;
+	a_star_search_ctx_t* ctx;
+	a_star_stats_t stats;
+	a_star_node_t** path;
+	int e, q, n;
+
+	create_map(&m, 32, 48, 20, 8, 0, 1, 61);
+	if( a_star_search_ctx_init(m.csr->nnodes, aqHeap, &ctx) < 0 ) {
+		fprintf(stderr, "Failed allocating search context!\n");
+		exit(99);
+	}
+	if( a_star_search_ctx_stats(ctx, &stats) < 0 ) {
+		printf("Statistics are not kept in this build, skipped\n");
+		a_star_search_ctx_deinit(ctx);
+		free_map(&m);
+		return;
+	}
+	for(e=0; e < (int)(sizeof(everies) / sizeof(everies[0])); e++) {
+		a_star_search_ctx_progress_every(ctx, everies[e]);
+		for(q=0; q < queries; q++) {
+			a_star_id_t begin = free_cell(&m), end = free_cell(&m);
+			nestimates = nreports = 0;
+			n = a_star_search(m.csr, ctx, &m.nodes[begin], &m.nodes[end], counted_distance, counted_progress, &m, &path);
+			if( n > 0 )
+				free(path);
+			a_star_search_ctx_stats(ctx, &stats);
+			CHECK(stats.expansions > 0 && stats.heuristicCalls == (unsigned long)nestimates,
+				"%lu expansions and %lu estimates counted, %ld estimates made", stats.expansions, stats.heuristicCalls, nestimates);
+			CHECK(stats.pushes >= stats.expansions && stats.heuristicCalls >= stats.expansions
+					&& stats.heuristicCalls <= m.csr->nnodes && stats.maxOpen > 0 && stats.maxOpen <= stats.pushes,
+				"inconsistent counters: %lu expansions, %lu pushes, %lu estimates, %zu open at most",
+				stats.expansions, stats.pushes, stats.heuristicCalls, stats.maxOpen);
+			if( everies[e] == 1 )
+				CHECK(nreports >= (long)stats.expansions, "%ld reports for %lu expansions", nreports, stats.expansions);
+			else
+				CHECK(nreports == (long)(stats.expansions / everies[e]), "%ld reports for %lu expansions, one every %u",
+					nreports, stats.expansions, everies[e]);
+		}
+	}
+	a_star_search_ctx_deinit(ctx);
+	free_map(&m);
+}
+
+/**
+ * graph_distance() of many nodes at once, from their ids.
+ **/
+static void batch_distance(const a_star_id_t* ids, size_t n, a_star_id_t target, long* h, void* cookie) {
+	const test_map_t* m = (const test_map_t*)cookie;
+	size_t i;
+	for(i=0; i < n; i++)
+		h[i] = graph_distance(&m->nodes[ids[i]], &m->nodes[target], cookie);
+}
+
+/**
+ * A batch heuristic estimates as the per-node one does, so the searches it
+ * guides return the same paths, which are the cheapest.
+ **/
+static void test_batch_heuristic(int queries) {
+	static const a_star_queue_t queues[] = {aqHeap, aqList, aqBucket};
+	static const char* const names[] = {"batch h/heap", "batch h/list", "batch h/bucket"};
+	test_map_t m;
+	a_star_search_ctx_t *single, *batched;
+	a_star_node_t **path, **batchPath;
+	int k, q, n, nb;
+
+	create_map(&m, 32, 48, 25, 8, 1, 1, 67);
+	for(k=0; k < 3; k++) {
+		if( a_star_search_ctx_init(m.csr->nnodes, queues[k], &single) < 0
+				|| a_star_search_ctx_init(m.csr->nnodes, queues[k], &batched) < 0 ) {
+			fprintf(stderr, "Failed allocating search context!\n");
+			exit(99);
+		}
+		a_star_search_ctx_batch_heuristic(batched, batch_distance);
+		for(q=0; q < queries; q++) {
+			a_star_id_t begin = free_cell(&m), end = free_cell(&m);
+			n = a_star_search(m.csr, single, &m.nodes[begin], &m.nodes[end], graph_distance, 0, &m, &path);
+			nb = a_star_search(m.csr, batched, &m.nodes[begin], &m.nodes[end], 0, 0, &m, &batchPath);
+			CHECK(nb == n && (n <= 0 || ! memcmp(path, batchPath, sizeof(a_star_node_t*) * n)),
+				"%s path from %u to %u differs from the per-node heuristic's (%d and %d nodes)", names[k], begin, end, nb, n);
+			if( n > 0 )
+				free(path);
+			reference(&m, begin);
+			check_node_path(names[k], &m, batchPath, nb, begin, end);
+		}
+		a_star_search_ctx_deinit(batched);
+		a_star_search_ctx_deinit(single);
+	}
+	free_map(&m);
+}
+
+/**
+ * A hierarchy built on a loaded graph keeps working once the graph is freed.
+ **/
+static void test_ch_outlives_loaded_graph() {
+	char file[] = "/tmp/a-star-test-XXXXXX";
+	test_map_t m;
+	a_star_csr_t* loaded;
+	a_star_ch_t* ch;
+	a_star_search_ctx_t *forward, *backward;
+	a_star_node_t begin, end, **path;
+	int fd, n;
+
+	create_map(&m, 30, 40, 20, 8, 1, 1, 7);
+	if( (fd = mkstemp(file)) < 0 ) {
+		fprintf(stderr, "Failed creating a temporary file!\n");
+		exit(99);
+	}
+	close(fd);
+	if( a_star_csr_save(m.csr, 0, 0, file) < 0 || a_star_csr_load(file, &loaded) < 0 || a_star_ch_build(loaded, &ch) < 0 ) {
+		fprintf(stderr, "Failed building a hierarchy on a loaded graph!\n");
+		exit(99);
+	}
+	begin = loaded->handles[0];
+	end = loaded->handles[loaded->nnodes - 1];
+	a_star_csr_free(loaded);
+	unlink(file);
+
+	reference(&m, 0);
+	if( a_star_search_ctx_init(m.csr->nnodes, aqHeap, &forward) < 0
+			|| a_star_search_ctx_init(m.csr->nnodes, aqHeap, &backward) < 0 ) {
+		fprintf(stderr, "Failed allocating search context!\n");
+		exit(99);
+	}
+	n = a_star_ch_search(ch, forward, backward, &begin, &end, &path);
+	if( n > 0 ) {
+		// handles carry node indices, which are cell ids here
+		a_star_id_t* ids = (a_star_id_t*)malloc(sizeof(a_star_id_t) * n);
+		int i;
+		for(i=0; i < n; i++)
+			ids[i] = (a_star_id_t)(uintptr_t)path[i]->reserved;
+		CHECK(path_cost(&m.grid, ids, n, 0, m.csr->nnodes - 1) == m.dist[m.csr->nnodes - 1],
+			"ch path on a freed loaded graph is not the cheapest");
+		free(ids);
+		free(path);
+	} else
+		CHECK(n == 0 && m.dist[m.csr->nnodes - 1] < 0, "ch search on a freed loaded graph returned %d", n);
+	a_star_search_ctx_deinit(forward);
+	a_star_search_ctx_deinit(backward);
+	a_star_ch_free(ch);
+	free_map(&m);
+}
+
+/**
+ * JPS scans rows 56 cells at a time out of 64-bit words: walls, with or
+ * without a gap, are placed around the edges of the first windows on either
+ * side of the start, and the goal just past them, in both directions.
+ **/
+static void test_jps_windows() {
+	static const int ranges[2][2] = {{50, 66}, {108, 122}};	// wall columns past the start
+	const int rows = 5, columns = 150;
+	a_star_grid_t g;
+	unsigned char* obstacles = (unsigned char*)malloc(A_STAR_GRID_BITMAP_SIZE(rows, columns));
+	a_star_search_ctx_t* ctx;
+	int startCol, i, wall, gap, dir, goal, r;
+
+	g.rows = rows;
+	g.columns = columns;
+	g.obstacles = obstacles;
+	g.cost = 0;
+	g.connectivity = 8;
+	g.cutCorners = 1;
+	g.heuristic = ahDefault;
+	if( a_star_search_ctx_init((size_t)rows * columns, aqHeap, &ctx) < 0 ) {
+		fprintf(stderr, "Failed allocating search context!\n");
+		exit(99);
+	}
+	for(startCol=0; startCol < 9; startCol++)
+		for(i=0; i < 2; i++)
+			for(wall=startCol+ranges[i][0]; wall <= startCol+ranges[i][1]; wall++)
+				for(gap=-1; gap < rows; gap += 2)	// none, or a gap off the start's row
+					for(dir=0; dir < 2; dir++) {
+						// dir 1 mirrors the columns, for westward jumps
+						int wallCol = dir ? columns - 1 - wall : wall;
+						a_star_jps_t* jps;
+						memset(obstacles, 0, A_STAR_GRID_BITMAP_SIZE(rows, columns));
+						for(r=0; r < rows; r++)
+							if( r != gap ) {
+								a_star_id_t id = A_STAR_GRID_ID(&g, r, wallCol);
+								obstacles[id >> 3] |= 1U << (id & 7);
+							}
+						if( a_star_jps_prepare(&g, &jps) < 0 ) {
+							fprintf(stderr, "Failed preparing the jump tables!\n");
+							exit(99);
+						}
+						for(goal=wall+1; goal <= wall+8; goal++) {
+							a_star_id_t begin = A_STAR_GRID_ID(&g, rows / 2, dir ? columns - 1 - startCol : startCol);
+							a_star_id_t end = A_STAR_GRID_ID(&g, rows / 2, dir ? columns - 1 - goal : goal);
+							a_star_id_t* path;
+							long expected = -1, cost;
+							int n, plus;
+							n = a_star_grid_search(&g, ctx, begin, end, 0, 0, &path);
+							if( n > 0 ) {
+								expected = path_cost(&g, path, n, begin, end);
+								free(path);
+							}
+							for(plus=0; plus < 2; plus++) {
+								const char* engine = plus ? "jps+" : "jps";
+								n = a_star_jps_search(&g, plus ? jps : 0, ctx, begin, end, 0, 0, &path);
+								if( expected < 0 ) {
+									CHECK(n == 0, "%s crossed the wall at column %d from %u to %u", engine, wallCol, begin, end);
+								} else {
+									cost = path_cost(&g, path, n, begin, end);
+									CHECK(cost == expected, "%s path from %u to %u past the wall at column %d costs %ld instead of %ld",
+										engine, begin, end, wallCol, cost, expected);
+								}
+								if( n > 0 )
+									free(path);
+							}
+						}
+						a_star_jps_free(jps);
+					}
+	a_star_search_ctx_deinit(ctx);
+	free(obstacles);
+}
+
+static long zero_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie) {
+	return 0;
+}
+
+static long peak_rss() {
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;	// bytes there
+#else
+	return ru.ru_maxrss;
+#endif
+}
+
+/**
+ * Bucket queues on a chain whose F-costs climb far while the queue stays
+ * non-empty: the buckets left behind are dropped, so memory stays small.
+ **/
+static void test_bucket_large_costs() {
+	const size_t nnodes = 1000;
+	const long step = 100000;
+	a_star_node_t* nodes = (a_star_node_t*)calloc(nnodes, sizeof(a_star_node_t));
+	a_star_node_t** nodePtrs = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * nnodes);
+	a_star_edge_t* edges = (a_star_edge_t*)malloc(sizeof(a_star_edge_t) * nnodes * 2);
+	a_star_edge_t** edgePtrs = (a_star_edge_t**)malloc(sizeof(a_star_edge_t*) * nnodes * 2);
+	a_star_graph_t graph;
+	a_star_csr_t* csr;
+	a_star_search_ctx_t* ctx;
+	a_star_node_t** path;
+	long before = peak_rss(), cost;
+	size_t i;
+	int n;
+
+	graph.nodes = nodePtrs;
+	graph.nnodes = nnodes;
+	graph.edges = edgePtrs;
+	graph.nedges = 0;
+	for(i=0; i < nnodes; i++) {
+		nodePtrs[i] = &nodes[i];
+		if( i + 1 < nnodes )
+			edges[graph.nedges] = (a_star_edge_t){&nodes[i], &nodes[i+1], step};
+		edgePtrs[graph.nedges] = &edges[graph.nedges];
+		graph.nedges += i + 1 < nnodes;
+		if( i + 3 < nnodes )
+			edges[graph.nedges] = (a_star_edge_t){&nodes[i], &nodes[i+3], 3 * step + 1};
+		edgePtrs[graph.nedges] = &edges[graph.nedges];
+		graph.nedges += i + 3 < nnodes;
+	}
+	graph.begin = &nodes[0];
+	graph.end = &nodes[nnodes - 1];
+
+	// the C++ engine behind a_star_shortest_path_ex()
+	n = a_star_shortest_path_ex(&graph, zero_distance, zero_distance, 0, 0, aqBucket, &path);
+	CHECK(n == (int)nnodes, "bucket queue chain path has %d nodes instead of %zu", n, nnodes);
+	if( n > 0 )
+		free(path);
+
+	// the C engine
+	if( a_star_graph_prepare(&graph, 0, 0, &csr) < 0 || a_star_search_ctx_init(nnodes, aqBucket, &ctx) < 0 ) {
+		fprintf(stderr, "Failed preparing the chain!\n");
+		exit(99);
+	}
+	n = a_star_search(csr, ctx, graph.begin, graph.end, zero_distance, 0, 0, &path);
+	cost = 0;
+	for(i=1; i < (size_t)(n > 0 ? n : 0); i++)
+		cost += path[i] - path[i-1] == 1 ? step : 3 * step + 1;
+	CHECK(n == (int)nnodes && cost == step * (long)(nnodes - 1), "bucket queue chain path of %d nodes costs %ld", n, cost);
+	if( n > 0 )
+		free(path);
+	a_star_search_ctx_deinit(ctx);
+	a_star_csr_free(csr);
+
+	CHECK(peak_rss() - before < 64 * 1024, "bucket queues on a chain of large costs took %ld KiB", peak_rss() - before);
+	free(edgePtrs);
+	free(edges);
+	free(nodePtrs);
+	free(nodes);
+}
+
+/**
+ * Queries on a reused context that stores paths into the caller's buffer
+ * allocate nothing once a first pass over the same queries has sized the
+ * context's queue, pool and scratch arena.
+ **/
+static void test_no_allocations(int queries) {
+	static const a_star_queue_t queues[] = {aqHeap, aqList, aqBucket};
+	static const char* const names[] = {"heap", "list", "bucket"};
+	test_map_t m;
+	a_star_id_t* ends;
+	a_star_id_t* path;
+	a_star_node_t** nodePath;
+	int k, pass, q;
+
+	create_map(&m, 64, 96, 25, 8, 1, 0, 42);
+	ends = (a_star_id_t*)malloc(sizeof(a_star_id_t) * 2 * queries);
+	path = (a_star_id_t*)malloc(sizeof(a_star_id_t) * m.csr->nnodes);
+	nodePath = (a_star_node_t**)malloc(sizeof(a_star_node_t*) * m.csr->nnodes);
+	for(q=0; q < 2 * queries; q++)
+		ends[q] = free_cell(&m);
+	for(k=0; k < 3; k++) {
+		a_star_search_ctx_t* ctx;
+		long graphAllocs = 0, gridAllocs = 0;
+		if( a_star_search_ctx_init(m.csr->nnodes, queues[k], &ctx) < 0 ) {
+			fprintf(stderr, "Failed allocating search context!\n");
+			exit(99);
+		}
+		for(pass=0; pass < 2; pass++) {
+			nallocs = 0;
+			for(q=0; q < queries; q++)
+				a_star_search_buf(m.csr, ctx, &m.nodes[ends[2*q]], &m.nodes[ends[2*q+1]], graph_distance, 0, &m,
+					nodePath, m.csr->nnodes);
+			graphAllocs = nallocs;
+			nallocs = 0;
+			for(q=0; q < queries; q++)
+				a_star_grid_search_buf(&m.grid, ctx, ends[2*q], ends[2*q+1], 0, 0, path, m.csr->nnodes);
+			gridAllocs = nallocs;
+		}
+		CHECK(graphAllocs == 0, "%ld allocations in %d graph searches on a reused %s context", graphAllocs, queries, names[k]);
+		CHECK(gridAllocs == 0, "%ld allocations in %d grid searches on a reused %s context", gridAllocs, queries, names[k]);
+		a_star_search_ctx_deinit(ctx);
+	}
+	free(nodePath);
+	free(path);
+	free(ends);
+	free_map(&m);
+}
+
+static const char __help[] =
+"a-star-test - cross-checks the a-star search engines\n"
+"-------------------------------------------------------\n"
+"Usage:\n"
+"	a-star-test {s|n|h}\n"
+"Options:\n"
+"	-s <seeds>\n"
+"		#of random maps per combination (default: 2)\n"
+"	-n <queries>\n"
+"		#of random queries per map (default: 10)\n"
+"	-h\n"
+"		Show this help information\n"
+"Exits with status 1 if any check fails.\n"
+;
+
+int main(int argc, char** argv) {
+	int opt, seeds = 2, queries = 10;
+
+	while( (opt=getopt(argc, argv, "s:n:h")) != -1 ) {
+		switch( opt ) {
+			case 's': seeds = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'n': queries = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'h':
+			default:
+				printf("%s\n", __help);
+				exit(opt == 'h' ? 0 : 99);
+		}
+	}
+
+	test_bucket_large_costs();
+	test_random_maps(seeds, queries);
+	test_jps_windows();
+	test_dstar_updates(seeds);
+	test_hpa_updates(seeds, queries);
+	test_cache();
+	test_alt(queries);
+	test_map_files();
+	test_batch(queries);
+	test_stats(queries);
+	test_batch_heuristic(queries);
+	test_ch_outlives_loaded_graph();
+	test_cxx(seeds, queries);
+	if( ALLOCS_COUNTED )
+		test_no_allocations(queries);
+	else
+		printf("Allocations are not counted in this build, skipped\n");
+
+	printf("%ld checks, %ld failed\n", nchecks, nfailures);
+	return nfailures ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+// test.h
+// Random test maps, the reference Dijkstra and the checks shared by the
+// translation units of a-star-test.
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+#include "a-star.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _test_map_t {
+	a_star_grid_t grid;
+	unsigned char* obstacles;
+	unsigned char* cost;	// null for uniform cost
+	a_star_node_t* nodes;	// a node per cell, for the graph engines
+	a_star_graph_t graph;
+	a_star_csr_t* csr;
+	long* dist;	// reference distances from the query's begin
+} test_map_t;
+
+extern long nchecks, nfailures;
+
+#define	CHECK(cond, ...)	do { \
+		nchecks++; \
+		if( ! (cond) ) { \
+			nfailures++; \
+			printf("FAILED %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while(0)
+
+/**
+ * splitmix64 state and step, so that a seed gives the same map on every platform.
+ **/
+extern unsigned long long rngState;
+unsigned long long rng_next(void);
+
+/**
+ * Map of 'barriers' percent random obstacles, with a cost layer if 'costs', and
+ * the graph of its moves, prepared. The map should be deallocated using free_map().
+ **/
+void create_map(test_map_t* m, int rows, int columns, int barriers, int connectivity,
+		int cutCorners, int costs, unsigned long long seed);
+void free_map(test_map_t* m);
+a_star_id_t free_cell(const test_map_t* m);
+
+/**
+ * Cost of a move, or of a path of cell ids from 'begin' to 'end', by the grid
+ * rules; a negative value if it is not allowed.
+ **/
+long step_cost(const a_star_grid_t* g, a_star_id_t from, a_star_id_t to);
+long path_cost(const a_star_grid_t* g, const a_star_id_t* path, int n, a_star_id_t begin, a_star_id_t end);
+
+/**
+ * Reference distances from 'begin' to every cell into m->dist, -1 where unreachable.
+ **/
+void reference(test_map_t* m, a_star_id_t begin);
+
+/**
+ * Cost of the move between graph nodes by step_cost(), with the map as cookie.
+ **/
+long graph_cost(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie);
+
+/**
+ * Octile (8-connected) or Manhattan distance between graph nodes, with the map as cookie.
+ **/
+long graph_distance(const a_star_node_t* n1, const a_star_node_t* n2, void* cookie);
+
+/**
+ * Check a path against m->dist[end]: an id path (exactly, or not below it if
+ * not 'optimal'), or a path of graph nodes (exactly, and freed).
+ **/
+void check_path(const char* engine, const test_map_t* m, const a_star_id_t* path, int n,
+		a_star_id_t begin, a_star_id_t end, int optimal);
+void check_node_path(const char* engine, const test_map_t* m, a_star_node_t** path, int n,
+		a_star_id_t begin, a_star_id_t end);
+
+/**
+ * The C++ engine of a-star.hpp, through the C API and directly (test-cxx.cpp).
+ **/
+void test_cxx(int seeds, int queries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
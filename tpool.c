@@ -0,0 +1,123 @@
+// tpool.c
+
+#include <pthread.h>
+#include <unistd.h>
+#include "tpool.h"
+
+typedef struct _tpool_share_t {
+	pthread_mutex_t lock;
+	size_t lo, hi;	// indices not taken yet
+	char pad[64];	// keep shares on separate cache lines
+} tpool_share_t;
+
+typedef struct _tpool_context_t {
+	int nworkers;
+	tpool_share_t* shares;
+	tpool_job_t job;
+	void* cookie;
+} tpool_context_t;
+
+typedef struct _tpool_worker_t {
+	tpool_context_t* pool;
+	int index;
+	pthread_t thread;
+} tpool_worker_t;
+
+static int take_own(tpool_share_t* s, size_t* index) {
+	int found = 0;
+	pthread_mutex_lock(&s->lock);
+	if( s->lo < s->hi ) {
+		*index = s->lo++;
+		found = 1;
+	}
+	pthread_mutex_unlock(&s->lock);
+	return found;
+}
+
+static int steal(tpool_context_t* x, int thief) {
+	int i;
+	tpool_share_t* own = &x->shares[thief];
+	for(i=1; i < x->nworkers; i++) {
+		tpool_share_t* victim = &x->shares[(thief + i) % x->nworkers];
+		size_t lo, hi;
+		pthread_mutex_lock(&victim->lock);
+		lo = victim->lo;
+		hi = victim->hi;
+		if( lo < hi ) {
+			// take the upper half (or the last index)
+			size_t mid = lo + (hi - lo) / 2;
+			victim->hi = mid;
+			lo = mid;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if( lo < hi ) {
+			pthread_mutex_lock(&own->lock);
+			own->lo = lo;
+			own->hi = hi;
+			pthread_mutex_unlock(&own->lock);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void* worker_main(void* arg) {
+	tpool_worker_t* w = (tpool_worker_t*)arg;
+	tpool_context_t* x = w->pool;
+	size_t index;
+	for(;;) {
+		while( take_own(&x->shares[w->index], &index) )
+			(*x->job)(w->index, index, x->cookie);
+		if( ! steal(x, w->index) )
+			break;
+	}
+	return 0;
+}
+
+int tpool_workers(int nthreads, size_t njobs) {
+	if( nthreads <= 0 ) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 0 ? (int)ncpu : 1;
+	}
+	if( (size_t)nthreads > njobs )
+		nthreads = njobs ? (int)njobs : 1;
+	return nthreads;
+}
+
+int tpool_run(int nthreads, size_t njobs, tpool_job_t job, void* cookie) {
+	tpool_context_t x;
+	tpool_worker_t* workers;
+	int i, started;
+
+	if( ! job )
+		return -1;
+
+	x.nworkers = tpool_workers(nthreads, njobs);
+	x.job = job;
+	x.cookie = cookie;
+	x.shares = (tpool_share_t*)malloc(sizeof(tpool_share_t) * x.nworkers);
+	workers = (tpool_worker_t*)malloc(sizeof(tpool_worker_t) * x.nworkers);
+
+	for(i=0; i < x.nworkers; i++) {
+		pthread_mutex_init(&x.shares[i].lock, 0);
+		x.shares[i].lo = njobs * i / x.nworkers;
+		x.shares[i].hi = njobs * (i + 1) / x.nworkers;
+		workers[i].pool = &x;
+		workers[i].index = i;
+	}
+
+	// worker 0 is the calling thread
+	for(started=1; started < x.nworkers; started++)
+		if( pthread_create(&workers[started].thread, 0, worker_main, &workers[started]) != 0 )
+			break; // the running workers will steal the orphaned shares
+	worker_main(&workers[0]);
+	for(i=1; i < started; i++)
+		pthread_join(workers[i].thread, 0);
+
+	for(i=0; i < x.nworkers; i++)
+		pthread_mutex_destroy(&x.shares[i].lock);
+	free(workers);
+	free(x.shares);
+
+	return started;
+}
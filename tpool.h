@@ -0,0 +1,25 @@
+// tpool.h
+
+#ifndef _TPOOL_H_
+#define _TPOOL_H_
+
+#include <stdlib.h>
+
+typedef void(*tpool_job_t)(int worker, size_t index, void* cookie);
+
+/**
+ * Runs job(worker, index, cookie) for every index in [0..njobs) on 'nthreads'
+ * workers (the calling thread being worker 0), and returns when all are done.
+ * Every worker starts with an equal share of the indices and, once its own
+ * share is exhausted, steals half of what is left in another worker's share.
+ * nthreads <= 0 means one worker per online CPU.
+ * Returns the number of workers used, or a negative value on error.
+ **/
+int tpool_run(int nthreads, size_t njobs, tpool_job_t job, void* cookie);
+
+/**
+ * Number of workers tpool_run() would use for the given request.
+ **/
+int tpool_workers(int nthreads, size_t njobs);
+
+#endif